@@ -0,0 +1,247 @@
+/*******************************************************************************
+* @filename: assets.c
+* @brief: ASCII Art loading for backgrounds, prompts and skins
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/assets.h"
+#include "include/glyph.h"
+
+#if LINUX_EN
+#include <sys/inotify.h>
+#endif
+#include "include/metrics.h"
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+typedef struct Asset
+{
+    char *art;
+    int rows, columns;
+    char *file;
+} ASSET;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+BACKGROUND backGround;
+PROMPT prompt;
+
+// art files from ASSET_LIST, where each one is loaded to
+#define ASSET_ENTRY(asset, art, rows, columns, file) [asset] = {art, rows, columns, file},
+static const ASSET assets[assetCount] =
+{
+    ASSET_LIST(ASSET_ENTRY)
+};
+#undef ASSET_ENTRY
+
+// art read from disk, NULL for the compiled in copy
+static char *artDir = NULL;
+
+#if LINUX_EN
+// art directories watched for changes
+static const char *watchDirName[] = {"backgrounds", "prompts", "skins"};
+static int watchDir[3];
+static int watchFd = -1;
+#endif
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Load the ASCII Art, compiled in or from the ART_DIR_ENV directory
+ * @retval True if success
+ */
+bool loadFiles(){
+    // no file I/O, checked and converted at build time
+    glyph_preload(artGlyphs, artGlyphCount);
+    for(int i = 0; i < assetCount; i++){
+        memcpy(assets[i].art, artCells[i], assets[i].rows * assets[i].columns);
+    }
+
+    // the files on disk take the place of every asset
+    artDir = getenv(ART_DIR_ENV);
+    if(artDir != NULL){
+        for(int i = 0; i < assetCount; i++){
+            if(!readTxtFiles(assets[i].art, assets[i].rows, assets[i].columns, assets[i].file)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read .txt files, a failure waits for ENTER
+ * @retval True if success
+ */
+bool readTxtFiles(char matrixObject[], int row, int col, char txtFileName[]){
+    static GLYPH_SCRATCH glyphs;
+    char error[128];
+
+    if(!parseTxtFile(matrixObject, row, col, txtFileName, &glyphs, error, sizeof(error))){
+        clrscr();
+        gotoxy(0,0);
+        printf("%s\n", error);
+        printf("Press ENTER to continue...\n");
+        while(get_char() != ENTER) msleep(10);
+        return false;
+    }
+    glyph_register(&glyphs);
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Decode a .txt file of the art directory into an art matrix
+ * @note   The art is UTF-8, a wide glyph takes two cells
+ * @param  glyphs: new glyphs of the art, glyph_register() them before using it
+ * @param  error: message on failure, NULL if not needed
+ * @retval True if success, the matrix may be partially written otherwise
+ */
+bool parseTxtFile(char matrixObject[], int row, int col, char txtFileName[], GLYPH_SCRATCH *glyphs, char error[], int errorSize){
+    char buf[256];
+    FILE *pont_arq;
+    char *text;
+    long size;
+    int line = 1;
+    bool valid;
+
+        snprintf(buf, sizeof(buf),"%s%s%s.txt", (artDir != NULL) ? artDir : ART_DIR_DEFAULT, FILE_SEPARATOR, txtFileName);
+        pont_arq = fopen(buf, "rb");
+        if(pont_arq){
+            // whole file, a glyph may take several bytes
+            fseek(pont_arq, 0, SEEK_END);
+            size = ftell(pont_arq);
+            rewind(pont_arq);
+            text = malloc((size > 0) ? size : 1);
+            size = (text != NULL && size > 0) ? (long) fread(text, sizeof(char), size, pont_arq) : 0;
+            fclose(pont_arq);
+
+            glyph_scratch(glyphs);
+            valid = (text != NULL) && glyph_decode_art(glyphs, text, size, matrixObject, row, col, &line);
+            free(text);
+            // a file caught half written fails here too
+            if(!valid){
+                if(error != NULL) snprintf(error, errorSize, "Error, invalid file size. %s.txt -> line %d, %d x %d expected", txtFileName, line, row, col);
+                return false;
+            }
+        }
+        else{
+            if(error != NULL) snprintf(error, errorSize, "Error in the opening of: %s.txt", txtFileName);
+            return false;
+        }
+
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Watch the art directories for changes, see reloadFiles()
+ * @retval File descriptor readable when a file changed, -1 if not supported
+ */
+int watchFiles(){
+#if LINUX_EN
+    char path[256];
+
+    // the compiled in art never changes
+    if(artDir == NULL){
+        return -1;
+    }
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watchFd < 0){
+        return -1;
+    }
+    for(int i = 0; i < 3; i++){
+        snprintf(path, sizeof(path), "%s%s%s", artDir, FILE_SEPARATOR, watchDirName[i]);
+        // a file written in place, or replaced by rename like most editors do
+        watchDir[i] = inotify_add_watch(watchFd, path, IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+    return watchFd;
+#else
+    return -1;
+#endif
+}
+//**************************************************************************************
+
+/**
+ * @brief  Load again the art files changed since the last call, without waiting
+ * @note   An asset is swapped only when its new file is valid, a bad file keeps
+ *         the old art and is counted in metrics. Call between frames
+ * @retval ASSET_BIT() mask of the assets that changed
+ */
+uint32_t reloadFiles(){
+    uint32_t changed = 0;
+#if LINUX_EN
+    char buf[ASSET_WATCH_BUFFER] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[100];
+    uint32_t pending = 0;
+    int len;
+
+    if(watchFd < 0){
+        return 0;
+    }
+    // the same file often shows up more than once, it is read only once
+    while((len = read(watchFd, buf, sizeof(buf))) > 0){
+        for(char *ptr = buf; ptr < buf + len; ){
+            struct inotify_event *event = (struct inotify_event *) ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            for(int i = 0; i < 3 && event->len > 0; i++){
+                if(event->wd == watchDir[i]){
+                    snprintf(path, sizeof(path), "%s%s%s", watchDirName[i], FILE_SEPARATOR, event->name);
+                    for(int a = 0; a < assetCount; a++){
+                        int nameLen = strlen(assets[a].file);
+                        if(strncmp(path, assets[a].file, nameLen) == 0 && strcmp(&path[nameLen], ".txt") == 0){
+                            pending |= ASSET_BIT(a);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for(int a = 0; a < assetCount; a++){
+        if(pending & ASSET_BIT(a)){
+            static GLYPH_SCRATCH glyphs;
+            int size = assets[a].rows * assets[a].columns;
+            char *art = calloc(size, sizeof(char));
+
+            // a rejected file takes no glyph IDs
+            if(art == NULL || !parseTxtFile(art, assets[a].rows, assets[a].columns, assets[a].file, &glyphs, NULL, 0)){
+                metrics.assetReloadErrors++;
+            }
+            else if(memcmp(art, assets[a].art, size) != 0){
+                glyph_register(&glyphs);
+                memcpy(assets[a].art, art, size);
+                metrics.assetReloads++;
+                changed |= ASSET_BIT(a);
+            }
+            free(art);
+        }
+    }
+#endif
+    return changed;
+}
+//**************************************************************************************
@@ -0,0 +1,722 @@
+/*******************************************************************************
+* @filename: batch.c
+* @brief: Batch of headless games stepped together with SIMD, every game gives
+*         the same results as env_step() for the same seed and actions
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/batch.h"
+
+#ifdef _WIN32 // @windows
+#include <malloc.h>
+#define batch_alloc(size) _aligned_malloc(size, 64)
+#define batch_dealloc(ptr) _aligned_free(ptr)
+#else // @linux
+#define batch_alloc(size) aligned_alloc(64, size)
+#define batch_dealloc(ptr) free(ptr)
+#endif
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Pick lanes from a or b
+ * @param  mask: 0 or -1 per lane, -1 picks a
+ * @retval The merged vector
+ */
+static inline BATCH_VEC batch_select(BATCH_VEC mask, BATCH_VEC a, BATCH_VEC b)
+{
+    return (a & mask) | (b & ~mask);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if any lane is set
+ * @retval True if at least one lane is not zero
+ */
+static inline bool batch_any(BATCH_VEC v)
+{
+    uint64_t word[sizeof(BATCH_VEC) / sizeof(uint64_t)];
+    uint64_t any = 0;
+
+    memcpy(word, &v, sizeof(v));
+    for (unsigned i = 0; i < sizeof(word) / sizeof(word[0]); i++)
+    {
+        any |= word[i];
+    }
+    return any != 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Highest lane value
+ * @retval The maximum
+ */
+static inline int batch_max(BATCH_VEC v)
+{
+    int max = v[0];
+    for (int i = 1; i < BATCH_LANES; i++)
+    {
+        max = (v[i] > max) ? v[i] : max;
+    }
+    return max;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if a value lies in [0, max], in one unsigned comparison
+ * @retval 0 or -1 per lane
+ */
+static inline BATCH_VEC batch_within(BATCH_VEC v, int max)
+{
+    return (BATCH_VEC) ((BATCH_UVEC) v <= (uint16_t) max);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Ticks elapsed since a game start time
+ * @retval The elapsed ticks, capped to BATCH_TIME_MAX
+ */
+static int16_t batch_elapsed(const GAME *game, uint64_t startTime)
+{
+    uint64_t elapsed = (game->now - startTime) / ENV_TICK;
+    return (elapsed < BATCH_TIME_MAX) ? (int16_t) elapsed : BATCH_TIME_MAX;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Game start time matching elapsed ticks
+ * @note   A capped counter gives a start time at zero, past every delay as well
+ * @retval The start time in microseconds
+ */
+static uint64_t batch_start_time(const GAME *game, int16_t elapsed)
+{
+    return (elapsed < BATCH_TIME_MAX) ? game->now - (uint64_t) elapsed * ENV_TICK : 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Copy a game into a lane
+ * @retval None
+ */
+static void batch_store(BATCH_BLOCK *b, int l, const ENV *env)
+{
+    const GAME *game = &env->game;
+
+    b->score[l] = game->player.score;
+    b->gameOver[l] = -game->player.gameOver;
+    b->levelOver[l] = -game->player.levelOver;
+    b->arrowsLeft[l] = game->player.arrowsLeft;
+    b->balloonsDestroyed[l] = game->player.balloonsDestroyed;
+    b->monstersKilled[l] = game->player.monstersKilled;
+    b->live[l] = -!env->done;
+
+    b->levelType[l] = game->preset.levelType;
+    b->arrowQuantity[l] = game->preset.arrowQuantity;
+    b->arrowConsumableArrows[l] = -game->preset.arrowConsumableArrows;
+    b->archerHitDelay[l] = game->preset.archerHitDelay;
+    b->arrowHitDelay[l] = game->preset.arrowHitDelay;
+    b->arrowStaggerDelay[l] = game->preset.arrowStaggerDelay;
+    b->balloonStaggerDelay[l] = game->preset.balloonStaggerDelay;
+    b->monsterStaggerDelay[l] = game->preset.monsterStaggerDelay;
+    b->monsterSpawnDelay[l] = game->preset.monsterSpawnDelay;
+
+    b->archerX[l] = game->archer.x;
+    b->archerKeyHitLimit[l] = -game->archer.keyHitLimit;
+    b->archerKeyHitTime[l] = batch_elapsed(game, game->archer.startTimeKeyHitLimit);
+
+    for (int i = 0; i < MAX_ARROW_QUANTITY; i++)
+    {
+        b->arrowActive[i][l] = -game->arrow.active[i];
+        b->arrowX[i][l] = game->arrow.x[i];
+        b->arrowY[i][l] = game->arrow.y[i];
+    }
+    b->arrowIndex[l] = game->arrow.index;
+    b->arrowActiveIndex[l] = game->arrow.activeIndex;
+    b->arrowStagger[l] = -game->arrow.stagger;
+    b->arrowKeyHitLimit[l] = -game->arrow.keyHitLimit;
+    b->arrowStaggerTime[l] = batch_elapsed(game, game->arrow.startTimeStagger);
+    b->arrowKeyHitTime[l] = batch_elapsed(game, game->arrow.startTimeKeyHitLimit);
+
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        b->balloonActive[i][l] = -game->balloon.active[i];
+        b->balloonX[i][l] = game->balloon.x[i];
+        b->balloonY[i][l] = game->balloon.y[i];
+        b->balloonIndividualStagger[i][l] = -game->balloon.individualStagger[i];
+        b->balloonIndividualDelay[i][l] = game->balloon.IndividualDelay[i];
+        b->balloonIndividualTime[i][l] = batch_elapsed(game, game->balloon.startTimeIndividualStagger[i]);
+    }
+    b->balloonActiveIndex[l] = game->balloon.activeIndex;
+    b->balloonStagger[l] = -game->balloon.stagger;
+    b->balloonStaggerTime[l] = batch_elapsed(game, game->balloon.startTimeStagger);
+
+    for (int i = 0; i < MONSTER_QUANTITY; i++)
+    {
+        b->monsterActive[i][l] = -game->monster.active[i];
+        b->monsterX[i][l] = game->monster.x[i];
+        b->monsterY[i][l] = game->monster.y[i];
+    }
+    b->monsterIndex[l] = game->monster.index;
+    b->monsterActiveIndex[l] = game->monster.activeIndex;
+    b->monsterStagger[l] = -game->monster.stagger;
+    b->monsterStaggerTime[l] = batch_elapsed(game, game->monster.startTimeStagger);
+    b->monsterSpawnTime[l] = batch_elapsed(game, game->monster.startTimeSpawn);
+
+    b->level[l] = game->player.level;
+    b->difficulty[l] = game->player.difficulty;
+    b->balloonInitialX[l] = game->preset.balloonInitialX;
+    b->balloonScatteredDelayMax[l] = game->preset.balloonScatteredDelayMax;
+    b->balloonScatteredDelayMin[l] = game->preset.balloonScatteredDelayMin;
+    b->nBalloonLevel[l] = game->nBalloonLevel;
+    b->nMonsterLevel[l] = game->nMonsterLevel;
+    b->nBalloonScatteredLevel[l] = game->nBalloonScatteredLevel;
+    b->random[l] = game->random;
+    b->basePreset[l] = game->basePreset;
+    b->steps[l] = env->steps;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Copy a lane into a game, the game layer is left blank
+ * @retval None
+ */
+static void batch_load(const BATCH_BLOCK *b, int l, ENV *env)
+{
+    GAME *game = &env->game;
+
+    memset(env, 0, sizeof(ENV));
+    env->steps = b->steps[l];
+    env->done = !b->live[l];
+    game->now = ENV_EPOCH + env->steps * ENV_TICK;
+    game->random = b->random[l];
+    game->basePreset = b->basePreset[l];
+    game->nBalloonLevel = b->nBalloonLevel[l];
+    game->nMonsterLevel = b->nMonsterLevel[l];
+    game->nBalloonScatteredLevel = b->nBalloonScatteredLevel[l];
+
+    game->player.score = b->score[l];
+    game->player.difficulty = b->difficulty[l];
+    game->player.theme = vanilla;
+    game->player.level = b->level[l];
+    game->player.gameOver = b->gameOver[l] != 0;
+    game->player.levelOver = b->levelOver[l] != 0;
+    game->player.arrowsLeft = b->arrowsLeft[l];
+    game->player.balloonsDestroyed = b->balloonsDestroyed[l];
+    game->player.monstersKilled = b->monstersKilled[l];
+
+    game->preset.levelType = b->levelType[l];
+    game->preset.arrowQuantity = b->arrowQuantity[l];
+    game->preset.arrowConsumableArrows = b->arrowConsumableArrows[l] != 0;
+    game->preset.archerHitDelay = b->archerHitDelay[l];
+    game->preset.arrowHitDelay = b->arrowHitDelay[l];
+    game->preset.arrowStaggerDelay = b->arrowStaggerDelay[l];
+    game->preset.balloonInitialX = b->balloonInitialX[l];
+    game->preset.balloonStaggerDelay = b->balloonStaggerDelay[l];
+    game->preset.balloonScatteredDelayMax = b->balloonScatteredDelayMax[l];
+    game->preset.balloonScatteredDelayMin = b->balloonScatteredDelayMin[l];
+    game->preset.monsterStaggerDelay = b->monsterStaggerDelay[l];
+    game->preset.monsterSpawnDelay = b->monsterSpawnDelay[l];
+
+    game->archer.x = b->archerX[l];
+    game->archer.y = ARCHER_INITIAL_Y;
+    game->archer.keyHitLimit = b->archerKeyHitLimit[l] != 0;
+    game->archer.startTimeKeyHitLimit = batch_start_time(game, b->archerKeyHitTime[l]);
+
+    for (int i = 0; i < MAX_ARROW_QUANTITY; i++)
+    {
+        game->arrow.active[i] = b->arrowActive[i][l] != 0;
+        game->arrow.x[i] = b->arrowX[i][l];
+        game->arrow.y[i] = b->arrowY[i][l];
+    }
+    game->arrow.index = b->arrowIndex[l];
+    game->arrow.activeIndex = b->arrowActiveIndex[l];
+    game->arrow.stagger = b->arrowStagger[l] != 0;
+    game->arrow.keyHitLimit = b->arrowKeyHitLimit[l] != 0;
+    game->arrow.startTimeStagger = batch_start_time(game, b->arrowStaggerTime[l]);
+    game->arrow.startTimeKeyHitLimit = batch_start_time(game, b->arrowKeyHitTime[l]);
+
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        game->balloon.active[i] = b->balloonActive[i][l] != 0;
+        game->balloon.x[i] = b->balloonX[i][l];
+        game->balloon.y[i] = b->balloonY[i][l];
+        game->balloon.individualStagger[i] = b->balloonIndividualStagger[i][l] != 0;
+        game->balloon.IndividualDelay[i] = b->balloonIndividualDelay[i][l];
+        game->balloon.startTimeIndividualStagger[i] = batch_start_time(game, b->balloonIndividualTime[i][l]);
+    }
+    game->balloon.activeIndex = b->balloonActiveIndex[l];
+    game->balloon.stagger = b->balloonStagger[l] != 0;
+    game->balloon.startTimeStagger = batch_start_time(game, b->balloonStaggerTime[l]);
+
+    for (int i = 0; i < MONSTER_QUANTITY; i++)
+    {
+        game->monster.active[i] = b->monsterActive[i][l] != 0;
+        game->monster.x[i] = b->monsterX[i][l];
+        game->monster.y[i] = b->monsterY[i][l];
+    }
+    game->monster.index = b->monsterIndex[l];
+    game->monster.activeIndex = b->monsterActiveIndex[l];
+    game->monster.stagger = b->monsterStagger[l] != 0;
+    game->monster.startTimeStagger = batch_start_time(game, b->monsterStaggerTime[l]);
+    game->monster.startTimeSpawn = batch_start_time(game, b->monsterSpawnTime[l]);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Build the archer hit test of hitArcherDetector() for every monster offset
+ * @note   Row (monster row - archer row + MONSTER_ROWS - 1) holds one bit per
+ *         column offset (monster column - archer column + MONSTER_COLUMNS - 1)
+ * @retval None
+ */
+static void batch_archer_hit(BATCH *batch)
+{
+    memset(batch->archerHit, 0, sizeof(batch->archerHit));
+
+    for (int m = 0; m < MONSTER_ROWS; m++)
+    {
+        for (int a = 0; a < ARCHER_ROWS; a++)
+        {
+            for (int m2 = 0; m2 < MONSTER_COLUMNS; m2++)
+            {
+                for (int a2 = 0; a2 < ARCHER_COLUMNS; a2++)
+                {
+                    if (skin.monster[(m * MONSTER_COLUMNS) + m2] != ' ' && skin.archer[(a * ARCHER_COLUMNS) + a2] != ' ')
+                    {
+                        batch->archerHit[a - m + MONSTER_ROWS - 1] |= 1 << (a2 - m2 + MONSTER_COLUMNS - 1);
+                    }
+                }
+            }
+        }
+    }
+    batch->archerHitReady = true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Allocate a batch, every game starts finished until it's reset
+ * @param  n: number of games
+ * @retval False if out of memory
+ */
+bool batch_init(BATCH *batch, int n)
+{
+    memset(batch, 0, sizeof(BATCH));
+    batch->n = n;
+    batch->nBlocks = (n + BATCH_LANES - 1) / BATCH_LANES;
+    batch->block = batch_alloc(batch->nBlocks * sizeof(BATCH_BLOCK));
+    if (batch->block == NULL)
+    {
+        return false;
+    }
+    memset(batch->block, 0, batch->nBlocks * sizeof(BATCH_BLOCK));
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Release a batch
+ * @retval None
+ */
+void batch_free(BATCH *batch)
+{
+    batch_dealloc(batch->block);
+    batch->block = NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start a new game, same as env_reset()
+ * @param  i: game index
+ * @retval None
+ */
+void batch_reset(BATCH *batch, int i, uint32_t seed, enum difficulty difficulty, int level)
+{
+    ENV env;
+
+    env_reset(&env, seed, difficulty, level);
+    if (!batch->archerHitReady)
+    {
+        batch_archer_hit(batch);
+    }
+    batch_store(&batch->block[i / BATCH_LANES], i % BATCH_LANES, &env);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Account the finished levels of a block, same as the end of env_step()
+ * @param  ended: lanes whose level is over
+ * @retval None
+ */
+static void batch_end_level(BATCH_BLOCK *b, BATCH_VEC ended)
+{
+    ENV env;
+
+    for (int l = 0; l < BATCH_LANES; l++)
+    {
+        if (ended[l])
+        {
+            batch_load(b, l, &env);
+            if (gameEndLevel(&env.game))
+            {
+                gameStartLevel(&env.game);
+            }
+            else
+            {
+                env.done = true;
+            }
+            batch_store(b, l, &env);
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Advance the games of a block by one tick, same as gameTick()
+ * @param  action: envAction of each lane
+ * @retval None
+ */
+static void batch_tick(const BATCH *batch, BATCH_BLOCK *b, BATCH_VEC action)
+{
+    BATCH_VEC live = b->live;
+    BATCH_VEC zero = {0};
+    BATCH_VEC points = {0};
+
+    // ---------- TIME ----------
+#define BATCH_TIMER(t) t = batch_select(live, t + ((t < BATCH_TIME_MAX) & 1), t)
+    BATCH_TIMER(b->archerKeyHitTime);
+    BATCH_TIMER(b->arrowStaggerTime);
+    BATCH_TIMER(b->arrowKeyHitTime);
+    BATCH_TIMER(b->balloonStaggerTime);
+    BATCH_TIMER(b->monsterStaggerTime);
+    BATCH_TIMER(b->monsterSpawnTime);
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        BATCH_TIMER(b->balloonIndividualTime[i]);
+    }
+#undef BATCH_TIMER
+
+    // ---------- INPUT ----------
+    BATCH_VEC up = live & (action == envUp);
+    BATCH_VEC down = live & (action == envDown);
+    BATCH_VEC shoot = live & (action == envShoot);
+
+    // archerMovUp(), archerMovDown()
+    BATCH_VEC move = up | down;
+    b->archerKeyHitTime = batch_select(move & (b->archerKeyHitTime >= b->archerHitDelay), zero, b->archerKeyHitTime);
+    move = ~b->archerKeyHitLimit;
+    b->archerX += (up & move & (b->archerX > ARCHER_UPPER_LIMIT)) - (down & move & (b->archerX < ARCHER_LOWER_LIMIT));
+
+    // arrowShoot()
+    if (batch_any(shoot))
+    {
+        b->arrowKeyHitTime = batch_select(shoot & (b->arrowKeyHitTime >= b->arrowHitDelay), zero, b->arrowKeyHitTime);
+        BATCH_VEC fire = shoot & ~b->arrowKeyHitLimit & (b->arrowIndex < b->arrowQuantity);
+        if (batch_any(fire))
+        {
+            for (int i = 0; i < MAX_ARROW_QUANTITY; i++)
+            {
+                BATCH_VEC slot = fire & (b->arrowIndex == (int16_t) i);
+                b->arrowActive[i] |= slot;
+                b->arrowX[i] = batch_select(slot, b->archerX + 1, b->arrowX[i]);
+                b->arrowY[i] = batch_select(slot, zero + (ARCHER_INITIAL_Y + ARCHER_COLUMNS), b->arrowY[i]);
+            }
+            b->arrowActiveIndex -= fire;
+            b->arrowIndex -= fire;
+        }
+    }
+
+    // ---------- TIME CONTROL ----------
+    BATCH_VEC isBalloon = b->levelType == balloonLevel;
+    BATCH_VEC isMonster = b->levelType == monsterLevel;
+    BATCH_VEC isScattered = b->levelType == balloonScatteredLevel;
+    BATCH_VEC over;
+
+    b->archerKeyHitLimit = batch_select(live, b->archerKeyHitTime < b->archerHitDelay, b->archerKeyHitLimit);
+    over = live & (b->arrowStaggerTime >= b->arrowStaggerDelay);
+    b->arrowStaggerTime = batch_select(over, zero, b->arrowStaggerTime);
+    b->arrowStagger = batch_select(live, ~over, b->arrowStagger);
+    b->arrowKeyHitLimit = batch_select(live, b->arrowKeyHitTime < b->arrowHitDelay, b->arrowKeyHitLimit);
+
+    // balloon level
+    over = b->balloonStaggerTime >= b->balloonStaggerDelay;
+    b->balloonStaggerTime = batch_select(live & isBalloon & over, zero, b->balloonStaggerTime);
+    b->balloonStagger = batch_select(live & isBalloon, ~over, b->balloonStagger);
+
+    // monster level, spawnRateMonster()
+    BATCH_VEC monsterLive = live & isMonster;
+    over = b->monsterStaggerTime >= b->monsterStaggerDelay;
+    b->monsterStaggerTime = batch_select(monsterLive & over, zero, b->monsterStaggerTime);
+    b->monsterStagger = batch_select(monsterLive, ~over, b->monsterStagger);
+    over = monsterLive & (b->monsterSpawnTime >= b->monsterSpawnDelay);
+    if (batch_any(over))
+    {
+        b->monsterSpawnTime = batch_select(over, zero, b->monsterSpawnTime);
+        BATCH_VEC spawn = over & (b->monsterIndex < MONSTER_QUANTITY);
+        for (int i = 0; i < MONSTER_QUANTITY; i++)
+        {
+            b->monsterActive[i] |= spawn & (b->monsterIndex == (int16_t) i);
+        }
+        b->monsterActiveIndex -= spawn;
+        b->monsterIndex -= spawn;
+    }
+
+    // scattered balloon level, staggerControlScatteredBalloon()
+    BATCH_VEC scatteredLive = live & isScattered;
+    if (batch_any(scatteredLive))
+    {
+        for (int i = 0; i < BALLOON_QUANTITY; i++)
+        {
+            over = b->balloonIndividualTime[i] >= b->balloonIndividualDelay[i];
+            b->balloonIndividualTime[i] = batch_select(scatteredLive & over, zero, b->balloonIndividualTime[i]);
+            b->balloonIndividualStagger[i] = batch_select(scatteredLive, ~over, b->balloonIndividualStagger[i]);
+        }
+    }
+
+    int nArrows = batch_max(b->arrowIndex);
+    int nMonsters = batch_max(b->monsterIndex);
+
+    // ---------- COLLISIONS ----------
+
+    // hitBalloonDetector(), the arrows aren't consumed on balloon levels, so every
+    // balloon touched by an arrow tip pops whatever the order
+    BATCH_VEC gate = live & (isBalloon | isScattered) & (b->arrowActiveIndex > 0) & (b->balloonActiveIndex > 0);
+    if (batch_any(gate))
+    {
+        for (int j = 0; j < BALLOON_QUANTITY; j++)
+        {
+            BATCH_VEC hit = zero;
+            for (int i = 0; i < nArrows; i++)
+            {
+                hit |= b->arrowActive[i] & batch_within(b->arrowY[i] + ARROW_COLUMNS - b->balloonY[j], BALLOON_COLUMNS - 1)
+                                         & batch_within(b->arrowX[i] - b->balloonX[j], BALLOON_ROWS - 1);
+            }
+            hit &= gate & b->balloonActive[j];
+            b->balloonActive[j] &= ~hit;
+            b->balloonActiveIndex += hit;
+            b->balloonsDestroyed -= hit;
+            points += hit & BALLOON_POINTS;
+        }
+    }
+
+    // hitMonsterDetector(), in the same order as the scalar loops: an arrow keeps
+    // killing monsters during the pass that consumed it
+    gate = monsterLive & (b->arrowActiveIndex > 0) & (b->monsterActiveIndex > 0);
+    if (batch_any(gate))
+    {
+        for (int i = 0; i < nArrows; i++)
+        {
+            BATCH_VEC arrow = gate & b->arrowActive[i];
+            if (!batch_any(arrow))
+            {
+                continue;
+            }
+            for (int j = 0; j < nMonsters; j++)
+            {
+                BATCH_VEC hit = arrow & b->monsterActive[j]
+                              & batch_within(b->arrowY[i] + ARROW_COLUMNS - b->monsterY[j], MONSTER_COLUMNS - 1)
+                              & batch_within(b->arrowX[i] - b->monsterX[j], MONSTER_ROWS - 1);
+                BATCH_VEC consumed = hit & b->arrowConsumableArrows;
+                b->arrowActive[i] &= ~consumed;
+                b->arrowActiveIndex += consumed;
+                b->monsterActive[j] &= ~hit;
+                b->monsterActiveIndex += hit;
+                b->monstersKilled -= hit;
+                points += hit & MONSTER_POINTS;
+            }
+        }
+    }
+
+    // hitArcherDetector(), the pixel test comes from the precomputed table
+    gate = monsterLive & (b->monsterActiveIndex > 0);
+    if (batch_any(gate))
+    {
+        BATCH_VEC hit = zero;
+        for (int j = 0; j < nMonsters; j++)
+        {
+            BATCH_VEC dx = b->monsterX[j] - b->archerX + (MONSTER_ROWS - 1);
+            BATCH_VEC dy = b->monsterY[j] - ARCHER_INITIAL_Y + (MONSTER_COLUMNS - 1);
+            BATCH_VEC row = zero;
+            for (int k = 0; k < MONSTER_ROWS + ARCHER_ROWS - 1; k++)
+            {
+                row |= (dx == (int16_t) k) & (int16_t) batch->archerHit[k];
+            }
+            BATCH_VEC inside = b->monsterActive[j] & batch_within(dy, 15);
+            hit |= inside & -((row >> (dy & 15)) & 1);
+        }
+        b->gameOver = batch_select(monsterLive, hit & gate, b->gameOver);
+    }
+
+    // ---------- UPDATE ----------
+
+    // arrows
+    gate = live & (b->arrowActiveIndex > 0) & ~b->arrowStagger;
+    if (batch_any(gate))
+    {
+        for (int i = 0; i < nArrows; i++)
+        {
+            BATCH_VEC arrow = gate & b->arrowActive[i];
+            BATCH_VEC inside = b->arrowY[i] < ARROW_RIGHT_LIMIT;
+            b->arrowY[i] -= arrow & inside;
+            b->arrowActive[i] &= ~(arrow & ~inside);
+            b->arrowActiveIndex += arrow & ~inside;
+        }
+    }
+    b->gameOver |= live & (b->arrowActiveIndex == 0) & (b->arrowIndex == b->arrowQuantity)
+                        & ((b->balloonActiveIndex > 0) | (b->monsterActiveIndex > 0));
+
+    // balloons float up and come back from the bottom
+    BATCH_VEC balloonLive = live & (isBalloon | isScattered);
+    gate = balloonLive & (b->balloonActiveIndex > 0) & ~b->balloonStagger;
+    if (batch_any(gate))
+    {
+        for (int i = 0; i < BALLOON_QUANTITY; i++)
+        {
+            BATCH_VEC balloon = gate & b->balloonActive[i] & ~b->balloonIndividualStagger[i];
+            b->balloonX[i] += balloon;
+            b->balloonX[i] = batch_select(balloon & (b->balloonX[i] <= BALLOON_UPPER_LIMIT - BALLOON_ROWS),
+                                          zero + (BALLOON_LOWER_LIMIT - 1), b->balloonX[i]);
+        }
+    }
+    b->levelOver |= balloonLive & (b->balloonActiveIndex == 0) & (b->arrowActiveIndex == 0);
+
+    // monsters walk left until they are out of the canvas
+    gate = monsterLive & (b->monsterActiveIndex > 0) & ~b->monsterStagger;
+    if (batch_any(gate))
+    {
+        for (int i = 0; i < nMonsters; i++)
+        {
+            BATCH_VEC monster = gate & b->monsterActive[i];
+            b->monsterY[i] += monster;
+            BATCH_VEC gone = monster & (b->monsterY[i] == -MONSTER_COLUMNS + 1);
+            b->monsterActive[i] &= ~gone;
+            b->monsterActiveIndex += gone;
+        }
+    }
+    b->levelOver |= monsterLive & (b->monsterActiveIndex == 0) & (b->monsterIndex == MONSTER_QUANTITY) & (b->arrowActiveIndex == 0);
+
+    b->score += __builtin_convertvector(points, BATCH_VEC32);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Advance every running game by one fixed tick
+ * @param  actions: envAction of each game
+ * @param  rewards: points scored by each game during the tick, may be NULL
+ * @retval None
+ */
+void batch_step(BATCH *batch, const uint8_t *actions, int32_t *rewards)
+{
+    for (int k = 0; k < batch->nBlocks; k++)
+    {
+        BATCH_BLOCK *b = &batch->block[k];
+        BATCH_VEC action = {0};
+        BATCH_VEC32 score = b->score;
+        int base = k * BATCH_LANES;
+
+        if (batch_any(b->live))
+        {
+            for (int l = 0; l < BATCH_LANES && base + l < batch->n; l++)
+            {
+                action[l] = actions[base + l];
+                b->steps[l] += (b->live[l] != 0);
+            }
+
+            batch_tick(batch, b, action);
+
+            BATCH_VEC ended = b->live & (b->gameOver | b->levelOver);
+            if (batch_any(ended))
+            {
+                batch_end_level(b, ended);
+            }
+        }
+
+        if (rewards != NULL)
+        {
+            BATCH_VEC32 reward = b->score - score;
+            for (int l = 0; l < BATCH_LANES && base + l < batch->n; l++)
+            {
+                rewards[base + l] = reward[l];
+            }
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if a game is over
+ * @param  i: game index
+ * @retval True once the game ended, until it's reset
+ */
+bool batch_done(const BATCH *batch, int i)
+{
+    return batch->block[i / BATCH_LANES].live[i % BATCH_LANES] == 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read the state of one game, same as env_observe()
+ * @param  i: game index
+ * @retval None
+ */
+void batch_observe(const BATCH *batch, int i, ENV_OBSERVATION *obs)
+{
+    const BATCH_BLOCK *b = &batch->block[i / BATCH_LANES];
+    int l = i % BATCH_LANES;
+
+    obs->score = b->score[l];
+    obs->level = b->level[l];
+    obs->levelType = b->levelType[l];
+    obs->archerRow = b->archerX[l];
+    obs->arrowsLeft = b->arrowQuantity[l] - b->arrowIndex[l];
+    obs->done = !b->live[l];
+
+    obs->arrowActive = obs->balloonActive = obs->monsterActive = 0;
+    for (int j = 0; j < MAX_ARROW_QUANTITY; j++)
+    {
+        obs->arrowActive |= (uint32_t) (b->arrowActive[j][l] & 1) << j;
+        obs->arrowX[j] = b->arrowX[j][l];
+        obs->arrowY[j] = b->arrowY[j][l];
+    }
+    for (int j = 0; j < BALLOON_QUANTITY; j++)
+    {
+        obs->balloonActive |= (uint32_t) (b->balloonActive[j][l] & 1) << j;
+        obs->balloonX[j] = b->balloonX[j][l];
+        obs->balloonY[j] = b->balloonY[j][l];
+    }
+    for (int j = 0; j < MONSTER_QUANTITY; j++)
+    {
+        obs->monsterActive |= (uint32_t) (b->monsterActive[j][l] & 1) << j;
+        obs->monsterX[j] = b->monsterX[j][l];
+        obs->monsterY[j] = b->monsterY[j][l];
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Copy one game out of the batch, to keep playing it with env_step()
+ * @param  i: game index
+ * @param  env: filled with the game, the layer is blank
+ * @retval None
+ */
+void batch_get(const BATCH *batch, int i, ENV *env)
+{
+    batch_load(&batch->block[i / BATCH_LANES], i % BATCH_LANES, env);
+}
+//**************************************************************************************
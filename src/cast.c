@@ -0,0 +1,124 @@
+/*******************************************************************************
+* @filename: cast.c
+* @brief: asciicast v2 writer, terminal output stamped with its time
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/cast.h"
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Write bytes as the inside of a JSON string
+ * @param  file: destination
+ * @param  data: bytes, UTF-8 glyphs are written as they are
+ * @param  len: number of bytes
+ * @retval None
+ */
+static void cast_string(FILE *file, const char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        unsigned char ch = data[i];
+        if (ch == '"' || ch == '\\')
+        {
+            fputc('\\', file);
+            fputc(ch, file);
+        }
+        else if (ch < 0x20 || ch == 0x7F)
+        {
+            fprintf(file, "\\u%04x", ch);
+        }
+        else
+        {
+            fputc(ch, file);
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Create an asciicast file and write its header
+ * @param  cast: cast to start
+ * @param  path: file path
+ * @param  title: shown by the players, may be NULL
+ * @retval False if the file can't be created
+ * @note   The terminal is the size of the canvas
+ */
+bool cast_open(CAST *cast, const char *path, const char *title)
+{
+    cast->file = fopen(path, "w");
+    cast->events = 0;
+    cast->bytes = 0;
+    if (cast->file == NULL)
+    {
+        return false;
+    }
+    fprintf(cast->file, "{\"version\": %d, \"width\": %d, \"height\": %d, \"timestamp\": %lld, \"env\": {\"TERM\": \"%s\"}",
+            CAST_VERSION, CANVAS_COLUMNS, CANVAS_ROWS, (long long) time(NULL), CAST_TERM);
+    if (title != NULL)
+    {
+        fputs(", \"title\": \"", cast->file);
+        cast_string(cast->file, title, strlen(title));
+        fputc('"', cast->file);
+    }
+    fputs("}\n", cast->file);
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add terminal output
+ * @param  cast: open cast
+ * @param  time: seconds since the start of the recording, never less than
+ *         the time of the output before
+ * @param  data: bytes written to the terminal, whole glyphs
+ * @param  len: number of bytes, nothing is added when zero
+ * @retval None
+ */
+void cast_output(CAST *cast, double time, const char *data, int len)
+{
+    if (len <= 0)
+    {
+        return;
+    }
+    fprintf(cast->file, "[%.6f, \"o\", \"", time);
+    cast_string(cast->file, data, len);
+    fputs("\"]\n", cast->file);
+    cast->events++;
+    cast->bytes += len;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Finish an asciicast file
+ * @param  cast: open cast, closed
+ * @retval False if any write failed
+ */
+bool cast_close(CAST *cast)
+{
+    bool ok = !ferror(cast->file);
+
+    ok = (fclose(cast->file) == 0) && ok;
+    cast->file = NULL;
+    return ok;
+}
+//**************************************************************************************
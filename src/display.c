@@ -0,0 +1,217 @@
+/*******************************************************************************
+* @filename: display.c
+* @brief: Render thread of the local terminal, takes the newest frame from the
+*         simulation through a lock-free triple buffer and draws it
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/display.h"
+#include "include/metrics.h"
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Dummy function, the console is drawn by the simulation thread
+ * @retval False
+ */
+bool display_start(DISPLAY *display, OUTBUFFER *out, ENCODER *encoder, SCREEN *screen)
+{
+    (void) out;
+    (void) encoder;
+    (void) screen;
+    display->running = false;
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ * @retval False
+ */
+bool display_publish(DISPLAY *display, char layer[CANVAS_ROWS][CANVAS_COLUMNS], ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    (void) display;
+    (void) layer;
+    (void) attr;
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ */
+void display_stop(DISPLAY *display)
+{
+    (void) display;
+}
+//**************************************************************************************
+#else // @linux
+
+/**
+ * @brief  Write an output buffer to the terminal, waiting for it if busy
+ * @param  out: output buffer, emptied
+ */
+static void display_write(OUTBUFFER *out)
+{
+    while (out->len > 0)
+    {
+        int len = write(STDOUT_FILENO, out->data, out->len);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // terminal gone
+            out->len = 0;
+            break;
+        }
+        outbuf_consume(out, len);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render thread, draws the newest frame each time it wakes up
+ * @param  arg: the display
+ * @retval NULL
+ */
+static void *display_run(void *arg)
+{
+    DISPLAY *display = arg;
+
+    for (;;)
+    {
+        while (sem_wait(&display->wake) < 0 && errno == EINTR);
+
+        // the frames published while the last one was written are skipped
+        if (atomic_load(&display->middle) & DISPLAY_FRESH)
+        {
+            display->front = atomic_exchange(&display->middle, display->front) & DISPLAY_INDEX;
+
+            DISPLAY_FRAME *frame = &display->frame[display->front];
+            uint64_t startTime = get_clock();
+            int bytes = render_layer(display->out, display->encoder, display->screen, frame->glyph, frame->attr);
+            display_write(display->out);
+            // nothing changed, nothing sent
+            if (bytes > 0)
+            {
+                metrics_frame(time_diff(startTime), bytes);
+            }
+        }
+        else if (atomic_load(&display->stop))
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start the render thread, it owns the output, the encoder and the
+ *         screen model until display_stop()
+ * @param  out: terminal output buffer, written out first
+ * @param  encoder: terminal encoder
+ * @param  screen: what the terminal shows
+ * @retval True if the thread runs, the caller draws by itself otherwise
+ */
+bool display_start(DISPLAY *display, OUTBUFFER *out, ENCODER *encoder, SCREEN *screen)
+{
+    display->out = out;
+    display->encoder = encoder;
+    display->screen = screen;
+    memset(&display->canvas, '\0', sizeof(display->canvas));
+    display->back = 0;
+    display->front = 1;
+    atomic_store(&display->middle, 2);
+    atomic_store(&display->stop, false);
+
+    fflush(stdout);
+    display_write(out);
+    if (sem_init(&display->wake, 0, 0) < 0)
+    {
+        return false;
+    }
+    if (pthread_create(&display->thread, NULL, display_run, display) != 0)
+    {
+        sem_destroy(&display->wake);
+        return false;
+    }
+    display->running = true;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Hand the cells changed since the last frame to the render thread,
+ *         without waiting for it
+ * @param  layer: changed cells, '\0' means unchanged
+ * @param  attr: attributes of the changed cells
+ * @retval True if the frame before was never drawn
+ * @note   Call from the simulation thread only
+ */
+bool display_publish(DISPLAY *display, char layer[CANVAS_ROWS][CANVAS_COLUMNS], ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    DISPLAY_FRAME *canvas = &display->canvas;
+    int old;
+
+    // a skipped frame can't lose a change, each one holds all of them
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        for (int j = 0; j < CANVAS_COLUMNS; j++)
+        {
+            if (layer[i][j] != '\0')
+            {
+                canvas->glyph[i][j] = layer[i][j];
+                canvas->attr[i][j] = attr[i][j];
+            }
+        }
+    }
+    memcpy(&display->frame[display->back], canvas, sizeof(DISPLAY_FRAME));
+
+    old = atomic_exchange(&display->middle, display->back | DISPLAY_FRESH);
+    display->back = old & DISPLAY_INDEX;
+    sem_post(&display->wake);
+    return (old & DISPLAY_FRESH) != 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Draw the last published frame and stop the render thread
+ * @retval None
+ */
+void display_stop(DISPLAY *display)
+{
+    if (!display->running)
+    {
+        return;
+    }
+    atomic_store(&display->stop, true);
+    sem_post(&display->wake);
+    pthread_join(display->thread, NULL);
+    sem_destroy(&display->wake);
+    display->running = false;
+}
+//**************************************************************************************
+#endif
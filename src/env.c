@@ -0,0 +1,311 @@
+/*******************************************************************************
+* @filename: env.c
+* @brief: Step and observe interface for agents, the game runs headless on a
+*         fixed tick without terminal I/O or wall-clock timing
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/env.h"
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+// Skins used when the ASCII Art files weren't loaded, the archer collisions
+// depend on their blank cells
+static const char defaultArcher[] = "~o :\\    |<:-)-> - :/   / \\     ";
+static const char defaultArrow[] = "-->";
+static const char defaultBalloon[] = "/~\\\\ / $ ";
+static const char defaultMonster[] = "~~    @@:   O-\\   >-/X\\  \\XXX\\";
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Fill the skins when no ASCII Art was loaded
+ * @retval None
+ */
+static void env_default_skin()
+{
+    if (skin.archer[0] == '\0')
+    {
+        memcpy(skin.archer, defaultArcher, sizeof(skin.archer));
+        memcpy(skin.arrow, defaultArrow, sizeof(skin.arrow));
+        memcpy(skin.balloon, defaultBalloon, sizeof(skin.balloon));
+        memcpy(skin.monster, defaultMonster, sizeof(skin.monster));
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Go on to the next level after the tick that finished one
+ * @retval None
+ */
+static void env_end_level(ENV *env)
+{
+    GAME *game = &env->game;
+
+    if (game->player.gameOver || game->player.levelOver)
+    {
+        if (gameEndLevel(game))
+        {
+            gameStartLevel(game);
+        }
+        else
+        {
+            env->done = true;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start a new game
+ * @param  seed: random seed, the same seed and actions replay the same game
+ * @param  difficulty: game difficulty
+ * @param  level: first level, from 1 to MAX_LEVEL
+ * @retval None
+ */
+void env_reset(ENV *env, uint32_t seed, enum difficulty difficulty, int level)
+{
+    GAME *game = &env->game;
+
+    env_default_skin();
+
+    gameInit(game, difficulty);
+    gameSeed(game, seed);
+    gameSetLevel(game, level);
+    game->now = ENV_EPOCH;
+    gameStartLevel(game);
+
+    env->steps = 0;
+    env->done = false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start a new game with tuned delays instead of a difficulty
+ * @param  seed: random seed
+ * @param  preset: delays of a level one game, the level changes still apply on
+ *         top of them, it must stay valid while the game runs
+ * @param  level: first level, from 1 to MAX_LEVEL
+ * @retval True if the delays can be played, see presetValid(), the
+ *         environment is left untouched otherwise
+ */
+bool env_reset_preset(ENV *env, uint32_t seed, const PRESETS *preset, int level)
+{
+    GAME *game = &env->game;
+
+    if (!presetValid(preset))
+    {
+        return false;
+    }
+    env_default_skin();
+
+    gameInit(game, normal);
+    gameSeed(game, seed);
+    game->basePreset = preset;
+    gameSetLevel(game, level);
+    game->now = ENV_EPOCH;
+    gameStartLevel(game);
+
+    env->steps = 0;
+    env->done = false;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Advance the game by one fixed tick
+ * @param  action: agent action for this tick
+ * @retval Points scored during the tick
+ */
+int env_step(ENV *env, enum envAction action)
+{
+    static const int keys[] = {[envNoop] = 0, [envUp] = UP, [envDown] = DOWN, [envShoot] = SPACE};
+    GAME *game = &env->game;
+    int score = game->player.score;
+
+    if (env->done)
+    {
+        return 0;
+    }
+
+    game->now += ENV_TICK;
+    gameTick(game, keys[action]);
+    env_end_level(env);
+    env->steps++;
+
+    return game->player.score - score;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play ticks with no action, as that many env_step(env, envNoop) would.
+ *         The ticks where nothing can change are skipped, see gameAdvance()
+ * @param  ticks: ticks to play, fewer are played if the game ends
+ * @retval Points scored during those ticks
+ */
+int env_skip(ENV *env, uint64_t ticks)
+{
+    GAME *game = &env->game;
+    int score = game->player.score;
+    uint64_t startTime = game->now, endTime = game->now + ticks * ENV_TICK;
+
+    while (!env->done && game->now < endTime)
+    {
+        gameAdvance(game, endTime, 0);
+        env_end_level(env);
+    }
+    env->steps += (game->now - startTime) / ENV_TICK;
+
+    return game->player.score - score;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read the game state
+ * @param  obs: filled with the current state
+ * @retval None
+ */
+void env_observe(const ENV *env, ENV_OBSERVATION *obs)
+{
+    const GAME *game = &env->game;
+
+    obs->score = game->player.score;
+    obs->level = game->player.level;
+    obs->levelType = game->preset.levelType;
+    obs->archerRow = game->archer.x;
+    obs->arrowsLeft = game->preset.arrowQuantity - game->arrow.index;
+    obs->done = env->done;
+
+    obs->arrowActive = obs->balloonActive = obs->monsterActive = 0;
+    for (int i = 0; i < MAX_ARROW_QUANTITY; i++)
+    {
+        obs->arrowActive |= (uint32_t) game->arrow.active[i] << i;
+        obs->arrowX[i] = game->arrow.x[i];
+        obs->arrowY[i] = game->arrow.y[i];
+    }
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        obs->balloonActive |= (uint32_t) game->balloon.active[i] << i;
+        obs->balloonX[i] = game->balloon.x[i];
+        obs->balloonY[i] = game->balloon.y[i];
+    }
+    for (int i = 0; i < MONSTER_QUANTITY; i++)
+    {
+        obs->monsterActive |= (uint32_t) game->monster.active[i] << i;
+        obs->monsterX[i] = game->monster.x[i];
+        obs->monsterY[i] = game->monster.y[i];
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Mark an entity box on the occupancy grid, clipped to the play area
+ * @retval None
+ */
+static void env_mark(uint8_t grid[CANVAS_ROWS][CANVAS_COLUMNS], int x, int y, int rows, int columns, enum envCell cell)
+{
+    for (int i = x; i < x + rows; i++)
+    {
+        if (i <= CANVAS_MIDDLE_EDGE_X || i >= CANVAS_LOWER_EDGE_X)
+        {
+            continue;
+        }
+        for (int j = y; j < y + columns; j++)
+        {
+            if (j > CANVAS_LEFT_EDGE_Y && j < CANVAS_RIGHT_EDGE_Y)
+            {
+                grid[i][j] = cell;
+            }
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Build the occupancy grid of the play area
+ * @param  grid: filled with an envCell per canvas cell
+ * @retval None
+ */
+void env_occupancy(const ENV *env, uint8_t grid[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    const GAME *game = &env->game;
+
+    memset(grid, envEmpty, CANVAS_ROWS * CANVAS_COLUMNS);
+
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        if (game->balloon.active[i])
+        {
+            env_mark(grid, game->balloon.x[i], game->balloon.y[i], BALLOON_ROWS, BALLOON_COLUMNS, envBalloon);
+        }
+    }
+    for (int i = 0; i < game->monster.index; i++)
+    {
+        if (game->monster.active[i])
+        {
+            env_mark(grid, game->monster.x[i], game->monster.y[i], MONSTER_ROWS, MONSTER_COLUMNS, envMonster);
+        }
+    }
+    for (int i = 0; i < game->arrow.index; i++)
+    {
+        if (game->arrow.active[i])
+        {
+            env_mark(grid, game->arrow.x[i], game->arrow.y[i], ARROW_ROWS, ARROW_COLUMNS, envArrow);
+        }
+    }
+    env_mark(grid, game->archer.x, game->archer.y, ARCHER_ROWS, ARCHER_COLUMNS, envArcher);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Save the environment, to come back to it or to fork it
+ * @param  data: where the snapshot goes, SNAPSHOT_MAX_SIZE always fits
+ * @retval Snapshot length, zero if it didn't fit
+ */
+int env_save(const ENV *env, uint8_t *data, int size)
+{
+    return snapshot_save(&env->game, data, size);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Restore an environment saved with env_save()
+ * @retval True if success, the environment is left untouched otherwise
+ * @note   Any number of environments can start from the same snapshot, they go on
+ *         as the saved one would for the same actions
+ */
+bool env_restore(ENV *env, const uint8_t *data, int len)
+{
+    GAME *game = &env->game;
+
+    env_default_skin();
+    if (!snapshot_load(game, data, len))
+    {
+        return false;
+    }
+    // the step count follows from the game time
+    env->steps = (game->now - ENV_EPOCH) / ENV_TICK;
+    env->done = game->player.gameOver || game->player.levelOver;
+    return true;
+}
+//**************************************************************************************
@@ -0,0 +1,1243 @@
+/*******************************************************************************
+* @filename: game.c
+* @brief: Game rules and entities simulation, independent of the terminal
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/game.h"
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+SKIN skin;
+
+// Directions of the debris of a burst, row then column
+static const int8_t particleDirection[PARTICLE_BURST][2] =
+{
+    {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}
+};
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Computes the game time difference
+ * @param  startTime: initial game time in microseconds
+ * @retval The game time elapsed in milliseconds since startTime
+ */
+static double gameTimeDiff(GAME *game, uint64_t startTime){
+    return ((double) (game->now - startTime)) / 1000;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Next number of the game random generator (xorshift)
+ * @retval A pseudo random number
+ */
+static int gameRandom(GAME *game){
+    game->random ^= game->random << 13;
+    game->random ^= game->random >> 17;
+    game->random ^= game->random << 5;
+    return (int) (game->random & 0x7FFFFFFF);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if a live entity covers a canvas cell, debris is drawn behind them
+ * @retval True if the cell is covered
+ */
+static bool particleCellTaken(GAME *game, int x, int y){
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+
+    if(x >= archer->x && x < archer->x + ARCHER_ROWS && y >= archer->y && y < archer->y + ARCHER_COLUMNS) return true;
+    for(int i=0; i < arrow->index; i++){
+        if(arrow->active[i] && x == arrow->x[i] && y >= arrow->y[i] && y < arrow->y[i] + ARROW_COLUMNS) return true;
+    }
+    for(int i=0; i < BALLOON_QUANTITY; i++){
+        if(balloon->active[i] && x >= balloon->x[i] && x < balloon->x[i] + BALLOON_ROWS
+           && y >= balloon->y[i] && y < balloon->y[i] + BALLOON_COLUMNS) return true;
+    }
+    for(int i=0; i < monster->index; i++){
+        if(monster->active[i] && x >= monster->x[i] && x < monster->x[i] + MONSTER_ROWS
+           && y >= monster->y[i] && y < monster->y[i] + MONSTER_COLUMNS) return true;
+    }
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if a canvas cell is inside the playing field, inside the border
+ * @retval True if inside
+ */
+static bool particleInField(int x, int y){
+    return x > CANVAS_MIDDLE_EDGE_X && x < CANVAS_LOWER_EDGE_X && y > CANVAS_LEFT_EDGE_Y && y < CANVAS_RIGHT_EDGE_Y;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Set up a new game
+ * @retval None
+ */
+void gameInit(GAME *game, enum difficulty difficulty){
+    memset(game, 0, sizeof(GAME));
+    gameSeed(game, (uint32_t) get_clock());
+    game->player.difficulty = difficulty;
+    game->player.theme = vanilla;
+    game->player.level = 1;
+
+    game->archer.active = true;
+    game->archer.x = ARCHER_INITIAL_X;
+    game->archer.y = ARCHER_INITIAL_Y;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Seed the game random generator
+ * @param  seed: any value, the same seed gives the same monsters and balloons
+ * @retval None
+ */
+void gameSeed(GAME *game, uint32_t seed){
+    // spread the seed bits, the generator state can't be zero
+    seed = (seed ^ 0x9E3779B9) * 0x85EBCA6B;
+    seed ^= seed >> 16;
+    game->random = (seed != 0) ? seed : 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Reset player status after a game over, keeping the player settings
+ * @retval None
+ */
+void gameReset(GAME *game){
+    PLAYER *player = &game->player;
+
+    player->score = 0;
+    player->level = 1;
+    player->gameOver = false;
+    player->levelOver = false;
+    player->balloonsDestroyed = 0;
+    player->monstersKilled = 0;
+    player->arrowsLeft = 0;
+
+    memset(game->layer, '\0', sizeof(game->layer));
+    memset(game->attr, 0, sizeof(game->attr));
+}
+//**************************************************************************************
+
+/**
+ * @brief  Jump to a level as if the previous ones were played
+ * @param  level: level to play next, gameStartLevel() places its entities
+ * @retval None
+ */
+void gameSetLevel(GAME *game, int level){
+    if(level < 1) level = 1;
+    if(level > MAX_LEVEL) level = MAX_LEVEL;
+
+    game->player.level = level;
+    // levels played of each type, they rotate balloon, monster, scattered balloon
+    game->nBalloonLevel = (level + 1) / N_LEVEL_TYPES;
+    game->nMonsterLevel = level / N_LEVEL_TYPES;
+    game->nBalloonScatteredLevel = (level - 1) / N_LEVEL_TYPES;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Configure the current level and place its entities
+ * @retval None
+ */
+void gameStartLevel(GAME *game){
+    PLAYER *player = &game->player;
+    PRESETS *preset = &game->preset;
+    ARCHER *archer = &game->archer;
+
+    memset(&game->arrow, 0, sizeof(ARROW));
+    memset(&game->balloon, 0, sizeof(BALLOON));
+    memset(&game->monster, 0, sizeof(MONSTER));
+    // debris of the last level
+    for(int i=0; i < game->particle.count; i++){
+        game->layer[game->particle.x[i]][game->particle.y[i]] = ' ';
+        game->attr[game->particle.x[i]][game->particle.y[i]] = 0;
+    }
+    game->particle.count = 0;
+
+    // just need to execute one time
+    if(player->level == 1){
+        // reset archer position and state
+        archer->active = true;
+        archer->x = ARCHER_INITIAL_X;
+        archer->y = ARCHER_INITIAL_Y;
+    }
+    // print score
+    printNumberInGame(game, player->score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
+    // print the level number
+    printNumberInGame(game, player->level, LEVEL_DISPLAY_X, LEVEL_DISPLAY_Y, "%03i");
+    setLevelPreset(game);
+
+    // print arrows left
+    #if !DEBUG_MODE
+        for(int i=0; i < MAX_ARROW_QUANTITY; i++){ //erase arrows left
+            game->layer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-MAX_ARROW_QUANTITY)+ i] = ' ';
+        }
+
+        for(int i=0; i < preset->arrowQuantity; i++){ //print arrows left
+            game->layer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-preset->arrowQuantity)+ i] = ARROW_LEFT_DISPLAY_SYMBOL;
+        }
+    #endif
+
+    switch(preset->levelType){
+        case balloonLevel: {
+            setBalloonFirstRowPosition(game);
+            game->balloon.startTimeStagger = game->now;
+        } break;
+        case monsterLevel: {
+            setMonsterFirstPosition(game);
+            game->monster.startTimeSpawn = game->now;
+        } break;
+        case balloonScatteredLevel: {
+            setBalloonScatteredPostition(game);
+            for(int i=0; i < BALLOON_QUANTITY; i++){
+                game->balloon.startTimeIndividualStagger[i] = game->now;
+            }
+        } break;
+    }
+
+    game->arrow.startTimeStagger = game->now;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Advance the game to game->now
+ * @param  key: key pressed at that time or zero
+ * @retval None
+ */
+void gameTick(GAME *game, int key){
+    PRESETS *preset = &game->preset;
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+
+    switch(key){
+        case 'w': case 'W': case UP: archerMovUp(game); break;
+        case 's': case 'S': case DOWN: archerMovDown(game); break;
+        case SPACE: arrowShoot(game); break;
+    }
+
+    //TIME CONTROL
+    archer->keyHitLimit = keyHitControl(game, archer->startTimeKeyHitLimit, preset->archerHitDelay);
+    arrow->stagger = staggerControl(game, &arrow->startTimeStagger, preset->arrowStaggerDelay);
+    arrow->keyHitLimit = keyHitControl(game, arrow->startTimeKeyHitLimit, preset->arrowHitDelay);
+    switch(preset->levelType){
+        case balloonLevel: {
+            balloon->stagger = staggerControl(game, &balloon->startTimeStagger, preset->balloonStaggerDelay);
+        } break;
+        case monsterLevel:{
+            monster->stagger = staggerControl(game, &monster->startTimeStagger, preset->monsterStaggerDelay);
+            spawnRateMonster(game, preset->monsterSpawnDelay);
+        }break;
+        case balloonScatteredLevel: {
+            staggerControlScatteredBalloon(game);
+        }
+    }
+
+    // COLLISIONS
+    switch(preset->levelType){
+        case balloonLevel: case balloonScatteredLevel: {
+            hitBalloonDetector(game);
+        } break;
+        case monsterLevel:{
+            hitMonsterDetector(game);
+            game->player.gameOver = hitArcherDetector(game);
+        } break;
+    }
+    // update actions in game
+    update(game);
+    particleUpdate(game);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Earliest of a game time and the end of a cooldown, see staggerControl()
+ * @param  due: game time in microseconds
+ * @param  startTime: when the cooldown started
+ * @param  delay: cooldown in milliseconds, every preset is a whole number
+ * @retval Game time in microseconds
+ */
+static uint64_t gameDue(uint64_t due, uint64_t startTime, int delay){
+    uint64_t end = startTime + (uint64_t) delay * 1000;
+    return (end < due) ? end : due;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if the tick at game->now ended a cooldown. Only those ticks move
+ *         anything, and the tick after one checks the collisions of the moves
+ * @retval True if the next tick must be played
+ */
+static bool gameBusy(GAME *game){
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+    uint64_t now = game->now;
+
+    if(archer->startTimeKeyHitLimit == now || arrow->startTimeKeyHitLimit == now) return true;
+    if(arrow->startTimeStagger == now || game->particle.startTimeStagger == now) return true;
+    switch(game->preset.levelType){
+        case balloonLevel: return balloon->startTimeStagger == now;
+        case monsterLevel: return monster->startTimeStagger == now || monster->startTimeSpawn == now;
+        case balloonScatteredLevel: {
+            for(int i=0; i < BALLOON_QUANTITY; i++){
+                if(balloon->startTimeIndividualStagger[i] == now) return true;
+            }
+        } break;
+    }
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Next tick that can change the game. The ticks before it only find the
+ *         same entities and the same cooldowns still running
+ * @retval Game time in microseconds, a whole number of ticks after game->now
+ */
+static uint64_t gameNextTick(GAME *game){
+    PRESETS *preset = &game->preset;
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+    uint64_t due;
+
+    if(gameBusy(game)) return game->now + GAME_TICK;
+
+    // every cooldown restarts when it ends, even with nothing to move
+    due = gameDue(UINT64_MAX, arrow->startTimeStagger, preset->arrowStaggerDelay);
+    if(archer->keyHitLimit) due = gameDue(due, archer->startTimeKeyHitLimit, preset->archerHitDelay);
+    if(arrow->keyHitLimit) due = gameDue(due, arrow->startTimeKeyHitLimit, preset->arrowHitDelay);
+    if(game->particle.count > 0) due = gameDue(due, game->particle.startTimeStagger, PARTICLE_FRAME_DELAY);
+    switch(preset->levelType){
+        case balloonLevel: {
+            due = gameDue(due, balloon->startTimeStagger, preset->balloonStaggerDelay);
+        } break;
+        case monsterLevel: {
+            due = gameDue(due, monster->startTimeStagger, preset->monsterStaggerDelay);
+            due = gameDue(due, monster->startTimeSpawn, preset->monsterSpawnDelay);
+        } break;
+        case balloonScatteredLevel: {
+            for(int i=0; i < BALLOON_QUANTITY; i++){
+                due = gameDue(due, balloon->startTimeIndividualStagger[i], balloon->IndividualDelay[i]);
+            }
+        } break;
+    }
+
+    if(due <= game->now + GAME_TICK) return game->now + GAME_TICK;
+    return game->now + ((due - game->now + GAME_TICK - 1) / GAME_TICK) * GAME_TICK;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the game up to a game time, one GAME_TICK after the other from
+ *         game->now. The ticks where nothing can change are skipped, so a long
+ *         stretch costs about the ticks that move something. Every entity still
+ *         moves a cell at a time, each move on its own tick with the collision
+ *         checks after it, and the game plays the same at any speed
+ * @param  time: game time to play up to
+ * @param  key: key pressed at that time or zero. It takes the last tick up to
+ *         that time, or the next one when that tick was already played
+ * @retval False if the level ended before the key was played
+ */
+bool gameAdvance(GAME *game, uint64_t time, int key){
+    uint64_t end = game->now;
+
+    if(time > game->now) end += ((time - game->now) / GAME_TICK) * GAME_TICK;
+    if(key != 0 && end > game->now) end -= GAME_TICK;
+
+    while(game->now < end){
+        uint64_t next = gameNextTick(game);
+        if(next > end){
+            game->now = end;
+            break;
+        }
+        game->now = next;
+        gameTick(game, 0);
+        if(game->player.gameOver || game->player.levelOver) return false;
+    }
+    if(key != 0){
+        game->now += GAME_TICK;
+        gameTick(game, key);
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Account the finished level and move to the next one
+ * @retval True if there is another level to play
+ */
+bool gameEndLevel(GAME *game){
+    PLAYER *player = &game->player;
+
+    player->arrowsLeft += (game->preset.arrowQuantity - game->arrow.index);
+    player->score += (player->arrowsLeft * ARROW_LEFT_POINTS);
+    //LEVELS
+    if(!player->gameOver){
+        player->level++;
+        player->levelOver = false;
+        return (player->level <= MAX_LEVEL);
+    }
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add everything on the canvas to the game layer again, after the art
+ *         changed. Cells that look the same are not sent by the renderer
+ * @param  background: new canvas background, NULL to keep it
+ * @retval None
+ */
+void gameRedraw(GAME *game, const char background[]){
+    PLAYER *player = &game->player;
+    PRESETS *preset = &game->preset;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+    PARTICLE *particle = &game->particle;
+
+    if(background != NULL){
+        for(int i=0; i < CANVAS_ROWS; i++){
+            for(int j=0; j < CANVAS_COLUMNS; j++){
+                game->layer[i][j] = background[(i * CANVAS_COLUMNS) + j];
+                game->attr[i][j] = 0;
+            }
+        }
+        // the displays are printed over the background
+        printNumberInGame(game, player->score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
+        printNumberInGame(game, player->level, LEVEL_DISPLAY_X, LEVEL_DISPLAY_Y, "%03i");
+        #if !DEBUG_MODE
+            for(int i = arrow->index; i < preset->arrowQuantity; i++){
+                game->layer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-preset->arrowQuantity)+ i] = ARROW_LEFT_DISPLAY_SYMBOL;
+            }
+        #endif
+    }
+
+    // only the visible part of each entity, see update()
+    for(int i=0; i < arrow->index; i++){
+        if(arrow->active[i]){
+            for(int j=0; j < ARROW_COLUMNS; j++){
+                game->layer[arrow->x[i]][arrow->y[i] + j] = skin.arrow[j];
+            }
+        }
+    }
+    for(int i=0; i < BALLOON_QUANTITY; i++){
+        if(balloon->active[i]){
+            for(int m=0; m < BALLOON_ROWS; m++){
+                if(balloon->x[i] + m > BALLOON_UPPER_LIMIT && balloon->x[i] + m < BALLOON_LOWER_LIMIT){
+                    setBalloon(game, i, m, m + 1, false);
+                }
+            }
+        }
+    }
+    for(int i=0; i < monster->index; i++){
+        if(monster->active[i]){
+            for(int m=0; m < MONSTER_ROWS; m++){
+                for(int n=0; n < MONSTER_COLUMNS; n++){
+                    int column = monster->y[i] + n;
+                    if(column >= MONSTER_LEFT_LIMIT && column <= MONSTER_RIGHT_LIMIT){
+                        game->layer[monster->x[i] + m][column] = skin.monster[(m * MONSTER_COLUMNS) + n];
+                        game->attr[monster->x[i] + m][column] = MONSTER_ATTR;
+                    }
+                }
+            }
+        }
+    }
+    for(int i=0; i < particle->count; i++){
+        if(!particleCellTaken(game, particle->x[i], particle->y[i])){
+            game->layer[particle->x[i]][particle->y[i]] = PARTICLE_GLYPHS[particle->frame[i]];
+            game->attr[particle->x[i]][particle->y[i]] = particle->attr[i];
+        }
+    }
+    // drawn by the next update()
+    game->archer.active = true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Configure entities characteristics based on the level
+ * @retval None
+ */
+void setLevelPreset(GAME *game){
+    PLAYER *player = &game->player;
+    PRESETS *preset = &game->preset;
+
+    if(player->level == 1){ //Reset
+        game->nBalloonLevel = 0;
+        game->nMonsterLevel = 0;
+        game->nBalloonScatteredLevel = 0;
+    }
+
+    setDifficultyPreset(game); // set the start status based on the difficulty
+    for(int i=0; i <= (MAX_LEVEL-N_LEVEL_TYPES); i+=N_LEVEL_TYPES){
+        if(player->level == (i+1)){ // BALLOON LEVEL
+            preset->levelType = balloonLevel;
+            if(game->nBalloonLevel == 0){
+                preset->balloonInitialX = BALLOON_ROW_INITIAL_X;
+            }
+            else{
+                preset->balloonInitialX = BALLOON_LOWER_LIMIT;
+            }
+            preset->balloonStaggerDelay -= game->nBalloonLevel*5;
+            preset->arrowHitDelay += game->nBalloonLevel*5;
+            preset->archerHitDelay += game->nBalloonLevel*5;
+            game->nBalloonLevel++;
+            break;
+        }
+        else if(player->level == (i+2)){ // MONSTER LEVEL
+            preset->levelType = monsterLevel;
+            preset->monsterStaggerDelay -= game->nMonsterLevel*5;
+            preset->arrowHitDelay += game->nMonsterLevel*5;
+            preset->archerHitDelay += game->nMonsterLevel*5;
+            game->nMonsterLevel++;
+            break;
+        }
+        else if(player->level == (i+3)){ // SCATTERED BALLOON LEVEL
+            preset->levelType = balloonScatteredLevel;
+            preset->balloonInitialX = BALLOON_LOWER_LIMIT;
+            preset->balloonScatteredDelayMax -= game->nBalloonScatteredLevel*5;
+            preset->balloonScatteredDelayMin -= game->nBalloonScatteredLevel*5;
+            preset->arrowHitDelay += game->nBalloonScatteredLevel*5;
+            preset->archerHitDelay += game->nBalloonScatteredLevel*5;
+            game->nBalloonScatteredLevel++;
+            break;
+        }
+    }
+
+    switch(preset->levelType){
+        case balloonLevel: case balloonScatteredLevel:{
+            preset->arrowConsumableArrows = false;
+            preset->arrowQuantity = BALLOON_ARROW_QUANTITY;
+        } break;
+        case monsterLevel:{
+            preset->arrowConsumableArrows = true;
+            preset->arrowQuantity = MONSTER_ARROW_QUANTITY;
+        } break;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check tuned delays before a game takes them, see basePreset
+ * @retval True if every delay can be played
+ * @note   The scattered balloons draw a delay between the min and the max, the
+ *         level changes shift both alike
+ */
+bool presetValid(const PRESETS *preset){
+    return preset->archerHitDelay >= 0 && preset->arrowHitDelay >= 0 && preset->arrowStaggerDelay >= 0 &&
+           preset->balloonStaggerDelay >= 0 && preset->monsterStaggerDelay >= 0 && preset->monsterSpawnDelay >= 0 &&
+           preset->balloonScatteredDelayMin >= 0 && preset->balloonScatteredDelayMin < preset->balloonScatteredDelayMax;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Configure entity characteristics based on the difficulty
+ * @retval None
+ */
+void setDifficultyPreset(GAME *game){
+    PRESETS *preset = &game->preset;
+    const PRESETS *base = game->basePreset;
+
+    // tuned delays replace the difficulty defines
+    if(base != NULL){
+        preset->archerHitDelay = base->archerHitDelay;
+        preset->arrowHitDelay = base->arrowHitDelay;
+        preset->arrowStaggerDelay = base->arrowStaggerDelay;
+        preset->balloonStaggerDelay = base->balloonStaggerDelay;
+        preset->balloonScatteredDelayMax = base->balloonScatteredDelayMax;
+        preset->balloonScatteredDelayMin = base->balloonScatteredDelayMin;
+        preset->monsterStaggerDelay = base->monsterStaggerDelay;
+        preset->monsterSpawnDelay = base->monsterSpawnDelay;
+        printStringInGame(game, "Custom", 1, 8);
+        return;
+    }
+
+    switch(game->player.difficulty){
+        case easy: {
+            preset->archerHitDelay = E_ARCHER_HIT_DELAY;
+            preset->arrowHitDelay = E_ARROW_HIT_DELAY;
+            preset->arrowStaggerDelay = E_ARROW_STAGGER_DELAY;
+            preset->balloonStaggerDelay = E_BALLOON_STAGGER_DELAY;
+            preset->balloonScatteredDelayMax = E_BALLOON_SCATTERED_DELAY_MAX;
+            preset->balloonScatteredDelayMin = E_BALLOON_SCATTERED_DELAY_MIN;
+            preset->monsterStaggerDelay = E_MONSTER_STAGGER_DELAY;
+            preset->monsterSpawnDelay = E_MONSTER_SPAWN_DELAY;
+            printStringInGame(game, "Easy", 1, 8);
+        } break;
+        case normal:{
+            preset->archerHitDelay = M_ARCHER_HIT_DELAY;
+            preset->arrowHitDelay = M_ARROW_HIT_DELAY;
+            preset->arrowStaggerDelay = M_ARROW_STAGGER_DELAY;
+            preset->balloonStaggerDelay = M_BALLOON_STAGGER_DELAY;
+            preset->balloonScatteredDelayMax = M_BALLOON_SCATTERED_DELAY_MAX;
+            preset->balloonScatteredDelayMin = M_BALLOON_SCATTERED_DELAY_MIN;
+            preset->monsterStaggerDelay = M_MONSTER_STAGGER_DELAY;
+            preset->monsterSpawnDelay = M_MONSTER_SPAWN_DELAY;
+            printStringInGame(game, "Normal", 1, 8);
+
+        } break;
+        case hard:{
+            preset->archerHitDelay = H_ARCHER_HIT_DELAY;
+            preset->arrowHitDelay = H_ARROW_HIT_DELAY;
+            preset->arrowStaggerDelay = H_ARROW_STAGGER_DELAY;
+            preset->balloonStaggerDelay = H_BALLOON_STAGGER_DELAY;
+            preset->balloonScatteredDelayMax = H_BALLOON_SCATTERED_DELAY_MAX;
+            preset->balloonScatteredDelayMin = H_BALLOON_SCATTERED_DELAY_MIN;
+            preset->monsterStaggerDelay = H_MONSTER_STAGGER_DELAY;
+            preset->monsterSpawnDelay = H_MONSTER_SPAWN_DELAY;
+            printStringInGame(game, "Hard", 1, 8);
+        } break;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Update entities movements
+ * @retval None
+ */
+void update(GAME *game){
+    PRESETS *preset = &game->preset;
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+    MONSTER *monster = &game->monster;
+
+    // Arrow
+    if(arrow->activeIndex > 0 && !arrow->stagger){
+        for(int i=0; i < arrow->index; i++){
+            if(arrow->active[i] && (arrow->y[i] < ARROW_RIGHT_LIMIT ) ){
+                game->layer[arrow->x[i]][arrow->y[i]] = ' ';
+                arrow->y[i]++;
+
+                for(int j=0; j < ARROW_COLUMNS; j++){
+                    game->layer[arrow->x[i]][arrow->y[i] + j] = skin.arrow[j];
+                }
+            }
+            else if(arrow->active[i]){
+                arrow->active[i] = false;
+                for(int j=0; j < ARROW_COLUMNS; j++){
+                    game->layer[arrow->x[i]][arrow->y[i] + j] = ' ';
+                }
+                arrow->activeIndex--;
+            }
+        }
+    }
+    if(arrow->activeIndex == 0 && arrow->index == preset->arrowQuantity && (balloon->activeIndex > 0 || monster->activeIndex > 0)){
+        game->player.gameOver = true;
+    }
+
+    // Baloon
+    if(preset->levelType == balloonLevel || preset->levelType == balloonScatteredLevel){
+        if(balloon->activeIndex > 0 && !balloon->stagger){
+            for(int i=0; i < BALLOON_QUANTITY; i++){
+                if(balloon->active[i] && !balloon->individualStagger[i]){
+                    balloon->x[i]--;
+                    if(balloon->x[i] < (BALLOON_LOWER_LIMIT - BALLOON_ROWS)){
+                        for(int i2=0; i2 <= BALLOON_ROWS; i2++){
+                            if(balloon->x[i] > BALLOON_UPPER_LIMIT - i2){
+                                setBalloon(game, i, i2, BALLOON_ROWS, true);
+                                break;
+                            }
+                            else if(i2 == BALLOON_ROWS) balloon->x[i] = BALLOON_LOWER_LIMIT - 1; //this one is why i3=1
+                        }
+                    }
+                    //can't be else!**
+                    if(balloon->x[i] >= (BALLOON_LOWER_LIMIT - BALLOON_ROWS)){
+                        for(int i3=1; i3 <= BALLOON_ROWS; i3++){
+                            if(balloon->x[i] == (BALLOON_LOWER_LIMIT - i3)){
+                                setBalloon(game, i, 0, i3, false);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if(balloon->activeIndex == 0 && arrow->activeIndex == 0){
+            game->player.levelOver = true;
+        }
+    }
+
+    // Monster
+    if(preset->levelType == monsterLevel){
+        if(monster->activeIndex > 0 && !monster->stagger){
+            for(int i=0; i < monster->index; i++){
+                if(monster->active[i]){
+                    monster->y[i]--;
+                    //appearing from the right
+                    if(monster->y[i] > (MONSTER_RIGHT_LIMIT - MONSTER_COLUMNS)){
+                        for(int i2=1; i2 <= MONSTER_COLUMNS; i2++){
+                            if(monster->y[i] > (MONSTER_RIGHT_LIMIT - i2)){
+                                setMonster(game, i, 0, i2, false);
+                                break;
+                            }
+                        }
+                    }
+                    //in the middle of the screen
+                    else if(monster->y[i] >= (MONSTER_LEFT_LIMIT)){
+                        setMonster(game, i, 0, MONSTER_COLUMNS, true);
+                    }
+                    //disappearing from the left
+                    else{ // < MONSTER_LEFT_LIMIT
+                        for(int i3=0, i4=1; i3 > -MONSTER_COLUMNS; i3--, i4++){
+                            if(monster->y[i] == i3){
+
+                                for(int m=0; m < MONSTER_ROWS; m++){
+                                    for (int n=0, aux=i4; aux < MONSTER_COLUMNS; n++, aux++){
+                                        game->layer[monster->x[i] + m][MONSTER_LEFT_LIMIT + n] = skin.monster[(m * MONSTER_COLUMNS) + aux];
+                                        game->attr[monster->x[i] + m][MONSTER_LEFT_LIMIT + n] = MONSTER_ATTR;
+                                    }
+                                }
+                                for(int j=0; j < MONSTER_ROWS; j++){
+                                    game->layer[monster->x[i] + j][MONSTER_COLUMNS+(i3)] = ' ';
+                                }
+                                if(i3 == -MONSTER_COLUMNS + 1){//turn off monster
+                                    monster->active[i] = false;
+                                    monster->activeIndex--;
+                                }
+                                break;
+                            }
+
+                        }
+                    }
+                }
+            }
+        }
+        if(monster->activeIndex == 0 && monster->index == MONSTER_QUANTITY && arrow->activeIndex == 0){
+            game->player.levelOver = true;
+        }
+    }
+
+    // Archer
+    if(archer->active){
+        for(int i=0; i < ARCHER_ROWS; i++){
+            for(int j=0; j < ARCHER_COLUMNS; j++){
+                game->layer[archer->x + i][archer->y + j] = skin.archer[(i*ARCHER_COLUMNS) + j];
+            }
+        }
+        archer->active = false;
+    }
+
+}
+//**************************************************************************************
+
+
+/**
+ * @brief  Detect monsters collisions
+ * @retval None
+ */
+void hitMonsterDetector(GAME *game){
+    ARROW *arrow = &game->arrow;
+    MONSTER *monster = &game->monster;
+
+    if(arrow->activeIndex > 0 && monster->activeIndex >0){
+        for(int i=0; i < arrow->index; i++){
+            if(arrow->active[i]){
+                for(int j=0; j < monster->index; j++){
+                    if(monster->active[j]){
+                        // Y hitbox check
+                        for(int m=0; m < MONSTER_COLUMNS; m++){
+                            if(arrow->y[i] + ARROW_COLUMNS == monster->y[j] + m){
+                                // X hitbox check
+                                for(int n=0; n < MONSTER_ROWS; n++){
+                                    if(arrow->x[i] == monster->x[j] + n){
+                                        if(game->preset.arrowConsumableArrows){
+                                            arrow->active[i] = false;
+                                            for(int a=0; a < ARROW_COLUMNS; a++){
+                                                game->layer[arrow->x[i]][arrow->y[i] + a] = ' ';
+                                            }
+                                            arrow->activeIndex--;
+                                        }
+                                        for(int m1=0; m1 < MONSTER_ROWS; m1++){
+                                            for(int m2=0; m2 < MONSTER_COLUMNS; m2++){
+                                                if((monster->y[j] + m2) < CANVAS_RIGHT_EDGE_Y){ //border limit
+                                                    game->layer[monster->x[j] + m1][monster->y[j] + m2] = ' ';
+                                                }
+                                            }
+                                        }
+                                        monster->active[j] = false;
+                                        monster->activeIndex--;
+                                        particleBurst(game, monster->x[j], monster->y[j], MONSTER_ROWS, MONSTER_COLUMNS, MONSTER_ATTR);
+                                        game->player.monstersKilled++;
+                                        //score
+                                        game->player.score += MONSTER_POINTS;
+                                        printNumberInGame(game, game->player.score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
+                                        break;
+                                    }
+                                }
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Detect archer collisions
+ * @retval True if hit detected
+ */
+bool hitArcherDetector(GAME *game){
+    ARCHER *archer = &game->archer;
+    MONSTER *monster = &game->monster;
+
+    if(monster->activeIndex > 0){
+        for(int i=0; i < monster->index; i++){
+            if(monster->active[i]){
+                if(monster->y[i] < (ARCHER_COLUMNS+ARCHER_INITIAL_Y)){// Y hitbox 1
+                    //now just check the X hitbox
+                    for(int m=0; m < MONSTER_ROWS; m++){
+                        for(int a=0; a < ARCHER_ROWS; a++){
+                            if((monster->x[i] + m) == (archer->x + a)){
+                                // Y hitbox 2 <- more precision
+                                for(int m2=0; m2 < MONSTER_COLUMNS; m2++){
+                                    for(int a2=0; a2 < ARCHER_COLUMNS; a2++){
+                                        if((monster->y[i] + m2) == (archer->y + a2)){
+                                            if(skin.monster[(m * MONSTER_COLUMNS) + m2] != ' ' && skin.archer[(a * ARCHER_COLUMNS) + a2] != ' '){
+                                                return true;
+                                            }
+                                        }
+                                    }
+                                }
+                                if(!archer->active) archer->active = true; //keep archer fresh even if it's not moving
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return false;
+
+}
+//**************************************************************************************
+
+/**
+ * @brief  Detect baloons collisions
+ * @retval None
+ */
+void hitBalloonDetector(GAME *game){
+    ARROW *arrow = &game->arrow;
+    BALLOON *balloon = &game->balloon;
+
+    if(arrow->activeIndex > 0 && balloon->activeIndex >0){
+        for(int i=0; i < arrow->index; i++){
+            if(arrow->active[i]){
+                for(int j=0; j < BALLOON_QUANTITY; j++){
+                    if(balloon->active[j]){
+                        // Y hitbox check
+                        for(int m=0; m < BALLOON_COLUMNS; m++){
+                            if(arrow->y[i] + ARROW_COLUMNS == balloon->y[j] + m){
+                                // X hitbox check
+                                for(int n=0; n < BALLOON_ROWS; n++){
+                                    if(arrow->x[i] == balloon->x[j] + n){
+                                        if(game->preset.arrowConsumableArrows){
+                                            arrow->active[i] = false;
+                                            for(int a=0; a < ARROW_COLUMNS; a++){
+                                                game->layer[arrow->x[i]][arrow->y[i] + a] = ' ';
+                                            }
+                                            arrow->activeIndex--;
+                                        }
+                                        for(int b1=0; b1 < BALLOON_ROWS; b1++){
+                                            for(int b2=0; b2 < BALLOON_COLUMNS; b2++){
+                                                game->layer[balloon->x[j] + b1][balloon->y[j] + b2] = ' ';
+                                            }
+                                        }
+                                        balloon->active[j] = false;
+                                        balloon->activeIndex--;
+                                        particleBurst(game, balloon->x[j], balloon->y[j], BALLOON_ROWS, BALLOON_COLUMNS, BALLOON_ATTR);
+                                        game->player.balloonsDestroyed++;
+                                        //score
+                                        game->player.score += BALLOON_POINTS;
+                                        printNumberInGame(game, game->player.score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
+                                        break;
+                                    }
+                                }
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add a integer number to the game layer
+ * @retval None
+ */
+void printNumberInGame(GAME *game, int value, int x, int y, char format[4]){
+    char buf[12] = {0}; // room for any int, only 10 are drawn
+    snprintf(buf, sizeof(buf),format, value);
+    for(int index=0; index < 10; index++){
+        if(buf[index] != '\0') game->layer[x][y + index] = buf[index];
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add a string to the game layer
+ * @retval None
+ */
+void printStringInGame(GAME *game, char *string, int x, int y){
+    char buf[10] = {0};
+    snprintf(buf, sizeof(buf),"%s", string);
+    for(int index=0; index < 10; index++){
+        if(buf[index] != '\0') game->layer[x][y + index] = buf[index];
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add monsters to the game layer
+ * @retval None
+ */
+void setMonster(GAME *game, int i, int startColumn, int endColumn, bool clean){
+    MONSTER *monster = &game->monster;
+
+    for(int m=0; m < MONSTER_ROWS; m++){
+        for (int n=startColumn; n < endColumn; n++){
+            game->layer[monster->x[i] + m][monster->y[i] + n] = skin.monster[(m * MONSTER_COLUMNS) + n];
+            game->attr[monster->x[i] + m][monster->y[i] + n] = MONSTER_ATTR;
+        }
+    }
+    if(clean){
+        for(int j=0; j < MONSTER_ROWS; j++){
+            game->layer[monster->x[i] + j][monster->y[i] + MONSTER_COLUMNS] = ' ';
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add baloons to the game layer
+ * @retval None
+ */
+void setBalloon(GAME *game, int  i, int startRow, int endRow, bool clean){
+    BALLOON *balloon = &game->balloon;
+
+    for(int m=startRow; m < endRow; m++){
+        for(int n=0; n < BALLOON_COLUMNS; n++){
+            game->layer[balloon->x[i] + m][balloon->y[i] + n] = skin.balloon[(m * BALLOON_COLUMNS) + n];
+            game->attr[balloon->x[i] + m][balloon->y[i] + n] = BALLOON_ATTR;
+        }
+    }
+    if(clean){
+        for(int j=0; j < BALLOON_COLUMNS; j++){
+            game->layer[balloon->x[i] + BALLOON_ROWS][balloon->y[i] + j] = ' ';
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move archer upwards
+ * @retval None
+ */
+void archerMovUp(GAME *game){
+    ARCHER *archer = &game->archer;
+
+    if(gameTimeDiff(game, archer->startTimeKeyHitLimit) >= game->preset.archerHitDelay) archer->startTimeKeyHitLimit = game->now;
+    if(!archer->keyHitLimit){
+        if(archer->x > ARCHER_UPPER_LIMIT){
+            for(int i=0; i < ARCHER_COLUMNS; i++){
+                game->layer[archer->x + ARCHER_ROWS-1][archer->y + i] = ' ';
+            }
+            archer->x--;
+            archer->active = true;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move archer downwards
+ * @retval None
+ */
+void archerMovDown(GAME *game){
+    ARCHER *archer = &game->archer;
+
+    if(gameTimeDiff(game, archer->startTimeKeyHitLimit) >= game->preset.archerHitDelay) archer->startTimeKeyHitLimit = game->now;
+    if(!archer->keyHitLimit){
+        if(archer->x < ARCHER_LOWER_LIMIT){
+            for(int i=0; i < ARCHER_COLUMNS; i++){
+                game->layer[archer->x][archer->y + i] = ' ';
+            }
+            archer->x++;
+            archer->active = true;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move arrows
+ * @retval None
+ */
+void arrowShoot(GAME *game){
+    PRESETS *preset = &game->preset;
+    ARCHER *archer = &game->archer;
+    ARROW *arrow = &game->arrow;
+
+    if(gameTimeDiff(game, arrow->startTimeKeyHitLimit) >= preset->arrowHitDelay) arrow->startTimeKeyHitLimit = game->now;
+    if(!arrow->keyHitLimit){
+        if(arrow->index < preset->arrowQuantity){
+             // Decrease arrows left from display
+            if(!DEBUG_MODE)
+            {
+                game->layer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-preset->arrowQuantity) + arrow->index] = ' ';
+            }
+
+            arrow->active[arrow->index] = true;
+            arrow->activeIndex++;
+            arrow->x[arrow->index] = archer->x + 1;
+            arrow->y[arrow->index] = archer->y + ARCHER_COLUMNS;
+
+            for(int i=0; i < ARROW_COLUMNS; i++){
+                game->layer[ arrow->x[arrow->index] ][ arrow->y[arrow->index] + i] = skin.arrow[i];
+            }
+            arrow->index++;
+
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Keyboard pressing cooldown
+ * @retval False if in cooldown
+ */
+bool keyHitControl(GAME *game, uint64_t startTime, double delay){
+    if(gameTimeDiff(game, startTime) >= delay){
+        return false;
+    }
+    else{
+        return true;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Entity movement cooldown
+ * @retval False if in cooldown
+ */
+bool staggerControl(GAME *game, uint64_t *startTime, double delay){
+
+    if(gameTimeDiff(game, *startTime) >= delay){
+        *startTime = game->now;
+        return false;
+    }
+    else{
+        return true;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Scattered balloons movement cooldown
+ * @retval None
+ */
+void staggerControlScatteredBalloon(GAME *game){
+    BALLOON *balloon = &game->balloon;
+
+    for(int i=0; i < BALLOON_QUANTITY; i++){
+        if(gameTimeDiff(game, balloon->startTimeIndividualStagger[i]) >= balloon->IndividualDelay[i]){
+            balloon->startTimeIndividualStagger[i] = game->now;
+            balloon->individualStagger[i] = false;
+        }
+        else{
+            balloon->individualStagger[i] = true;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Set baloons initial position
+ * @retval None
+ */
+void setBalloonFirstRowPosition(GAME *game){
+    BALLOON *balloon = &game->balloon;
+
+    balloon->activeIndex = BALLOON_QUANTITY;
+    for(int i=0; i < BALLOON_QUANTITY; i++){
+        balloon->x[i] = game->preset.balloonInitialX;
+        balloon->y[i] = BALLOON_ROW_INITIAL_Y + (i * (BALLOON_COLUMNS + 1));
+        balloon->active[i] = true;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Set scattered baloons initial position
+ * @retval None
+ */
+void setBalloonScatteredPostition(GAME *game){
+    PRESETS *preset = &game->preset;
+    BALLOON *balloon = &game->balloon;
+
+    int max2 = preset->balloonScatteredDelayMax - preset->balloonScatteredDelayMin;
+
+    balloon->activeIndex = BALLOON_QUANTITY;
+    for(int i=0; i < BALLOON_QUANTITY; i++){
+        balloon->x[i] = preset->balloonInitialX;
+        balloon->y[i] = BALLOON_ROW_INITIAL_Y + (i * (BALLOON_COLUMNS + 1));
+        balloon->active[i] = true;
+        balloon->IndividualDelay[i] = preset->balloonScatteredDelayMin +  ( (gameRandom(game) % max2)  + 1);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Set monsters initial position
+ * @retval None
+ */
+void setMonsterFirstPosition(GAME *game){
+    MONSTER *monster = &game->monster;
+
+    int max = MONSTER_LOWER_LIMIT - MONSTER_UPPER_LIMIT;
+
+    for(int i=0; i < MONSTER_QUANTITY; i++){
+        monster->x[i] = MONSTER_UPPER_LIMIT + ( (gameRandom(game) % max)  + 1);
+        monster->y[i] = MONSTER_INITIAL_Y;
+    }
+
+}
+//**************************************************************************************
+
+/**
+ * @brief  Monster spawn cooldown
+ * @retval False if in cooldown
+ */
+bool spawnRateMonster(GAME *game, double delay){
+    MONSTER *monster = &game->monster;
+
+    if(gameTimeDiff(game, monster->startTimeSpawn) >= delay){
+
+        if(monster->index < MONSTER_QUANTITY){
+            monster->active[monster->index] = true;
+            monster->activeIndex++;
+            monster->index++;
+        }
+        monster->startTimeSpawn = game->now;
+        return true;
+    }
+    else{
+        return false;
+    }
+
+}
+//**************************************************************************************
+
+/**
+ * @brief  Throw debris out of the center of a hit entity. A burst that doesn't
+ *         fit in the pool is dropped, so a tick never costs more than a full pool
+ * @param  x, y: top left cell of the entity
+ * @param  rows, columns: entity size
+ * @param  attr: debris color
+ * @retval None
+ */
+void particleBurst(GAME *game, int x, int y, int rows, int columns, ATTR attr){
+    PARTICLE *particle = &game->particle;
+
+    if(particle->count + PARTICLE_BURST > PARTICLE_CAPACITY) return;
+    // the first frame lasts a full delay
+    if(particle->count == 0) particle->startTimeStagger = game->now;
+
+    for(int i=0; i < PARTICLE_BURST; i++){
+        int n = particle->count;
+        int px = x + (rows / 2) + particleDirection[i][0];
+        int py = y + (columns / 2) + particleDirection[i][1];
+
+        if(!particleInField(px, py)) continue;
+        particle->x[n] = (int8_t) px;
+        particle->y[n] = (int8_t) py;
+        particle->dx[n] = particleDirection[i][0];
+        particle->dy[n] = particleDirection[i][1];
+        particle->frame[n] = 0;
+        particle->attr[n] = attr;
+        particle->count++;
+        if(!particleCellTaken(game, px, py)){
+            game->layer[px][py] = PARTICLE_GLYPHS[0];
+            game->attr[px][py] = attr;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move the debris outwards and step its animation
+ * @retval None
+ */
+void particleUpdate(GAME *game){
+    PARTICLE *particle = &game->particle;
+
+    if(particle->count == 0 || staggerControl(game, &particle->startTimeStagger, PARTICLE_FRAME_DELAY)) return;
+
+    // erase every particle before drawing any, two of them may swap cells
+    for(int i=0; i < particle->count; i++){
+        if(!particleCellTaken(game, particle->x[i], particle->y[i])){
+            game->layer[particle->x[i]][particle->y[i]] = ' ';
+            game->attr[particle->x[i]][particle->y[i]] = 0;
+        }
+    }
+    for(int i=0; i < particle->count; i++){
+        int x = particle->x[i] + particle->dx[i];
+        int y = particle->y[i] + particle->dy[i];
+        int frame = particle->frame[i] + 1;
+
+        if(frame == PARTICLE_FRAMES || !particleInField(x, y)){
+            int last = --particle->count;
+            particle->x[i] = particle->x[last];
+            particle->y[i] = particle->y[last];
+            particle->dx[i] = particle->dx[last];
+            particle->dy[i] = particle->dy[last];
+            particle->frame[i] = particle->frame[last];
+            particle->attr[i] = particle->attr[last];
+            i--; // the last one takes this place, look at it again
+            continue;
+        }
+        particle->x[i] = (int8_t) x;
+        particle->y[i] = (int8_t) y;
+        particle->frame[i] = (uint8_t) frame;
+        if(!particleCellTaken(game, x, y)){
+            game->layer[x][y] = PARTICLE_GLYPHS[frame];
+            game->attr[x][y] = particle->attr[i];
+        }
+    }
+}
+//**************************************************************************************
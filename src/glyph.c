@@ -0,0 +1,298 @@
+/*******************************************************************************
+* @filename: glyph.c
+* @brief: UTF-8 glyphs of the ASCII Art, every glyph is encoded once at load
+*         time and cells carry a one byte ID
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "include/glyph.h"
+
+GLYPH glyphTable[GLYPH_COUNT];
+
+// extended IDs given so far
+static int nExtended = 0;
+
+/**
+ * @brief  Decode one UTF-8 sequence
+ * @param  text: UTF-8 text
+ * @param  len: bytes available
+ * @param  used: bytes of the sequence
+ * @retval The code point, -1 if the bytes aren't UTF-8
+ */
+static long glyph_code_point(const unsigned char *text, int len, int *used)
+{
+    long cp;
+    int n;
+
+    *used = 1;
+    if (text[0] < 0x80)
+    {
+        return text[0];
+    }
+    else if ((text[0] & 0xE0) == 0xC0)
+    {
+        cp = text[0] & 0x1F;
+        n = 2;
+    }
+    else if ((text[0] & 0xF0) == 0xE0)
+    {
+        cp = text[0] & 0x0F;
+        n = 3;
+    }
+    else if ((text[0] & 0xF8) == 0xF0)
+    {
+        cp = text[0] & 0x07;
+        n = 4;
+    }
+    else
+    {
+        return -1;
+    }
+
+    if (n > len)
+    {
+        return -1;
+    }
+    for (int i = 1; i < n; i++)
+    {
+        if ((text[i] & 0xC0) != 0x80)
+        {
+            return -1;
+        }
+        cp = (cp << 6) | (text[i] & 0x3F);
+    }
+    *used = n;
+    return cp;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Columns a code point takes on a terminal
+ * @retval Zero for the marks combined with the glyph before them, 2 for the
+ *         East Asian wide ranges and emoji, 1 otherwise
+ */
+static int glyph_columns(long cp)
+{
+    if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) || (cp >= 0x1DC0 && cp <= 0x1DFF) ||
+        (cp >= 0x200B && cp <= 0x200F) || (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+        (cp >= 0xFE20 && cp <= 0xFE2F))
+    {
+        return 0;
+    }
+    if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF && cp != 0x303F) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+        (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+        (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) || (cp >= 0x1F900 && cp <= 0x1F9FF) ||
+        (cp >= 0x20000 && cp <= 0x3FFFD))
+    {
+        return 2;
+    }
+    return 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start decoding art from the registered glyphs
+ * @param  scratch: glyphs of the art, see glyph_register()
+ * @retval None
+ */
+void glyph_scratch(GLYPH_SCRATCH *scratch)
+{
+    memcpy(&scratch->glyph[GLYPH_FIRST_EXTENDED], &glyphTable[GLYPH_FIRST_EXTENDED], nExtended * sizeof(GLYPH));
+    scratch->count = nExtended;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read one glyph of UTF-8 text and give it an ID
+ * @param  scratch: glyphs known so far, a new one is added
+ * @param  text: UTF-8 text
+ * @param  len: bytes available, at least one
+ * @param  id: glyph ID read
+ * @retval The number of bytes used
+ * @note   Combining marks stay with the glyph before them. The same bytes
+ *         always get the same ID, new ones take the next free extended ID
+ */
+int glyph_decode(GLYPH_SCRATCH *scratch, const char *text, int len, char *id)
+{
+    const unsigned char *bytes = (const unsigned char *) text;
+    int used, markLen;
+    long cp = glyph_code_point(bytes, len, &used);
+
+    if (cp < 0)
+    {
+        *id = GLYPH_INVALID;
+        return used;
+    }
+    int width = glyph_columns(cp);
+
+    // marks drawn over the glyph
+    while (used < len)
+    {
+        long mark = glyph_code_point(bytes + used, len - used, &markLen);
+        if (mark < 0 || glyph_columns(mark) != 0 || used + markLen > GLYPH_MAX_BYTES)
+        {
+            break;
+        }
+        used += markLen;
+    }
+
+    if (used == 1)
+    {
+        *id = (cp == GLYPH_WIDE_TAIL) ? GLYPH_INVALID : (char) cp;
+        return used;
+    }
+
+    for (int i = GLYPH_FIRST_EXTENDED; i < GLYPH_FIRST_EXTENDED + scratch->count; i++)
+    {
+        if (scratch->glyph[i].len == used && memcmp(scratch->glyph[i].bytes, text, used) == 0)
+        {
+            *id = (char) i;
+            return used;
+        }
+    }
+    if (GLYPH_FIRST_EXTENDED + scratch->count >= GLYPH_COUNT)
+    {
+        *id = GLYPH_INVALID;
+        return used;
+    }
+
+    GLYPH *glyph = &scratch->glyph[GLYPH_FIRST_EXTENDED + scratch->count];
+    memcpy(glyph->bytes, text, used);
+    glyph->len = used;
+    // a lone mark still takes its cell
+    glyph->width = (width == 0) ? 1 : width;
+    *id = (char) (GLYPH_FIRST_EXTENDED + scratch->count++);
+    return used;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read a whole piece of UTF-8 art into cells
+ * @param  scratch: glyphs known so far, the new ones of the art are added
+ * @param  text: UTF-8 text, one line per row, "\n" or "\r\n" line ends
+ * @param  cells: rows * columns glyph IDs read, a wide glyph takes two
+ * @param  line: first line that doesn't fit, from one, when it fails
+ * @retval True if the art has exactly the rows and columns given
+ */
+bool glyph_decode_art(GLYPH_SCRATCH *scratch, const char *text, long len, char cells[], int rows, int columns, int *line)
+{
+    int row = 0, column = 0;
+    char id;
+
+    for (long i = 0; i < len; )
+    {
+        if (text[i] == '\r')
+        {
+            i++;
+            continue;
+        }
+        if (text[i] == '\n')
+        {
+            // a short line would shift the rest of the art
+            if (column != columns)
+            {
+                *line = row + 1;
+                return false;
+            }
+            row++;
+            column = 0;
+            i++;
+            continue;
+        }
+
+        i += glyph_decode(scratch, &text[i], len - i, &id);
+        int width = GLYPH_IS_EXTENDED(id) ? scratch->glyph[(unsigned char) id].width : 1;
+        if (row >= rows || column + width > columns)
+        {
+            *line = row + 1;
+            return false;
+        }
+        cells[(row * columns) + column++] = id;
+        if (width == 2)
+        {
+            cells[(row * columns) + column++] = GLYPH_WIDE_TAIL;
+        }
+    }
+
+    // the last line may end without a line break
+    if (column == columns)
+    {
+        row++;
+    }
+    else if (column != 0)
+    {
+        *line = row + 1;
+        return false;
+    }
+    if (row != rows)
+    {
+        *line = row + 1;
+        return false;
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add the new glyphs of some art to the glyph table, before the art
+ *         is used
+ * @param  scratch: started from the glyphs registered now, see glyph_scratch()
+ * @retval None
+ * @note   Only the entries past the registered ones are written, a frame
+ *         published afterwards carries their IDs to the render thread
+ */
+void glyph_register(const GLYPH_SCRATCH *scratch)
+{
+    memcpy(&glyphTable[GLYPH_FIRST_EXTENDED + nExtended], &scratch->glyph[GLYPH_FIRST_EXTENDED + nExtended],
+           (scratch->count - nExtended) * sizeof(GLYPH));
+    nExtended = scratch->count;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Fill the glyph table with glyphs read before, e.g. by the art
+ *         compiler, so the art cells keep their IDs
+ * @param  glyphs: extended glyphs in ID order
+ * @retval None
+ */
+void glyph_preload(const GLYPH glyphs[], int count)
+{
+    if (count > GLYPH_COUNT - GLYPH_FIRST_EXTENDED)
+    {
+        count = GLYPH_COUNT - GLYPH_FIRST_EXTENDED;
+    }
+    memcpy(&glyphTable[GLYPH_FIRST_EXTENDED], glyphs, count * sizeof(GLYPH));
+    nExtended = count;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print a glyph with stdio
+ * @param  id: glyph ID
+ * @retval The number of bytes printed
+ */
+int glyph_print(char id)
+{
+    if (GLYPH_IS_EXTENDED(id))
+    {
+        return fwrite(GLYPH(id)->bytes, 1, GLYPH(id)->len, stdout);
+    }
+    if (id == '\0' || id == GLYPH_WIDE_TAIL)
+    {
+        return 0;
+    }
+    return (putchar(id) == EOF) ? 0 : 1;
+}
+//**************************************************************************************
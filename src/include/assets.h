@@ -0,0 +1,163 @@
+/*******************************************************************************
+* @filename: assets.h
+* @brief: assets.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef ASSETS_H
+#define ASSETS_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+#include "glyph.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// ----------- HIGH SCORES PROMPT -----------
+#define HIGH_SCORES_PROMPT_ROWS 7
+#define HIGH_SCORES_PROMPT_COLUMNS 37
+#define HIGH_SCORES_PROMPT_X 10
+#define HIGH_SCORES_PROMPT_Y 24
+#define HIGH_SCORES_PROMPT_FILE "prompts" FILE_SEPARATOR "highscores_prompt"
+
+// ----------- GAMEOVER PROMPT -----------
+#define GAMEOVER_PROMPT_ROWS 15
+#define GAMEOVER_PROMPT_COLUMNS 65
+#define GAMEOVER_PROMPT_X 7
+#define GAMEOVER_PROMPT_Y 8
+#define GAMEOVER_PROMPT_FILE "prompts" FILE_SEPARATOR "gameover_prompt"
+
+// ----------- QUITGAME PROMPT -----------
+#define QUITGAME_PROMPT_ROWS 7
+#define QUITGAME_PROMPT_COLUMNS 37
+#define QUITGAME_PROMPT_X 10
+#define QUITGAME_PROMPT_Y 24
+#define QUITGAME_PROMPT_FILE "prompts" FILE_SEPARATOR "quitgame_prompt"
+
+// ----------- HIGHSCORES MENU -----------
+#define HIGHSCORES_MENU_ROWS 14
+#define HIGHSCORES_MENU_COLUMNS 53
+#define HIGHSCORES_MENU_X 7
+#define HIGHSCORES_MENU_Y 14
+#define HIGHSCORES_MENU_FILE "backgrounds" FILE_SEPARATOR "highscores_menu"
+
+// ----------- OPTIONS MENU -----------
+#define OPTIONS_MENU_ROWS 21
+#define OPTIONS_MENU_COLUMNS 70
+#define OPTIONS_MENU_X 7
+#define OPTIONS_MENU_Y 6
+#define ARROW_OPTIONS_MENU_INITIAL_X 12
+#define ARROW_OPTIONS_MENU_INITIAL_Y 20
+#define ARROW_OPTIONS_MENU_UPPER_LIMIT_X 12
+#define ARROW_OPTIONS_MENU_BOTTOM_LIMIT_X 19
+#define OPTIONS_MENU_FILE "backgrounds" FILE_SEPARATOR "options_menu"
+
+// ----------- MAIN MENU -----------
+#define MAIN_MENU_COLUMNS 81
+#define MAIN_MENU_ROWS 35
+#define ARROW_MAIN_MENU_INITIAL_POSITION_X 17
+#define ARROW_MAIN_MENU_INITIAL_POSITION_Y 34
+#define ARROW_MAIN_MENU_UPPER_LIMIT_X 17
+#define ARROW_MAIN_MENU_BOTTOM_LIMIT_X 20
+#define ARROW_MENU_COLUMNS 2
+#define MAIN_MENU_FILE "backgrounds" FILE_SEPARATOR "main_menu"
+
+// Directory the art is read from instead of the compiled in copy
+#define ART_DIR_ENV "BOW_ART_DIR"
+#define ART_DIR_DEFAULT "ascii_art" // read by the art compiler
+
+// ----------- HOT RELOAD -----------
+#define ASSET_BIT(asset) (1u << (asset))
+// art drawn on the game canvas
+#define ASSET_GAME_MASK (ASSET_BIT(assetGame) | ASSET_BIT(assetArcher) | ASSET_BIT(assetArrow) | ASSET_BIT(assetBalloon) | ASSET_BIT(assetMonster))
+#define ASSET_WATCH_BUFFER 4096 // bytes of change events read at once
+
+// ----------- ART FILES -----------
+// X(asset, art, rows, columns, file) for each art file, expanded into enum
+// assetType, the loader table in assets.c and the art compiler table
+#define ASSET_LIST(X) \
+    X(assetOptionsMenu, backGround.optionsMenu, OPTIONS_MENU_ROWS, OPTIONS_MENU_COLUMNS, OPTIONS_MENU_FILE) \
+    X(assetMainMenu, backGround.mainMenu, MAIN_MENU_ROWS, MAIN_MENU_COLUMNS, MAIN_MENU_FILE) \
+    X(assetHighScoresMenu, backGround.highScores, HIGHSCORES_MENU_ROWS, HIGHSCORES_MENU_COLUMNS, HIGHSCORES_MENU_FILE) \
+    X(assetGame, backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, CANVAS_SKIN_FILE) \
+    X(assetArcher, skin.archer, ARCHER_ROWS, ARCHER_COLUMNS, ARCHER_SKIN_FILE) \
+    X(assetArrow, skin.arrow, ARROW_ROWS, ARROW_COLUMNS, ARROW_SKIN_FILE) \
+    X(assetBalloon, skin.balloon, BALLOON_ROWS, BALLOON_COLUMNS, BALLOON_SKIN_FILE) \
+    X(assetMonster, skin.monster, MONSTER_ROWS, MONSTER_COLUMNS, MONSTER_SKIN_FILE) \
+    X(assetHighScoresPrompt, prompt.highScoresPrompt, HIGH_SCORES_PROMPT_ROWS, HIGH_SCORES_PROMPT_COLUMNS, HIGH_SCORES_PROMPT_FILE) \
+    X(assetGameoverPrompt, prompt.gameoverPrompt, GAMEOVER_PROMPT_ROWS, GAMEOVER_PROMPT_COLUMNS, GAMEOVER_PROMPT_FILE) \
+    X(assetQuitGamePrompt, prompt.quitGamePrompt, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_FILE)
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// art files, see loadFiles()
+#define ASSET_ENUM(asset, art, rows, columns, file) asset,
+enum assetType
+{
+    ASSET_LIST(ASSET_ENUM)
+    assetCount
+};
+#undef ASSET_ENUM
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+typedef struct Backgrounds
+{
+    char mainMenu[MAIN_MENU_ROWS * MAIN_MENU_COLUMNS];
+    char optionsMenu[OPTIONS_MENU_ROWS * OPTIONS_MENU_COLUMNS];
+    char game[CANVAS_ROWS * CANVAS_COLUMNS];
+    char highScores[HIGHSCORES_MENU_ROWS * HIGHSCORES_MENU_COLUMNS];
+} BACKGROUND;
+
+typedef struct Prompts
+{
+    char highScoresPrompt[HIGH_SCORES_PROMPT_ROWS * HIGH_SCORES_PROMPT_COLUMNS];
+    char gameoverPrompt[GAMEOVER_PROMPT_ROWS * GAMEOVER_PROMPT_COLUMNS];
+    char quitGamePrompt[QUITGAME_PROMPT_ROWS * QUITGAME_PROMPT_COLUMNS];
+} PROMPT;
+
+/**********************************************
+ * Global Variables
+ *********************************************/
+
+// Loaded at startup and shared read-only by every game, swapped by reloadFiles()
+extern BACKGROUND backGround;
+extern PROMPT prompt;
+
+// Art compiled into the binary by tools/artc.c, indexed by enum assetType
+extern const char *const artCells[assetCount];
+extern const GLYPH artGlyphs[];
+extern const int artGlyphCount;
+
+/*********************************************************
+* Function Prototypes
+*********************************************************/
+
+bool parseTxtFile(char matrixObject[], int row, int col, char txtFileName[], GLYPH_SCRATCH *glyphs, char error[], int errorSize);
+bool readTxtFiles(char matrixObject[], int row, int col, char txtFileName[]);
+bool loadFiles();
+int watchFiles();
+uint32_t reloadFiles();
+
+#endif // ASSETS_H
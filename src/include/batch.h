@@ -0,0 +1,109 @@
+/*******************************************************************************
+* @filename: batch.h
+* @brief: batch.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef BATCH_H
+#define BATCH_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "env.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Games stepped together by one vector instruction, 8 int16 lanes fill the SSE2
+// and NEON registers every build can use, 16 suits AVX2 builds (-mavx2)
+#ifndef BATCH_LANES
+#define BATCH_LANES 8
+#endif
+
+// Elapsed time counters stop here, above every preset delay
+#define BATCH_TIME_MAX 0x7000 // ticks
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// One int16 per game
+typedef int16_t BATCH_VEC __attribute__((vector_size(BATCH_LANES * sizeof(int16_t))));
+typedef uint16_t BATCH_UVEC __attribute__((vector_size(BATCH_LANES * sizeof(uint16_t))));
+typedef int32_t BATCH_VEC32 __attribute__((vector_size(BATCH_LANES * sizeof(int32_t))));
+
+// BATCH_LANES games in structure of arrays form, flags are 0 or -1 and times are
+// ticks elapsed since the matching GAME start time
+typedef struct BatchBlock
+{
+    // player
+    BATCH_VEC32 score;
+    BATCH_VEC gameOver, levelOver;
+    BATCH_VEC arrowsLeft, balloonsDestroyed, monstersKilled;
+    BATCH_VEC live;
+    // presets
+    BATCH_VEC levelType, arrowQuantity, arrowConsumableArrows;
+    BATCH_VEC archerHitDelay, arrowHitDelay, arrowStaggerDelay;
+    BATCH_VEC balloonStaggerDelay, monsterStaggerDelay, monsterSpawnDelay;
+    // archer
+    BATCH_VEC archerX, archerKeyHitLimit, archerKeyHitTime;
+    // arrow
+    BATCH_VEC arrowActive[MAX_ARROW_QUANTITY], arrowX[MAX_ARROW_QUANTITY], arrowY[MAX_ARROW_QUANTITY];
+    BATCH_VEC arrowIndex, arrowActiveIndex;
+    BATCH_VEC arrowStagger, arrowKeyHitLimit, arrowStaggerTime, arrowKeyHitTime;
+    // balloon
+    BATCH_VEC balloonActive[BALLOON_QUANTITY], balloonX[BALLOON_QUANTITY], balloonY[BALLOON_QUANTITY];
+    BATCH_VEC balloonIndividualStagger[BALLOON_QUANTITY], balloonIndividualDelay[BALLOON_QUANTITY];
+    BATCH_VEC balloonIndividualTime[BALLOON_QUANTITY];
+    BATCH_VEC balloonActiveIndex, balloonStagger, balloonStaggerTime;
+    // monster
+    BATCH_VEC monsterActive[MONSTER_QUANTITY], monsterX[MONSTER_QUANTITY], monsterY[MONSTER_QUANTITY];
+    BATCH_VEC monsterIndex, monsterActiveIndex;
+    BATCH_VEC monsterStagger, monsterStaggerTime, monsterSpawnTime;
+    // state only used between levels
+    int16_t level[BATCH_LANES], difficulty[BATCH_LANES];
+    int16_t balloonInitialX[BATCH_LANES], balloonScatteredDelayMax[BATCH_LANES], balloonScatteredDelayMin[BATCH_LANES];
+    int16_t nBalloonLevel[BATCH_LANES], nMonsterLevel[BATCH_LANES], nBalloonScatteredLevel[BATCH_LANES];
+    uint32_t random[BATCH_LANES];
+    const PRESETS *basePreset[BATCH_LANES];
+    uint64_t steps[BATCH_LANES];
+} BATCH_BLOCK;
+
+// Many headless games stepped together, each one plays exactly as an ENV would
+typedef struct Batch
+{
+    int n, nBlocks;
+    BATCH_BLOCK *block;
+    // archer hit test for each monster offset, built from the skins
+    uint16_t archerHit[MONSTER_ROWS + ARCHER_ROWS - 1];
+    bool archerHitReady;
+} BATCH;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool batch_init(BATCH *batch, int n);
+void batch_free(BATCH *batch);
+void batch_reset(BATCH *batch, int i, uint32_t seed, enum difficulty difficulty, int level);
+void batch_step(BATCH *batch, const uint8_t *actions, int32_t *rewards);
+bool batch_done(const BATCH *batch, int i);
+void batch_observe(const BATCH *batch, int i, ENV_OBSERVATION *obs);
+void batch_get(const BATCH *batch, int i, ENV *env);
+
+#endif // BATCH_H
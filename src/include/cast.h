@@ -0,0 +1,57 @@
+/*******************************************************************************
+* @filename: cast.h
+* @brief: cast.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef CAST_H
+#define CAST_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// asciicast file format, one JSON header line then one JSON array per output
+#define CAST_VERSION 2
+
+// Terminal the recording is played on
+#define CAST_TERM "xterm-256color"
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// asciicast file being written
+typedef struct Cast
+{
+    FILE *file;
+    uint64_t events, bytes; // output events and terminal bytes written
+} CAST;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool cast_open(CAST *cast, const char *path, const char *title);
+void cast_output(CAST *cast, double time, const char *data, int len);
+bool cast_close(CAST *cast);
+
+#endif // CAST_H
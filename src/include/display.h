@@ -0,0 +1,84 @@
+/*******************************************************************************
+* @filename: display.h
+* @brief: display.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "render.h"
+
+#if LINUX_EN
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#endif
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Triple buffer slot of the newest frame, and whether the render thread took it
+#define DISPLAY_INDEX 0x03
+#define DISPLAY_FRESH 0x04
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// Every cell changed since the display started, '\0' where none did
+typedef struct displayFrame
+{
+    char glyph[CANVAS_ROWS][CANVAS_COLUMNS];
+    ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS];
+} DISPLAY_FRAME;
+
+// Render thread of the local terminal. The simulation publishes whole frames
+// into a triple buffer and never waits, the thread always draws the newest one
+// and owns the output buffer, the encoder and the screen model while it runs
+typedef struct Display
+{
+    OUTBUFFER *out;
+    ENCODER *encoder;
+    SCREEN *screen;
+    bool running;
+    // simulation side
+    DISPLAY_FRAME canvas; // the layers published so far
+    int back; // slot written next
+    // render thread side
+    int front; // slot drawn last
+    DISPLAY_FRAME frame[3];
+#if LINUX_EN
+    atomic_int middle; // slot handed over, with DISPLAY_FRESH until taken
+    atomic_bool stop;
+    sem_t wake; // posted for every frame and for the stop
+    pthread_t thread;
+#endif
+} DISPLAY;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool display_start(DISPLAY *display, OUTBUFFER *out, ENCODER *encoder, SCREEN *screen);
+bool display_publish(DISPLAY *display, char layer[CANVAS_ROWS][CANVAS_COLUMNS], ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS]);
+void display_stop(DISPLAY *display);
+
+#endif // DISPLAY_H
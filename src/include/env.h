@@ -0,0 +1,103 @@
+/*******************************************************************************
+* @filename: env.h
+* @brief: env.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef ENV_H
+#define ENV_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+#include "snapshot.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Game time advanced by every step
+#define ENV_TICK GAME_TICK
+
+// Game time when an environment starts, far enough from zero that every cooldown
+// starting at zero is already over, as in a game driven by the wall clock
+#define ENV_EPOCH 1000000000ULL // us
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// agent actions, one per step
+enum envAction
+{
+    envNoop,
+    envUp,
+    envDown,
+    envShoot
+};
+
+// occupancy grid cells
+enum envCell
+{
+    envEmpty,
+    envArcher,
+    envArrow,
+    envBalloon,
+    envMonster
+};
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// Headless game driven by agent actions
+typedef struct Env
+{
+    GAME game;
+    uint64_t steps;
+    bool done;
+} ENV;
+
+// Compact game state, inactive entities keep their last position
+typedef struct EnvObservation
+{
+    int32_t score;
+    int16_t level, levelType;
+    int16_t archerRow;
+    int16_t arrowsLeft; // arrows not shot yet in this level
+    bool done;
+    // bit i set when entity i is active
+    uint32_t arrowActive, balloonActive, monsterActive;
+    int8_t arrowX[MAX_ARROW_QUANTITY], arrowY[MAX_ARROW_QUANTITY];
+    int8_t balloonX[BALLOON_QUANTITY], balloonY[BALLOON_QUANTITY];
+    int8_t monsterX[MONSTER_QUANTITY], monsterY[MONSTER_QUANTITY];
+} ENV_OBSERVATION;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+void env_reset(ENV *env, uint32_t seed, enum difficulty difficulty, int level);
+bool env_reset_preset(ENV *env, uint32_t seed, const PRESETS *preset, int level);
+int env_step(ENV *env, enum envAction action);
+int env_skip(ENV *env, uint64_t ticks);
+void env_observe(const ENV *env, ENV_OBSERVATION *obs);
+void env_occupancy(const ENV *env, uint8_t grid[CANVAS_ROWS][CANVAS_COLUMNS]);
+int env_save(const ENV *env, uint8_t *data, int size);
+bool env_restore(ENV *env, const uint8_t *data, int len);
+
+#endif // ENV_H
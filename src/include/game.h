@@ -0,0 +1,395 @@
+/*******************************************************************************
+* @filename: game.h
+* @brief: game.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef GAME_H
+#define GAME_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "util.h"
+#include <stdbool.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// ----------- DEBUG -----------
+#define DEBUG_MODE 0
+
+// ----------- MISC PRESETS -----------
+#define MAX_LEVEL 27
+#define FPS_LIMIT 120
+
+// Game time of one step of the simulation, see gameAdvance()
+#define GAME_TICK 1000 // us
+
+// Game time played per wall-clock time, see --speed
+#define GAME_SPEED_MIN 0.25
+#define GAME_SPEED_MAX 64
+
+// arrow
+#define MAX_ARROW_QUANTITY 30
+#define ARROW_LEFT_POINTS 50
+// balloon
+#define BALLOON_QUANTITY 15
+#define BALLOON_ARROW_QUANTITY 15
+#define BALLOON_POINTS 100
+// monster
+#define MONSTER_QUANTITY 30
+#define MONSTER_ARROW_QUANTITY 30
+#define MONSTER_POINTS 200
+
+// ----------- DIFFICULTY PRESETS -----------
+
+// ------ EASY ------
+// archer
+#define E_ARCHER_HIT_DELAY 25 // ms
+// arrow
+#define E_ARROW_STAGGER_DELAY 30 // ms
+#define E_ARROW_HIT_DELAY 250 // ms
+// balloon
+#define E_BALLOON_STAGGER_DELAY 300
+#define E_BALLOON_SCATTERED_DELAY_MAX 300
+#define E_BALLOON_SCATTERED_DELAY_MIN 60
+// monster
+#define E_MONSTER_STAGGER_DELAY 100 // ms
+#define E_MONSTER_SPAWN_DELAY 3000 // ms
+
+// ------ NORMAL ------
+// archer
+#define M_ARCHER_HIT_DELAY 50 // ms
+// arrow
+#define M_ARROW_STAGGER_DELAY 37.5 // ms
+#define M_ARROW_HIT_DELAY 500 // ms
+// balloon
+#define M_BALLOON_STAGGER_DELAY 200
+#define M_BALLOON_SCATTERED_DELAY_MAX 300
+#define M_BALLOON_SCATTERED_DELAY_MIN 40
+// monster
+#define M_MONSTER_STAGGER_DELAY 50 // ms
+#define M_MONSTER_SPAWN_DELAY 2000 // ms
+
+// ------ HARD ------
+// archer
+#define H_ARCHER_HIT_DELAY 80 // ms
+// arrow
+#define H_ARROW_STAGGER_DELAY 46 // ms
+#define H_ARROW_HIT_DELAY 1000 // ms
+// balloon
+#define H_BALLOON_STAGGER_DELAY 150
+#define H_BALLOON_SCATTERED_DELAY_MAX 120
+#define H_BALLOON_SCATTERED_DELAY_MIN 40
+// monster
+#define H_MONSTER_STAGGER_DELAY 40 // ms
+#define H_MONSTER_SPAWN_DELAY 1500 // ms
+
+// ----------- CANVAS -----------
+#define CANVAS_SKIN_FILE "backgrounds" FILE_SEPARATOR "game"
+#define CANVAS_COLUMNS 81
+#define CANVAS_ROWS 35
+#define CANVAS_RIGHT_EDGE_Y 80
+#define CANVAS_LEFT_EDGE_Y 0
+#define CANVAS_UPPER_EDGE_X 0
+#define CANVAS_LOWER_EDGE_X 34
+#define CANVAS_MIDDLE_EDGE_X 4
+
+// ----------- ARROW -----------
+#define ARROW_SKIN_FILE "skins" FILE_SEPARATOR "arrow_skin"
+#define ARROW_COLUMNS 3
+#define ARROW_ROWS 1
+#define ARROW_RIGHT_LIMIT 77
+
+// ----------- ARCHER -----------
+#define ARCHER_SKIN_FILE "skins" FILE_SEPARATOR "archer_skin"
+#define ARCHER_INITIAL_X 15
+#define ARCHER_INITIAL_Y 1
+#define ARCHER_UPPER_LIMIT 5
+#define ARCHER_LOWER_LIMIT 30
+#define ARCHER_COLUMNS 8
+#define ARCHER_ROWS 4
+
+// ----------- BALLON -----------
+#define BALLOON_SKIN_FILE "skins" FILE_SEPARATOR "balloon_skin"
+#define BALLOON_COLUMNS 3
+#define BALLOON_ROWS 3
+#define BALLOON_UPPER_LIMIT 4
+#define BALLOON_LOWER_LIMIT 34
+#define BALLOON_ROW_INITIAL_X 26
+#define BALLOON_ROW_INITIAL_Y 18
+
+// ----------- MONSTER -----------
+#define MONSTER_SKIN_FILE "skins" FILE_SEPARATOR "monster_skin"
+#define MONSTER_COLUMNS 6
+#define MONSTER_ROWS 5
+#define MONSTER_UPPER_LIMIT 4
+#define MONSTER_LOWER_LIMIT 29
+#define MONSTER_RIGHT_LIMIT 79
+#define MONSTER_LEFT_LIMIT 1
+#define MONSTER_INITIAL_Y 80
+
+// ----------- PARTICLE -----------
+#define PARTICLE_CAPACITY 64 // debris on the canvas at once, bursts past it are dropped
+#define PARTICLE_BURST 8 // debris of one hit, one per direction
+#define PARTICLE_GLYPHS "*+." // one per animation frame
+#define PARTICLE_FRAMES 3
+#define PARTICLE_FRAME_DELAY 60 // ms
+
+// ----------- ARROWS_LEFT_DISPLAY -----------
+#define ARROW_LEFT_DISPLAY_X 3
+#define ARROW_LEFT_DISPLAY_SYMBOL '|'
+
+// ----------- SCORE DISPLAY -----------
+#define SCORE_DISPLAY_X 2
+#define SCORE_DISPLAY_Y 8
+#define HIGHSCORE_DISPLAY_X 3
+#define HIGHSCORE_DISPLAY_Y 13
+#define LEVEL_DISPLAY_X 2
+#define LEVEL_DISPLAY_Y 39
+
+// ----------- COLORS -----------
+// cell attribute, ANSI color + 1 or zero for the theme color, and bold
+#define ATTR_FG(color) ((ATTR) ((color) + 1))
+#define ATTR_BG(color) ((ATTR) (((color) + 1) << 4))
+#define ATTR_BOLD 0x100
+#define ATTR_FG_OF(attr) ((attr) & 0x0F)
+#define ATTR_BG_OF(attr) (((attr) >> 4) & 0x0F)
+#define BALLOON_ATTR (ATTR_FG(red) | ATTR_BOLD)
+#define MONSTER_ATTR ATTR_FG(magenta)
+
+// ----------- PLAYER -----------
+#define HIGHSCORES_MAX_PLAYER_NAME 18
+
+// ----------- LEVELS -----------
+#define N_LEVEL_TYPES 3
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// level type
+enum levelType
+{
+    balloonLevel = 1,
+    monsterLevel,
+    balloonScatteredLevel
+};
+
+// difficulty
+enum difficulty
+{
+    easy,
+    normal,
+    hard
+};
+
+// themes
+enum theme
+{
+    light,
+    vanilla,
+    dark,
+    matrix
+};
+
+// ANSI colors
+enum color
+{
+    black,
+    red,
+    green,
+    yellow,
+    blue,
+    magenta,
+    cyan,
+    white
+};
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// Cell attribute, see ATTR_FG(), ATTR_BG() and ATTR_BOLD
+typedef uint16_t ATTR;
+
+typedef struct preSets
+{
+    enum levelType levelType;
+    // arrow
+    short arrowQuantity;
+    short arrowStaggerDelay, arrowHitDelay;
+    bool  arrowConsumableArrows;
+    // archer
+    short archerHitDelay;
+    // balloon
+    short balloonInitialX;
+    short balloonStaggerDelay;
+    short balloonScatteredDelayMax, balloonScatteredDelayMin;
+    // monster
+    short monsterStaggerDelay, monsterSpawnDelay;
+} PRESETS;
+
+typedef struct entityPlayer
+{
+    char name[HIGHSCORES_MAX_PLAYER_NAME];
+    int score;
+    enum difficulty difficulty;
+    enum theme theme;
+    int level;
+    bool gameOver, levelOver;
+    int arrowsLeft, balloonsDestroyed, monstersKilled;
+} PLAYER;
+
+typedef struct entityArcher
+{
+    bool active, keyHitLimit;
+    int x, y;
+    uint64_t startTimeKeyHitLimit;
+} ARCHER;
+
+typedef struct entityArrow
+{
+    bool active[MAX_ARROW_QUANTITY];
+    bool stagger, keyHitLimit;
+    int x[MAX_ARROW_QUANTITY], y[MAX_ARROW_QUANTITY];
+    int index, activeIndex;
+    uint64_t startTimeStagger, startTimeKeyHitLimit;
+} ARROW;
+
+typedef struct entityBalloon
+{
+    bool active[BALLOON_QUANTITY];
+    bool stagger, individualStagger[BALLOON_QUANTITY];
+    int x[BALLOON_QUANTITY], y[BALLOON_QUANTITY];
+    int activeIndex;
+    int IndividualDelay[BALLOON_QUANTITY];
+    uint64_t startTimeStagger, startTimeIndividualStagger[BALLOON_QUANTITY];
+} BALLOON;
+
+typedef struct entityMonster
+{
+    bool active[MONSTER_QUANTITY];
+    bool stagger, spawn;
+    int x[MONSTER_QUANTITY], y[MONSTER_QUANTITY];
+    int index, activeIndex;
+    uint64_t startTimeStagger, startTimeSpawn;
+} MONSTER;
+
+// Debris of the hits, a fixed pool kept as arrays of each field. The live
+// particles are the first count ones, a dead one is replaced by the last
+typedef struct entityParticle
+{
+    int count;
+    int8_t x[PARTICLE_CAPACITY], y[PARTICLE_CAPACITY];
+    int8_t dx[PARTICLE_CAPACITY], dy[PARTICLE_CAPACITY]; // cells moved each frame
+    uint8_t frame[PARTICLE_CAPACITY];
+    ATTR attr[PARTICLE_CAPACITY];
+    uint64_t startTimeStagger;
+} PARTICLE;
+
+typedef struct entitySkin
+{
+    char archer[ARCHER_ROWS * ARCHER_COLUMNS];
+    char arrow[ARROW_ROWS * ARROW_COLUMNS];
+    char balloon[BALLOON_ROWS * BALLOON_COLUMNS];
+    char monster[MONSTER_ROWS * MONSTER_COLUMNS];
+} SKIN;
+
+// Complete state of one running game
+typedef struct Game
+{
+    PLAYER player;
+    PRESETS preset;
+    ARCHER archer;
+    ARROW arrow;
+    BALLOON balloon;
+    MONSTER monster;
+    // levels played of each type, tunes the presets
+    int nBalloonLevel, nMonsterLevel, nBalloonScatteredLevel;
+    // delays used instead of the difficulty ones, NULL for the built-in presets
+    const PRESETS *basePreset;
+    // game time in microseconds, set by the caller before each tick
+    uint64_t now;
+    // random generator state, the same seed and keys replay the same game
+    uint32_t random;
+    // cells changed since the last frame, '\0' means unchanged
+    char layer[CANVAS_ROWS][CANVAS_COLUMNS];
+    // attributes of the changed cells, zero draws with the theme
+    ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS];
+    // debris drawn after the hits, not part of the game state
+    PARTICLE particle;
+} GAME;
+
+/**********************************************
+ * Global Variables
+ *********************************************/
+
+// Entity skins shared by every game
+extern SKIN skin;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+// ----------- GAME -----------
+void gameInit(GAME *game, enum difficulty difficulty);
+void gameSeed(GAME *game, uint32_t seed);
+void gameReset(GAME *game);
+void gameSetLevel(GAME *game, int level);
+void gameStartLevel(GAME *game);
+void gameTick(GAME *game, int key);
+bool gameAdvance(GAME *game, uint64_t time, int key);
+bool gameEndLevel(GAME *game);
+void gameRedraw(GAME *game, const char background[]);
+// movement
+void update(GAME *game);
+// level and difficulty
+void setLevelPreset(GAME *game);
+void setDifficultyPreset(GAME *game);
+bool presetValid(const PRESETS *preset);
+// archer
+bool hitArcherDetector(GAME *game);
+void archerMovUp(GAME *game);
+void archerMovDown(GAME *game);
+// arrow
+void arrowShoot(GAME *game);
+// balloon
+void setBalloonFirstRowPosition(GAME *game);
+void setBalloon(GAME *game, int  i, int startRow, int endRow, bool clean);
+void hitBalloonDetector(GAME *game);
+void setBalloonScatteredPostition(GAME *game);
+// monster
+void hitMonsterDetector(GAME *game);
+void setMonsterFirstPosition(GAME *game);
+void setMonster(GAME *game, int i, int startColumn, int endColumn, bool clean);
+bool spawnRateMonster(GAME *game, double delay);
+// particle
+void particleBurst(GAME *game, int x, int y, int rows, int columns, ATTR attr);
+void particleUpdate(GAME *game);
+
+// ----------- TIME -----------
+bool keyHitControl(GAME *game, uint64_t startTime, double delay);
+bool staggerControl(GAME *game, uint64_t *startTime, double delay);
+void staggerControlScatteredBalloon(GAME *game);
+
+// ----------- PRINT -----------
+void printNumberInGame(GAME *game, int value, int x, int y, char format[4]);
+void printStringInGame(GAME *game, char *string, int x, int y);
+
+#endif // GAME_H
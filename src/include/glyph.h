@@ -0,0 +1,84 @@
+/*******************************************************************************
+* @filename: glyph.h
+* @brief: glyph.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef GLYPH_H
+#define GLYPH_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "util.h"
+#include <stdbool.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Glyph IDs, a cell holds one in a char: ASCII stands for itself, the
+// others are looked up in the glyph table
+#define GLYPH_COUNT 256
+#define GLYPH_FIRST_EXTENDED 0x80
+#define GLYPH_WIDE_TAIL 0x7F // right half of a wide glyph
+#define GLYPH_INVALID '?' // shown for bytes that aren't UTF-8 and when the table is full
+
+// A code point and the combining marks drawn over it
+#define GLYPH_MAX_BYTES 12
+
+#define GLYPH_IS_EXTENDED(id) ((unsigned char) (id) >= GLYPH_FIRST_EXTENDED)
+#define GLYPH(id) (&glyphTable[(unsigned char) (id)])
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// Terminal bytes of a glyph, encoded once when the art is loaded
+typedef struct Glyph
+{
+    char bytes[GLYPH_MAX_BYTES];
+    uint8_t len;
+    uint8_t width; // columns taken, zero for the unknown glyph and the wide tails
+} GLYPH;
+
+// Extended glyphs of art being read, registered only once the art is used
+typedef struct GlyphScratch
+{
+    GLYPH glyph[GLYPH_COUNT];
+    int count; // extended IDs taken, the registered ones first
+} GLYPH_SCRATCH;
+
+/**********************************************
+ * Global Variables
+ *********************************************/
+
+// Extended glyphs, only appended to by glyph_register() on the main thread.
+// A registered entry never changes, the render thread reads it without a lock
+extern GLYPH glyphTable[GLYPH_COUNT];
+
+/*********************************************************
+* Function Prototypes
+*********************************************************/
+
+void glyph_scratch(GLYPH_SCRATCH *scratch);
+int glyph_decode(GLYPH_SCRATCH *scratch, const char *text, int len, char *id);
+bool glyph_decode_art(GLYPH_SCRATCH *scratch, const char *text, long len, char cells[], int rows, int columns, int *line);
+void glyph_register(const GLYPH_SCRATCH *scratch);
+void glyph_preload(const GLYPH glyphs[], int count);
+int glyph_print(char id);
+
+#endif // GLYPH_H
@@ -0,0 +1,78 @@
+/*******************************************************************************
+* @filename: input.h
+* @brief: input.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef INPUT_H
+#define INPUT_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "util.h"
+#include <stdbool.h>
+
+#if LINUX_EN
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Keys waiting for the simulation, a power of two
+#define INPUT_QUEUE_SIZE 64
+
+// Bytes taken from the terminal at once
+#define INPUT_READ_SIZE 64
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// A key and when it was read, in get_clock() time
+typedef struct inputEvent
+{
+    int key;
+    uint64_t time;
+} INPUT_EVENT;
+
+// Input thread of the local terminal. It waits on the keyboard, decodes the
+// keys and stamps them as they arrive, the simulation takes them in order from
+// a single producer, single consumer ring
+typedef struct Input
+{
+    bool running;
+    INPUT_EVENT event[INPUT_QUEUE_SIZE];
+#if LINUX_EN
+    atomic_uint head; // next key written, input thread side
+    atomic_uint tail; // next key taken, simulation side
+    int wake[2]; // pipe that ends the wait on the keyboard
+    pthread_t thread;
+#endif
+} INPUT;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool input_start(INPUT *input);
+bool input_pop(INPUT *input, INPUT_EVENT *event);
+void input_stop(INPUT *input);
+
+#endif // INPUT_H
@@ -0,0 +1,105 @@
+/*******************************************************************************
+* @filename: metrics.h
+* @brief: metrics.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef METRICS_H
+#define METRICS_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "util.h"
+#include <stdbool.h>
+
+#if LINUX_EN
+#include <stdatomic.h>
+#endif
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Environment variable holding the socket path, metrics are off when unset
+#define METRICS_SOCKET_ENV "BOW_METRICS_SOCKET"
+
+// Frame time histogram upper bounds in milliseconds
+#define METRICS_FRAME_BUCKETS 10
+#define METRICS_FRAME_BUCKETS_MS {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100}
+
+// Scrape connections served at the same time
+#define METRICS_MAX_CLIENTS 4
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// A counter the render thread adds to while the main thread formats it
+#if LINUX_EN
+typedef atomic_uint_least64_t METRICS_COUNTER;
+#else
+typedef uint64_t METRICS_COUNTER;
+#endif
+
+typedef struct Metrics
+{
+    // frames, see display.h
+    METRICS_COUNTER framesRendered;
+    uint64_t framesDropped, framesCoalesced;
+    METRICS_COUNTER frameTimeBucket[METRICS_FRAME_BUCKETS];
+    METRICS_COUNTER frameTimeSum; // us
+    // terminal output
+    METRICS_COUNTER bytesWritten;
+    // input
+    uint64_t inputEvents;
+    // simulation
+    uint64_t ticks;
+    double tickCpuSum, tickCpuLast; // ms
+    // art files swapped or rejected while running
+    uint64_t assetReloads, assetReloadErrors;
+    // game state gauges
+    int level;
+    int activeArrows, activeBalloons, activeMonsters, activeParticles;
+    // autopilot, see --autopilot
+    uint64_t pilotPlans, pilotTicks;
+    double pilotPlanWait; // ms
+    // server mode
+    int sessions;
+    int viewers;
+    uint64_t viewerFrames, viewerResyncs;
+} METRICS;
+
+/**********************************************
+ * Global Variables
+ *********************************************/
+
+extern METRICS metrics;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool metrics_init(const char *path);
+void metrics_close();
+void metrics_poll();
+int metrics_fds(int fds[], int size, int *timeout_ms);
+
+void metrics_frame(double frame_ms, int bytes);
+void metrics_tick(double cpu_ms);
+double cpu_clock();
+
+#endif // METRICS_H
@@ -0,0 +1,102 @@
+/*******************************************************************************
+* @filename: pilot.h
+* @brief: pilot.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef PILOT_H
+#define PILOT_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "env.h"
+
+#if LINUX_EN
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Game played ahead for every plan
+#define PILOT_HORIZON 3000 // ticks of ENV_TICK
+
+// Game time between two plans
+#define PILOT_REPLAN 100000 // us
+
+// A plan goes to an archer row, then shoots once or holds there
+#define PILOT_ROWS (ARCHER_LOWER_LIMIT - ARCHER_UPPER_LIMIT + 1)
+#define PILOT_PLANS (PILOT_ROWS * 2)
+
+// Value of a plan losing the game, below anything a plan can score
+#define PILOT_GAME_OVER_COST 1000000
+
+// Planning threads, one less than the cores when not given
+#define PILOT_MAX_THREADS 8
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// Where the archer goes and whether it shoots once there
+typedef struct pilotPlan
+{
+    int row;
+    bool shoot;
+} PILOT_PLAN;
+
+// Autopilot of the local game. Planning threads play every plan ahead from a
+// copy of the game and pick the best one, the game thread asks for a plan now
+// and then and never waits for it, it follows the last plan picked meanwhile
+typedef struct Pilot
+{
+    bool running;
+    int nThreads;
+    // game thread side
+    PILOT_PLAN plan; // followed now
+    bool planning; // a plan was asked for and isn't picked yet
+    uint64_t planTime; // game time the plan was asked for
+    uint64_t askTime; // get_clock() time the plan was asked for
+    uint64_t plans, ticks; // plans picked, ticks played ahead for them
+    double planWait; // ms from asking for the plans to picking them
+#if LINUX_EN
+    ENV root; // the game planned from, read only while planning
+    atomic_int next; // next plan to play, PILOT_PLANS and above when all are taken
+    int done; // plans played
+    int64_t value[PILOT_PLANS];
+    uint64_t planTicks[PILOT_PLANS];
+    bool picked; // every plan was played, best holds the pick
+    PILOT_PLAN best;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread[PILOT_MAX_THREADS];
+#endif
+} PILOT;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool pilot_start(PILOT *pilot, int threads);
+int pilot_key(PILOT *pilot, const GAME *game);
+void pilot_stop(PILOT *pilot);
+int64_t pilot_evaluate(const GAME *root, PILOT_PLAN plan, uint64_t *ticks);
+
+#endif // PILOT_H
@@ -0,0 +1,121 @@
+/*******************************************************************************
+* @filename: render.h
+* @brief: render.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef RENDER_H
+#define RENDER_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+#include "glyph.h"
+#include <stdarg.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Initial capacity of an output buffer, enough for a full canvas
+#define OUTBUF_INITIAL_SIZE 16384
+
+// Optional sequences a terminal understands
+#define RENDER_CAP_ECH 0x01 // erase characters
+#define RENDER_CAP_REP 0x02 // repeat the last glyph
+#define RENDER_CAP_SYNC 0x04 // synchronized output, mode 2026
+
+// Frame markers of synchronized output, the terminal paints what is between them at once
+#define RENDER_SYNC_BEGIN "\033[?2026h"
+#define RENDER_SYNC_END "\033[?2026l"
+
+// Longest wait for the terminal to answer the capability queries
+#define RENDER_PROBE_TIMEOUT 100 // ms
+
+// Attributes in one frame worth trying to draw one at a time
+#define RENDER_MAX_GROUPS 8
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// Growable byte buffer holding terminal output not written yet
+typedef struct outBuffer
+{
+    char *data;
+    int len, cap;
+} OUTBUFFER;
+
+// Immutable encoded frame shared by several readers
+typedef struct Frame
+{
+    int refs;
+    int len;
+    char data[];
+} FRAME;
+
+// What the terminal shows
+typedef struct Screen
+{
+    char glyph[CANVAS_ROWS][CANVAS_COLUMNS]; // glyph IDs, '\0' when unknown
+    ATTR attr[CANVAS_ROWS][CANVAS_COLUMNS]; // with the theme applied
+} SCREEN;
+
+// Output encoder, picks the shortest bytes for every cursor move, run and color change
+typedef struct Encoder
+{
+    int caps;
+    int row, column; // cursor, row -1 when unknown
+    ATTR theme; // colors of the cells without attributes
+    ATTR pen; // attribute the terminal draws with, the theme between calls
+} ENCODER;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+// Output buffer
+void outbuf_init(OUTBUFFER *buf);
+void outbuf_free(OUTBUFFER *buf);
+void outbuf_append(OUTBUFFER *buf, const char *data, int len);
+void outbuf_printf(OUTBUFFER *buf, const char *format, ...);
+void outbuf_consume(OUTBUFFER *buf, int len);
+
+// Shared frames
+FRAME *frame_new(const char *data, int len);
+FRAME *frame_retain(FRAME *frame);
+void frame_release(FRAME *frame);
+
+// ANSI rendering, the screen model holds what the terminal shows
+void encoder_init(ENCODER *enc, int caps);
+int render_caps(const char *term);
+int render_probe(int caps, int timeout_ms);
+int render_cells(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS],
+                 ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS]);
+int render_layer(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char layer[CANVAS_ROWS][CANVAS_COLUMNS],
+                 ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS]);
+int render_art(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, const char art[], int rows, int columns,
+               int startRow, int startColumn, bool clean);
+int render_theme(OUTBUFFER *buf, ENCODER *enc, ATTR theme);
+int render_clear(OUTBUFFER *buf);
+int render_keyframe(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen);
+
+// Screen model updates for text printed without the encoder
+void screen_fill(SCREEN *screen, char glyph, ATTR attr);
+void screen_apply_text(SCREEN *screen, int row, int column, const char *text, ATTR attr);
+
+#endif // RENDER_H
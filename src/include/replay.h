@@ -0,0 +1,71 @@
+/*******************************************************************************
+* @filename: replay.h
+* @brief: replay.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "env.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// First line of a replay file
+#define REPLAY_MAGIC "bow-replay 1"
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// an action and the env tick it was taken on
+typedef struct ReplayEvent
+{
+    uint64_t tick;
+    enum envAction action;
+} REPLAY_EVENT;
+
+// A recorded game, played again with env_step() it gives the same game
+typedef struct Replay
+{
+    uint32_t seed;
+    enum difficulty difficulty;
+    int level; // first level
+    uint64_t ticks; // game length
+    // actions other than envNoop, in tick order
+    REPLAY_EVENT *event;
+    int nEvents, size;
+} REPLAY;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+void replay_init(REPLAY *replay, uint32_t seed, enum difficulty difficulty, int level);
+void replay_free(REPLAY *replay);
+void replay_add(REPLAY *replay, uint64_t tick, enum envAction action);
+bool replay_save(const REPLAY *replay, const char *path);
+bool replay_load(REPLAY *replay, const char *path);
+void replay_start(const REPLAY *replay, ENV *env);
+enum envAction replay_action(const REPLAY *replay, int *next, uint64_t tick);
+void replay_play(const REPLAY *replay, ENV *env, int *next, uint64_t ticks);
+
+#endif // REPLAY_H
@@ -0,0 +1,80 @@
+/*******************************************************************************
+* @filename: rewind.h
+* @brief: rewind.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef REWIND_H
+#define REWIND_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+#include <stddef.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Game state kept, everything in GAME before the frame layer
+#define REWIND_STATE_SIZE offsetof(GAME, layer)
+
+// Game time between two saved states
+#define REWIND_INTERVAL 50000 // us
+
+// A full state every this many saved states, the others are deltas
+#define REWIND_KEYFRAME_INTERVAL 100
+
+// History memory of a game, 0.6 to 1.5 KB per second of play, a minute or more
+#define REWIND_BUFFER_SIZE (96 * 1024)
+
+// Game time stepped back by the rewind key
+#define REWIND_STEP 3000000 // us
+#define REWIND_KEY 'r'
+
+/**********************************************
+ * Typedefs
+ *********************************************/
+
+// Ring of recent game states. Each entry is a keyframe, the XOR of the state
+// against zero, or a delta, its XOR against the state before it. Both have
+// their zero runs packed. An entry is its length, the packed bytes and its
+// length again, so the ring can be walked both ways
+typedef struct Rewind
+{
+    uint8_t *data;
+    int size;
+    int head, tail; // next write, oldest entry
+    int wrapEnd; // end of the entries above head when wrapped
+    bool wrapped;
+    int count;
+    int sinceKeyframe; // entries after the newest keyframe
+    uint64_t lastTime; // game time of the newest entry
+    uint8_t last[REWIND_STATE_SIZE]; // newest state
+} REWIND;
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+bool rewind_init(REWIND *history, int size);
+void rewind_free(REWIND *history);
+void rewind_clear(REWIND *history);
+bool rewind_push(REWIND *history, const GAME *game);
+uint64_t rewind_back(REWIND *history, GAME *game, uint64_t time);
+
+#endif // REWIND_H
@@ -0,0 +1,59 @@
+/*******************************************************************************
+* @filename: server.h
+* @brief: server.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef SERVER_H
+#define SERVER_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "assets.h"
+#include "render.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+#define SERVER_DEFAULT_HOST "127.0.0.1"
+#define SERVER_DEFAULT_PORT "7777"
+
+// Simulation tick of every session
+#define SERVER_TICK 1 // ms
+
+// Limits per worker
+#define SERVER_MAX_SESSIONS 1024
+#define SERVER_MAX_EVENTS 64
+
+// Limits per session
+#define SERVER_INPUT_RING 64  // keys, power of two
+#define SERVER_READ_SIZE 512
+#define SERVER_MAX_OUTPUT (256 * 1024) // bytes queued before dropping a client
+
+// Spectators, worker i listens on the spectate port + i
+#define SERVER_MAX_VIEWERS 4096
+#define SERVER_VIEWER_QUEUE 32 // frames, power of two
+#define SERVER_VIEWER_IOV 16   // frames sent per system call
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+int serverRun(const char *address, int workers, const char *spectate, double speed);
+
+#endif // SERVER_H
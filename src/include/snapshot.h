@@ -0,0 +1,52 @@
+/*******************************************************************************
+* @filename: snapshot.h
+* @brief: snapshot.c header
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/**********************************************
+ * Includes
+ *********************************************/
+
+#include "game.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// First bytes of a snapshot, then the format version
+#define SNAPSHOT_MAGIC "BOWS"
+#define SNAPSHOT_MAGIC_LEN 4
+#define SNAPSHOT_VERSION 1
+
+// Largest snapshot, every value at its longest encoding
+#define SNAPSHOT_MAX_SIZE 4096
+
+// Longest delay a snapshot may hold, a damaged one is rejected past it
+#define SNAPSHOT_MAX_DELAY 60000 // ms
+
+/**********************************************
+ * Function Prototypes
+ *********************************************/
+
+int snapshot_save(const GAME *game, uint8_t *data, int size);
+bool snapshot_load(GAME *game, const uint8_t *data, int len);
+bool snapshot_write(const GAME *game, const char *path);
+bool snapshot_read(GAME *game, const char *path);
+
+#endif // SNAPSHOT_H
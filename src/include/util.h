@@ -37,6 +37,9 @@
 #define SPACE 32
 #define ESC 27
 
+// Text cursor blink of get_keyboard_str()
+#define KEYBOARD_BLINK_INTERVAL 500 // ms
+
 /**********************************************
  * Function Prototypes
  *********************************************/
@@ -47,12 +50,13 @@ double time_diff(uint64_t start_t);
 char *get_timeinfo(time_t timestamp);
 
 // Terminal
-void gotoxy(int x, int y);
+int gotoxy(int x, int y);
 void hide_cursor(int state);
 void set_nonblock(int state);
 
 char get_char();
-int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len);
+int get_keyboard_str(int ch, char *input_layer, char *str_buffer, int max_str_len);
+int wait_input(int timeout_ms, const int fds[], int count);
 
 #ifdef _WIN32
 // @windows
@@ -92,6 +96,8 @@ int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len);
 
 #include <unistd.h>
 #include <termios.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/select.h>
 
 /**********************************************
@@ -100,7 +106,7 @@ int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len);
 
 // Miscellaneous
 #define FILE_SEPARATOR "/"
-#define msleep(a) for(int ii = 0; ii < 1000; ii++) {usleep(a);}
+#define msleep(a) usleep((a) * 1000)
 #define clrscr() system("clear")
 
 // ASCII keys
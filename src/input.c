@@ -0,0 +1,227 @@
+/*******************************************************************************
+* @filename: input.c
+* @brief: Input thread of the local terminal, reads and stamps the keys as they
+*         arrive and queues them for the simulation without a lock
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/input.h"
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Read a key on the simulation thread, when no input thread runs
+ * @param  event: the key read
+ * @retval True if a key was pressed
+ */
+static bool input_poll(INPUT_EVENT *event)
+{
+    if (!kbhit())
+    {
+        return false;
+    }
+    event->time = get_clock();
+    event->key = get_char();
+    return true;
+}
+//**************************************************************************************
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Dummy function, the console is read by the simulation thread
+ * @retval False
+ */
+bool input_start(INPUT *input)
+{
+    input->running = false;
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take the next key
+ * @param  event: the key taken
+ * @retval True if there was one
+ */
+bool input_pop(INPUT *input, INPUT_EVENT *event)
+{
+    (void) input;
+    return input_poll(event);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ */
+void input_stop(INPUT *input)
+{
+    (void) input;
+}
+//**************************************************************************************
+#else // @linux
+
+/**
+ * @brief  Queue a key for the simulation
+ * @param  key: the key
+ * @param  time: when it was read
+ * @retval None
+ * @note   Call from the input thread only, a key is lost if the ring is full
+ */
+static void input_push(INPUT *input, int key, uint64_t time)
+{
+    unsigned head = atomic_load_explicit(&input->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&input->tail, memory_order_acquire) == INPUT_QUEUE_SIZE)
+    {
+        return;
+    }
+    input->event[head & (INPUT_QUEUE_SIZE - 1)] = (INPUT_EVENT) {key, time};
+    atomic_store_explicit(&input->head, head + 1, memory_order_release);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Input thread, queues every key of each read with the time of the read
+ * @param  arg: the input
+ * @retval NULL
+ */
+static void *input_run(void *arg)
+{
+    INPUT *input = arg;
+    unsigned char buf[INPUT_READ_SIZE];
+    bool closed = false;
+
+    for (;;)
+    {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(input->wake[0], &fds);
+        // a closed keyboard stays readable, only the stop is waited for then
+        if (!closed)
+        {
+            FD_SET(STDIN_FILENO, &fds);
+        }
+        if (select(((STDIN_FILENO > input->wake[0]) ? STDIN_FILENO : input->wake[0]) + 1, &fds, NULL, NULL, NULL) < 0)
+        {
+            continue;
+        }
+        if (FD_ISSET(input->wake[0], &fds))
+        {
+            break;
+        }
+
+        int len = read(STDIN_FILENO, buf, sizeof(buf));
+        uint64_t time = get_clock();
+        if (len <= 0)
+        {
+            closed = (len == 0 || (errno != EINTR && errno != EAGAIN));
+            continue;
+        }
+        for (int i = 0; i < len; i++)
+        {
+            int key = buf[i];
+            // an arrow is ESC [ A, the game knows it by its last byte
+            if (key == ESC && i + 1 < len && (buf[i + 1] == '[' || buf[i + 1] == 'O'))
+            {
+                for (i += 2; i < len && (buf[i] < 0x40 || buf[i] > 0x7E); i++);
+                if (i == len)
+                {
+                    break;
+                }
+                key = buf[i];
+            }
+            input_push(input, key, time);
+        }
+    }
+    return NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start the input thread, it owns the keyboard until input_stop()
+ * @retval True if the thread runs, input_pop() reads the keyboard by itself
+ *         otherwise
+ */
+bool input_start(INPUT *input)
+{
+    atomic_store(&input->head, 0);
+    atomic_store(&input->tail, 0);
+    input->running = false;
+
+    if (pipe(input->wake) < 0)
+    {
+        return false;
+    }
+    if (pthread_create(&input->thread, NULL, input_run, input) != 0)
+    {
+        close(input->wake[0]);
+        close(input->wake[1]);
+        return false;
+    }
+    input->running = true;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take the oldest key not taken yet
+ * @param  event: the key taken
+ * @retval True if there was one
+ * @note   Call from the simulation thread only
+ */
+bool input_pop(INPUT *input, INPUT_EVENT *event)
+{
+    unsigned tail;
+
+    if (!input->running)
+    {
+        return input_poll(event);
+    }
+    tail = atomic_load_explicit(&input->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&input->head, memory_order_acquire))
+    {
+        return false;
+    }
+    *event = input->event[tail & (INPUT_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&input->tail, tail + 1, memory_order_release);
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Stop the input thread, the keys not taken yet are lost
+ * @retval None
+ */
+void input_stop(INPUT *input)
+{
+    if (!input->running)
+    {
+        return;
+    }
+    while (write(input->wake[1], "", 1) < 0 && errno == EINTR);
+    pthread_join(input->thread, NULL);
+    close(input->wake[0]);
+    close(input->wake[1]);
+    input->running = false;
+}
+//**************************************************************************************
+#endif
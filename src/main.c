@@ -20,216 +20,35 @@
 /**********************************************
  * Includes
  *********************************************/
-#include "include/util.h"
-#include <stdbool.h>
+#include "include/assets.h"
+#include "include/cast.h"
+#include "include/display.h"
+#include "include/input.h"
+#include "include/metrics.h"
+#include "include/pilot.h"
+#include "include/server.h"
+#include "include/replay.h"
+#include "include/rewind.h"
 
 /**********************************************
  * Defines
  *********************************************/
 
-// ----------- DEBUG -----------
-#define DEBUG_MODE 0
-
-// ----------- MISC PRESETS -----------
-#define MAX_LEVEL 27
-#define FPS_LIMIT 120
-
-// arrow
-#define MAX_ARROW_QUANTITY 30
-#define ARROW_LEFT_POINTS 50
-// balloon
-#define BALLOON_QUANTITY 15
-#define BALLOON_ARROW_QUANTITY 15
-#define BALLOON_POINTS 100
-// monster
-#define MONSTER_QUANTITY 30
-#define MONSTER_ARROW_QUANTITY 30
-#define MONSTER_POINTS 200
-
-// ----------- DIFFICULTY PRESETS -----------
-
-// ------ EASY ------
-// archer
-#define E_ARCHER_HIT_DELAY 25 // ms
-// arrow
-#define E_ARROW_STAGGER_DELAY 30 // ms
-#define E_ARROW_HIT_DELAY 250 // ms
-// balloon
-#define E_BALLOON_STAGGER_DELAY 300
-#define E_BALLOON_SCATTERED_DELAY_MAX 300
-#define E_BALLOON_SCATTERED_DELAY_MIN 60
-// monster
-#define E_MONSTER_STAGGER_DELAY 100 // ms
-#define E_MONSTER_SPAWN_DELAY 3000 // ms
-
-// ------ NORMAL ------
-// archer
-#define M_ARCHER_HIT_DELAY 50 // ms
-// arrow
-#define M_ARROW_STAGGER_DELAY 37.5 // ms
-#define M_ARROW_HIT_DELAY 500 // ms
-// balloon
-#define M_BALLOON_STAGGER_DELAY 200
-#define M_BALLOON_SCATTERED_DELAY_MAX 300
-#define M_BALLOON_SCATTERED_DELAY_MIN 40
-// monster
-#define M_MONSTER_STAGGER_DELAY 50 // ms
-#define M_MONSTER_SPAWN_DELAY 2000 // ms
-
-// ------ HARD ------
-// archer
-#define H_ARCHER_HIT_DELAY 80 // ms
-// arrow
-#define H_ARROW_STAGGER_DELAY 46 // ms
-#define H_ARROW_HIT_DELAY 1000 // ms
-// balloon
-#define H_BALLOON_STAGGER_DELAY 150
-#define H_BALLOON_SCATTERED_DELAY_MAX 120
-#define H_BALLOON_SCATTERED_DELAY_MIN 40
-// monster
-#define H_MONSTER_STAGGER_DELAY 40 // ms
-#define H_MONSTER_SPAWN_DELAY 1500 // ms
-
-// ----------- CANVAS -----------
-#define CANVAS_SKIN_FILE "backgrounds" FILE_SEPARATOR "game"
-#define CANVAS_COLUMNS 81
-#define CANVAS_ROWS 35
-#define CANVAS_RIGHT_EDGE_Y 80
-#define CANVAS_LEFT_EDGE_Y 0
-#define CANVAS_UPPER_EDGE_X 0
-#define CANVAS_LOWER_EDGE_X 34
-#define CANVAS_MIDDLE_EDGE_X 4
-
-// ----------- ARROW -----------
-#define ARROW_SKIN_FILE "skins" FILE_SEPARATOR "arrow_skin"
-#define ARROW_COLUMNS 3
-#define ARROW_ROWS 1
-#define ARROW_RIGHT_LIMIT 77
-
-// ----------- ARCHER -----------
-#define ARCHER_SKIN_FILE "skins" FILE_SEPARATOR "archer_skin"
-#define ARCHER_INITIAL_X 15
-#define ARCHER_INITIAL_Y 1
-#define ARCHER_UPPER_LIMIT 5
-#define ARCHER_LOWER_LIMIT 30
-#define ARCHER_COLUMNS 8
-#define ARCHER_ROWS 4
-
-// ----------- BALLON -----------
-#define BALLOON_SKIN_FILE "skins" FILE_SEPARATOR "balloon_skin"
-#define BALLOON_COLUMNS 3
-#define BALLOON_ROWS 3
-#define BALLOON_UPPER_LIMIT 4
-#define BALLOON_LOWER_LIMIT 34
-#define BALLOON_ROW_INITIAL_X 26
-#define BALLOON_ROW_INITIAL_Y 18
-
-// ----------- MONSTER -----------
-#define MONSTER_SKIN_FILE "skins" FILE_SEPARATOR "monster_skin"
-#define MONSTER_COLUMNS 6
-#define MONSTER_ROWS 5
-#define MONSTER_UPPER_LIMIT 4
-#define MONSTER_LOWER_LIMIT 29
-#define MONSTER_RIGHT_LIMIT 79
-#define MONSTER_LEFT_LIMIT 1
-#define MONSTER_INITIAL_Y 80
-
-// ----------- ARROWS_LEFT_DISPLAY -----------
-#define ARROW_LEFT_DISPLAY_X 3
-#define ARROW_LEFT_DISPLAY_SYMBOL '|'
-
-// ----------- SCORE DISPLAY -----------
-#define SCORE_DISPLAY_X 2
-#define SCORE_DISPLAY_Y 8
-#define HIGHSCORE_DISPLAY_X 3
-#define HIGHSCORE_DISPLAY_Y 13
-
-// ----------- HIGH SCORES PROMPT -----------
-#define HIGH_SCORES_PROMPT_ROWS 7
-#define HIGH_SCORES_PROMPT_COLUMNS 37
-#define HIGH_SCORES_PROMPT_X 10
-#define HIGH_SCORES_PROMPT_Y 24
-#define HIGH_SCORES_PROMPT_FILE "prompts" FILE_SEPARATOR "highscores_prompt"
-
-// ----------- GAMEOVER PROMPT -----------
-#define GAMEOVER_PROMPT_ROWS 15
-#define GAMEOVER_PROMPT_COLUMNS 65
-#define GAMEOVER_PROMPT_X 7
-#define GAMEOVER_PROMPT_Y 8
-#define GAMEOVER_PROMPT_FILE "prompts" FILE_SEPARATOR "gameover_prompt"
-
-// ----------- QUITGAME PROMPT -----------
-#define QUITGAME_PROMPT_ROWS 7
-#define QUITGAME_PROMPT_COLUMNS 37
-#define QUITGAME_PROMPT_X 10
-#define QUITGAME_PROMPT_Y 24
-#define QUITGAME_PROMPT_FILE "prompts" FILE_SEPARATOR "quitgame_prompt"
-
-// ----------- HIGHSCORES MENU -----------
-#define HIGHSCORES_MENU_ROWS 14
-#define HIGHSCORES_MENU_COLUMNS 53
-#define HIGHSCORES_MENU_X 7
-#define HIGHSCORES_MENU_Y 14
-#define HIGHSCORES_MENU_FILE "backgrounds" FILE_SEPARATOR "highscores_menu"
-
 // ----------- HIGHSCORES SAVE FILE -----------
-#define HIGHSCORES_MAX_PLAYER_NAME 18
 #define HIGHSCORES_MAX_SAVED_SCORES 5
 #define HIGHSCORES_FILE "highscores"
 
-// ----------- OPTIONS MENU -----------
-#define OPTIONS_MENU_ROWS 21
-#define OPTIONS_MENU_COLUMNS 70
-#define OPTIONS_MENU_X 7
-#define OPTIONS_MENU_Y 6
-#define ARROW_OPTIONS_MENU_INITIAL_X 12
-#define ARROW_OPTIONS_MENU_INITIAL_Y 20
-#define ARROW_OPTIONS_MENU_UPPER_LIMIT_X 12
-#define ARROW_OPTIONS_MENU_BOTTOM_LIMIT_X 19
-#define OPTIONS_MENU_FILE "backgrounds" FILE_SEPARATOR "options_menu"
-
-// ----------- MAIN MENU -----------
-#define MAIN_MENU_COLUMNS 81
-#define MAIN_MENU_ROWS 35
-#define ARROW_MAIN_MENU_INITIAL_POSITION_X 17
-#define ARROW_MAIN_MENU_INITIAL_POSITION_Y 34
-#define ARROW_MAIN_MENU_UPPER_LIMIT_X 17
-#define ARROW_MAIN_MENU_BOTTOM_LIMIT_X 20
-#define ARROW_MENU_COLUMNS 2
-#define MAIN_MENU_FILE "backgrounds" FILE_SEPARATOR "main_menu"
-
-// ----------- LEVELS -----------
-#define N_LEVEL_TYPES 3
+// ----------- SAVED GAME FILE -----------
+#define SAVE_FILE "save"
+
+// ----------- MENUS -----------
+#define MENU_TIMEOUT 256 // menuWaitKey() result when the time is over, no key has it
+#define WIDGET_MAX_TEXT 32
 
 /**********************************************
  * Enums
  *********************************************/
 
-// level type
-enum levelType
-{
-    balloonLevel = 1,
-    monsterLevel,
-    balloonScatteredLevel
-};
-
-// difficulty
-enum difficulty
-{
-    easy,
-    normal,
-    hard
-};
-
-// themes
-enum theme
-{
-    light,
-    vanilla,
-    dark,
-    matrix
-};
-
 // symbol
 enum symbolType
 {
@@ -248,24 +67,6 @@ typedef struct fpsLimit
     uint64_t startTimeDelay, startTimeOneSecod;
 } FPSLIMIT;
 
-typedef struct preSets
-{
-    enum levelType levelType;
-    // arrow
-    short arrowQuantity;
-    short arrowStaggerDelay, arrowHitDelay;
-    bool  arrowConsumableArrows;
-    // archer
-    short archerHitDelay;
-    // balloon
-    short balloonInitialX;
-    short balloonStaggerDelay;
-    short balloonScatteredDelayMax, balloonScatteredDelayMin;
-    // monster
-    short monsterStaggerDelay, monsterSpawnDelay;
-} PRESETS;
-
-
 typedef struct HighScores
 {
     struct playerData
@@ -277,89 +78,29 @@ typedef struct HighScores
 
 } HIGHSCORES;
 
-typedef struct entityPlayer
-{
-    char name[HIGHSCORES_MAX_PLAYER_NAME];
-    int score;
-    enum difficulty difficulty;
-    enum theme theme;
-    int level;
-    bool gameOver, levelOver;
-    int arrowsLeft, balloonsDestroyed, monstersKilled;
-} PLAYER;
-
-typedef struct entityArcher
+// Text on a menu or prompt, printed again only when it changes
+typedef struct Widget
 {
-    bool active, keyHitLimit;
     int x, y;
-    uint64_t startTimeKeyHitLimit;
-} ARCHER;
-
-typedef struct entityArrow
-{
-    bool active[MAX_ARROW_QUANTITY];
-    bool stagger, keyHitLimit;
-    int x[MAX_ARROW_QUANTITY], y[MAX_ARROW_QUANTITY];
-    int index, activeIndex;
-    uint64_t startTimeStagger, startTimeKeyHitLimit;
-} ARROW;
-
-typedef struct entityBalloon
-{
-    bool active[BALLOON_QUANTITY];
-    bool stagger, individualStagger[BALLOON_QUANTITY];
-    int x[BALLOON_QUANTITY], y[BALLOON_QUANTITY];
-    int activeIndex;
-    int IndividualDelay[BALLOON_QUANTITY];
-    uint64_t startTimeStagger, startTimeIndividualStagger[BALLOON_QUANTITY];
-} BALLOON;
-
-typedef struct entityMonster
-{
-    bool active[MONSTER_QUANTITY];
-    bool stagger, spawn;
-    int x[MONSTER_QUANTITY], y[MONSTER_QUANTITY];
-    int index, activeIndex;
-    uint64_t startTimeStagger, startTimeSpawn;
-} MONSTER;
-
-typedef struct entitySkin
-{
-    char archer[ARCHER_ROWS * ARCHER_COLUMNS];
-    char arrow[ARROW_ROWS * ARROW_COLUMNS];
-    char balloon[BALLOON_ROWS * BALLOON_COLUMNS];
-    char monster[MONSTER_ROWS * MONSTER_COLUMNS];
-} SKIN;
-
-typedef struct Backgrounds
-{
-    char mainMenu[MAIN_MENU_ROWS * MAIN_MENU_COLUMNS];
-    char optionsMenu[OPTIONS_MENU_ROWS * OPTIONS_MENU_COLUMNS];
-    char game[CANVAS_ROWS * CANVAS_COLUMNS];
-    char highScores[HIGHSCORES_MENU_ROWS * HIGHSCORES_MENU_COLUMNS];
-} BACKGROUND;
-
-typedef struct Prompts
-{
-    char highScoresPrompt[HIGH_SCORES_PROMPT_ROWS * HIGH_SCORES_PROMPT_COLUMNS];
-    char gameoverPrompt[GAMEOVER_PROMPT_ROWS * GAMEOVER_PROMPT_COLUMNS];
-    char quitGamePrompt[QUITGAME_PROMPT_ROWS * QUITGAME_PROMPT_COLUMNS];
-} PROMPT;
+    char shown[WIDGET_MAX_TEXT]; // on the screen now
+} WIDGET;
 
 /*********************************************************
 * Function Prototypes
 *********************************************************/
 
 // ----------- DEBUG -----------
-void specialInterface(ARROW arrow, BALLOON balloon, MONSTER monster, bool printTags);
+void specialInterface(bool printTags);
 
 // ----------- FILE -----------
-bool readTxtFiles(char matrixObject[], int row, int col, char txtFileName[]);
-bool loadFiles();
 bool readHighScores();
 void writeHightScores();
+bool saveGame();
+bool resumeGame();
 
 // ----------- MENU/PROMPT -----------
+int menuWaitKey(int timeout);
+void widgetDraw(WIDGET *widget, const char *text);
 int symbolMenuMovement(int initialX, int initialY, int upperLimitX, int bottomLimitX, int leap, enum symbolType symbol);
 void mainMenu();
 void optionsMenu();
@@ -370,53 +111,32 @@ uint64_t setQuitGamePrompt(char prompt[]);
 void setGameOver(char prompt[]);
 
 // ----------- PRINT -----------
+void clearScreen();
 void printBackground(char background[], int rows, int columns, int startRow, int StartColumn);
 void printPrompt(char prompt[], int rows, int columns, int startRow, int startColumn, bool clean);
 void printSymbolMenu(bool clean, int x, int y, enum symbolType symbol);
-void printNumberInGame(int value, int x, int y, char format[4]);
-void printStringInGame(char *string, int x, int y);
-void draw();
+int draw();
+void writeOutput();
 
-// ----------- TIME -----------
-bool keyHitControl(uint64_t startTime, double delay);
-bool staggerControl(uint64_t *startTime, double delay);
-void staggerControlScatteredBalloon(BALLOON *balloon);
+// ----------- REPLAY -----------
+void recordKey(int key);
+int replaySessions(int count, char *files[]);
+int castSessions(const char *path, int count, char *files[]);
 
 // ----------- GAME -----------
 void gameLoop();
+void gameStep(int key, uint64_t time);
+uint64_t gameClock(uint64_t clock);
+void setGameClock(uint64_t time);
+uint64_t frameTicks(uint64_t frame);
 // screen
-void show(ARCHER *archer, ARROW *arrow, BALLOON *balloon, MONSTER *monster);
-// movement
-void update(ARCHER *archer, ARROW *arrow, BALLOON *balloon, MONSTER *monster);
-// level and difficulty
-void setLevelPreset();
-void setDifficultyPreset();
-// archer
-bool hitArcherDetector(ARCHER *archer, MONSTER *monster);
-void archerMovUp(ARCHER *archer);
-void archerMovDown(ARCHER *archer);
-// arrow
-void arrowShoot(ARCHER archer, ARROW *arrow);
-// balloon
-void setBalloonFirstRowPosition(BALLOON *balloon);
-void setBalloon(BALLOON *balloon, int  i, int startRow, int endRow, bool clean);
-void hitBalloonDetector(ARROW *arrow, BALLOON *balloon);
-void setBalloonScatteredPostition(BALLOON *balloon);
-// monster
-void hitMonsterDetector(ARROW *arrow, MONSTER *monster);
-void setMonsterFirstPosition(MONSTER *monster);
-void setMonster(MONSTER *monster, int i, int startColumn, int endColumn, bool clean);
-bool spawnRateMonster(MONSTER *monster, double delay);
+void show();
 
 /*********************************************************
 * Global Variables
 *********************************************************/
 
-char gameLayer[CANVAS_ROWS][CANVAS_COLUMNS];
 HIGHSCORES highScore;
-SKIN skin;
-BACKGROUND backGround;
-PROMPT prompt;
 FPSLIMIT fps =
 {
     .delay = (1000/(double)FPS_LIMIT), // ms
@@ -425,21 +145,41 @@ FPSLIMIT fps =
     .startTimeOneSecod = 0
 };
 
-PLAYER player =
-{
-    .name = {0},
-    .score = 0,
-    .difficulty = normal,
-    .theme = vanilla,
-    .level = 1,
-    .gameOver = false,
-    .levelOver = false,
-    .arrowsLeft = 0,
-    .balloonsDestroyed = 0,
-    .monstersKilled = 0
-};
-
-PRESETS preset;
+// Local player game
+GAME game;
+// Time spent in the pause prompt, excluded from the game time
+uint64_t pausedTime = 0;
+// Game time played per wall-clock time, see --speed
+double gameSpeed = 1;
+// The game was quit and saved, it isn't over
+bool gameSaved = false;
+// The game was quit from the pause prompt
+bool gameQuit = false;
+// Recent states of the local game, see REWIND_KEY
+REWIND history;
+
+// Local terminal output
+OUTBUFFER output;
+ENCODER encoder;
+// what the terminal shows, '\0' where it's unknown
+SCREEN screen;
+// Render thread drawing the game frames, see show()
+DISPLAY display;
+// Input thread reading the keys of the game, see gameLoop()
+INPUT input;
+
+// Art changes, see watchFiles(), and the changes read while a menu waited
+int assetWatchFd = -1;
+uint32_t artChanged = 0;
+
+// Autopilot playing the local game, see --autopilot
+bool autopilotOn = false;
+PILOT pilot;
+
+// Local game being recorded, see --record
+char *recordFile = NULL;
+REPLAY recording;
+uint64_t startTimeRecord;
 
 /*********************************************************
 * Function Definitions
@@ -449,7 +189,68 @@ PRESETS preset;
 * @brief  Main menu or code entry
 * @return Zero
 */
-int main(void){
+int main(int argc, char *argv[]){
+    char *serverAddress = NULL;
+    char *spectateAddress = NULL;
+    int serverWorkers = 1;
+    char **replayFiles = NULL;
+    int nReplayFiles = 0;
+    char *castFile = NULL;
+
+    // Command line options
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--server") == 0){
+            serverAddress = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : SERVER_DEFAULT_PORT;
+        }
+        else if(strcmp(argv[i], "--spectate") == 0 && i + 1 < argc){
+            spectateAddress = argv[++i];
+        }
+        else if(strcmp(argv[i], "--workers") == 0 && i + 1 < argc){
+            serverWorkers = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--autopilot") == 0){
+            autopilotOn = true;
+        }
+        else if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc && atof(argv[i + 1]) >= GAME_SPEED_MIN && atof(argv[i + 1]) <= GAME_SPEED_MAX){
+            gameSpeed = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc){
+            recordFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--cast") == 0 && i + 2 < argc){
+            // every argument left is a replay file
+            castFile = argv[i + 1];
+            replayFiles = &argv[i + 2];
+            nReplayFiles = argc - (i + 2);
+            break;
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc){
+            // every argument left is a replay file
+            replayFiles = &argv[i + 1];
+            nReplayFiles = argc - (i + 1);
+            break;
+        }
+        else{
+            printf("Usage: %s [--server [host:]port] [--workers n] [--spectate [host:]port] [--autopilot] [--speed x] [--record file] [--replay files...] [--cast file replays...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Recorded games played headless or written as a cast, the local terminal is left untouched
+    if(replayFiles != NULL){
+        if(!loadFiles()){
+            return 1;
+        }
+        return (castFile != NULL) ? castSessions(castFile, nReplayFiles, replayFiles) : replaySessions(nReplayFiles, replayFiles);
+    }
+
+    // Multi-session server, the local terminal is left untouched
+    if(serverAddress != NULL){
+        if(!loadFiles()){
+            return 1;
+        }
+        return serverRun(serverAddress, serverWorkers, spectateAddress, gameSpeed);
+    }
 
 // Initialize terminal
 #if WINDOWS_EN
@@ -459,10 +260,21 @@ int main(void){
 #endif
     set_nonblock(1);
     hide_cursor(1);
+    metrics_init(getenv(METRICS_SOCKET_ENV));
+    outbuf_init(&output);
+    // the name is a guess, the terminal tells what it really understands
+    encoder_init(&encoder, render_probe(render_caps(getenv("TERM")), RENDER_PROBE_TIMEOUT));
+    gameInit(&game, normal);
 
     if(loadFiles()){
+        assetWatchFd = watchFiles();
         readHighScores();
+        rewind_init(&history, REWIND_BUFFER_SIZE);
+        // plans on the cores the game leaves free
+        autopilotOn = autopilotOn && pilot_start(&pilot, 0);
         mainMenu();
+        pilot_stop(&pilot);
+        rewind_free(&history);
     }
 
 // Reset terminal
@@ -473,35 +285,14 @@ int main(void){
 #endif
     set_nonblock(0);
     hide_cursor(0);
+    metrics_close();
+    outbuf_free(&output);
 
     clrscr();
     return 0;
 }
 //**************************************************************************************
 
-/**
- * @brief  Load ASCII Art from .txt files
- * @retval True if success
- */
-bool loadFiles(){
-    if( !readTxtFiles(backGround.optionsMenu, OPTIONS_MENU_ROWS, OPTIONS_MENU_COLUMNS, OPTIONS_MENU_FILE) ||
-        !readTxtFiles(backGround.mainMenu, MAIN_MENU_ROWS, MAIN_MENU_COLUMNS, MAIN_MENU_FILE) ||
-        !readTxtFiles(backGround.highScores, HIGHSCORES_MENU_ROWS, HIGHSCORES_MENU_COLUMNS, HIGHSCORES_MENU_FILE) ||
-        !readTxtFiles(backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, CANVAS_SKIN_FILE) ||
-        !readTxtFiles(skin.archer, ARCHER_ROWS, ARCHER_COLUMNS, ARCHER_SKIN_FILE) ||
-        !readTxtFiles(skin.arrow, ARROW_ROWS, ARROW_COLUMNS, ARROW_SKIN_FILE) ||
-        !readTxtFiles(skin.balloon, BALLOON_ROWS, BALLOON_COLUMNS, BALLOON_SKIN_FILE) ||
-        !readTxtFiles(skin.monster, MONSTER_ROWS, MONSTER_COLUMNS, MONSTER_SKIN_FILE) ||
-        !readTxtFiles(prompt.highScoresPrompt, HIGH_SCORES_PROMPT_ROWS, HIGH_SCORES_PROMPT_COLUMNS, HIGH_SCORES_PROMPT_FILE) ||
-        !readTxtFiles(prompt.gameoverPrompt, GAMEOVER_PROMPT_ROWS,  GAMEOVER_PROMPT_COLUMNS, GAMEOVER_PROMPT_FILE) ||
-        !readTxtFiles(prompt.quitGamePrompt, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_FILE) ){
-
-        return false;
-    }
-    return true;
-}
-//**************************************************************************************
-
 /**
  * @brief  Read binary high scores save
  * @retval True if success
@@ -563,31 +354,63 @@ void writeHightScores(){
         printf("Error in saving: %s.bin\n", HIGHSCORES_FILE);
         printf("Press ENTER to continue...\n");
         fflush(stdout);
-        while(get_char() != ENTER) msleep(10);
+        while(menuWaitKey(-1) != ENTER);
     }
 }
 //**************************************************************************************
 
+/**
+ * @brief  Save the running game, it's resumed the next time a game starts
+ * @retval True if success
+ */
+bool saveGame(){
+    char buf[100];
+
+    if(WINDOWS_EN)
+    {
+        system("if not exist \"score\" mkdir \"score\"");
+    }
+    else
+    {
+        system("mkdir -p score");
+    }
+    snprintf(buf, sizeof(buf),"score%s%s.bin", FILE_SEPARATOR, SAVE_FILE);
+    return snapshot_write(&game, buf);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Load the saved game, if any, and delete it so it's resumed only once
+ * @retval True if a game was loaded
+ */
+bool resumeGame(){
+    char buf[100];
+    enum theme theme = game.player.theme;
+
+    snprintf(buf, sizeof(buf),"score%s%s.bin", FILE_SEPARATOR, SAVE_FILE);
+    if(!snapshot_read(&game, buf)){
+        return false;
+    }
+    remove(buf);
+    // the theme is a setting, not part of the game
+    game.player.theme = theme;
+    return true;
+}
+//**************************************************************************************
+
 /**
  * @brief  Print high scores menu
  * @retval None
  */
 void highscoresMenu(){
 
-    clrscr();
     printBackground(backGround.highScores, HIGHSCORES_MENU_ROWS, HIGHSCORES_MENU_COLUMNS, HIGHSCORES_MENU_X, HIGHSCORES_MENU_Y);
         for(int i = 0; i < highScore.index; i++){
             gotoxy((HIGHSCORES_MENU_X + 5) + i, HIGHSCORES_MENU_Y + 9); printf("%s", highScore.player[i].name);
             gotoxy((HIGHSCORES_MENU_X + 5) + i, HIGHSCORES_MENU_Y + 39); printf("%07i", highScore.player[i].score);
         }
 
-    fflush(stdout);
-    char key = 0;
-    do
-    {
-        key = get_char();
-        msleep(10);
-    } while(key != ESC);
+    while(menuWaitKey(-1) != ESC);
 }
 //**************************************************************************************
 
@@ -604,29 +427,34 @@ bool highscoresPrompt(){
     if(highScore.index < HIGHSCORES_MAX_SAVED_SCORES) highScore.index++;
 
     for(int i=0; i < highScore.index; i++){
-        if(player.score > highScore.player[i].score){
+        if(game.player.score > highScore.player[i].score){
             print = true; break;
         }
     }
 
     if(print){
+        WIDGET nameField = {.x = HIGH_SCORES_PROMPT_X + 4, .y = HIGH_SCORES_PROMPT_Y + 16};
+        int key = 0;
+
+        clearScreen();
+        printPrompt(prompt.highScoresPrompt, HIGH_SCORES_PROMPT_ROWS, HIGH_SCORES_PROMPT_COLUMNS, HIGH_SCORES_PROMPT_X, HIGH_SCORES_PROMPT_Y, false);
         // Get player name
         while( name_len < 0 )
         {
-            clrscr();
-            printPrompt(prompt.highScoresPrompt, HIGH_SCORES_PROMPT_ROWS, HIGH_SCORES_PROMPT_COLUMNS, HIGH_SCORES_PROMPT_X, HIGH_SCORES_PROMPT_Y, false);
-
             memset(input_layer, '\0', 100);
-            name_len = get_keyboard_str(input_layer, name_str, HIGHSCORES_MAX_PLAYER_NAME);
-
-            gotoxy((HIGH_SCORES_PROMPT_X + 4), (HIGH_SCORES_PROMPT_Y + 16));
-            printf("%s", input_layer);
-            fflush(stdout);
-
-            msleep(10);
+            name_len = get_keyboard_str(key, input_layer, name_str, HIGHSCORES_MAX_PLAYER_NAME);
+            widgetDraw(&nameField, input_layer);
+
+            // a key or the cursor blink, whichever comes first
+            uint64_t blinkTime = get_clock();
+            do{
+                int wait = KEYBOARD_BLINK_INTERVAL - (int) time_diff(blinkTime);
+                key = menuWaitKey((wait > 0) ? wait : 0);
+            } while(key == 0);
+            if(key == MENU_TIMEOUT) key = 0;
         }
-        memset(player.name, '\0', sizeof(player.name));
-        memcpy(player.name, name_str, name_len);
+        memset(game.player.name, '\0', sizeof(game.player.name));
+        memcpy(game.player.name, name_str, name_len);
 
 
         return true;
@@ -642,7 +470,7 @@ bool highscoresPrompt(){
 void rearrangeScores(){
     int i;
     for(i=0 ; i < highScore.index ; i++){ // start from the greater score
-        if(player.score > highScore.player[i].score){
+        if(game.player.score > highScore.player[i].score){
             // pull everyone down starting from the end
             for(int j=(highScore.index-1); j > i ; j--){
                 strcpy(highScore.player[j].name, highScore.player[j-1].name);
@@ -652,8 +480,8 @@ void rearrangeScores(){
         }
     }
     // replace score
-    strcpy(highScore.player[i].name, player.name);
-    highScore.player[i].score = player.score;
+    strcpy(highScore.player[i].name, game.player.name);
+    highScore.player[i].score = game.player.score;
 }
 //**************************************************************************************
 
@@ -696,12 +524,69 @@ void printSymbolMenu(bool clean, int x, int y, enum symbolType symbol){
 }
 //**************************************************************************************
 
+/**
+ * @brief  Wait for a key without using the CPU, serving the metrics scrapes and
+ *         reading the art changes meanwhile
+ * @param  timeout: longest wait in milliseconds, negative to wait forever
+ * @retval The key pressed, zero if something else ended the wait, MENU_TIMEOUT
+ *         when the time is over
+ */
+int menuWaitKey(int timeout){
+    int fds[METRICS_MAX_CLIENTS + 2];
+    int count = 0, wait = timeout;
+    uint64_t startTime = get_clock();
+    bool pressed;
+
+    // anything printed with stdio is shown before waiting
+    fflush(stdout);
+    if(assetWatchFd >= 0) fds[count++] = assetWatchFd;
+    count += metrics_fds(&fds[count], METRICS_MAX_CLIENTS + 1, &wait);
+
+    pressed = wait_input(wait, fds, count);
+    metrics_poll();
+    // menus and prompts are printed whole every time they are shown, the game
+    // canvas is redrawn by the game loop
+    artChanged |= reloadFiles();
+
+    if(pressed){
+        metrics.inputEvents++;
+        return get_char();
+    }
+    if(timeout >= 0 && time_diff(startTime) >= timeout){
+        return MENU_TIMEOUT;
+    }
+    return 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print a widget text, if it changed since it was last printed
+ * @param  text: new text, the rest of the old one is erased
+ * @retval None
+ */
+void widgetDraw(WIDGET *widget, const char *text){
+    char line[WIDGET_MAX_TEXT];
+    int len = strlen(widget->shown);
+
+    if(strncmp(widget->shown, text, WIDGET_MAX_TEXT - 1) == 0){
+        return;
+    }
+    snprintf(line, sizeof(line), "%-*s", len, text);
+    metrics.bytesWritten += gotoxy(widget->x, widget->y);
+    metrics.bytesWritten += printf("%s", line);
+    #if LINUX_EN
+        screen_apply_text(&screen, widget->x, widget->y, line, encoder.theme);
+    #endif
+    snprintf(widget->shown, sizeof(widget->shown), "%s", text);
+}
+//**************************************************************************************
+
 /**
  * @brief  Handle a menu symbol movement
  * @retval The selected option index starting from zero
  */
 int symbolMenuMovement(int initialX, int initialY, int upperLimitX, int bottomLimitX, int leap, enum symbolType symbol){
-    char key = 0;
+    int key = 0;
 
     int i = initialX;
     int j = initialY;
@@ -710,8 +595,8 @@ int symbolMenuMovement(int initialX, int initialY, int upperLimitX, int bottomLi
     if(symbol == symbArrow) printSymbolMenu(false, i, j, symbArrow);
 
     while(key != ENTER){
-        if(kbhit()){
-            key = get_char();
+        key = menuWaitKey(-1);
+        if(key != 0){
             // clear symbol
             if(symbol == symbArrow) printSymbolMenu(true, i, j, symbArrow);
             else if(symbol == symbX) printSymbolMenu(true, i, j, symbX);
@@ -750,25 +635,46 @@ int symbolMenuMovement(int initialX, int initialY, int upperLimitX, int bottomLi
 }
 //**************************************************************************************
 
+/**
+ * @brief  Clear the whole screen
+ * @retval None
+ */
+void clearScreen(){
+#if WINDOWS_EN
+    clrscr();
+#else
+    // no clear command to run, the terminal clears itself with the theme
+    metrics.bytesWritten += render_clear(&output);
+    screen_fill(&screen, ' ', encoder.theme);
+    writeOutput();
+#endif
+}
+//**************************************************************************************
+
 /**
  * @brief  Print background
  * @retval None
  */
 void printBackground(char background[], int rows, int columns, int startRow, int StartColumn){
 
+    clearScreen();
+#if WINDOWS_EN
     char ch = 0;
-    clrscr();
     for(int i = 0; i < rows; i++){
         for(int j = 0; j < columns; j++){
             ch = background[ (i * columns) + j];
             if(ch != '\0'){
-                gotoxy((i + startRow),(j + StartColumn));
-                printf("%c", ch);
+                metrics.bytesWritten += gotoxy((i + startRow),(j + StartColumn));
+                metrics.bytesWritten += glyph_print(ch);
             }
         }
     }
     // force terminal output update
     fflush(stdout);
+#else
+    metrics.bytesWritten += render_art(&output, &encoder, &screen, background, rows, columns, startRow, StartColumn, false);
+    writeOutput();
+#endif
 }
 //**************************************************************************************
 
@@ -787,7 +693,10 @@ void mainMenu(){
         switch(option){
              // play
             case 0:{
+                gameQuit = false;
                 gameLoop();
+                // the autopilot plays game after game, until one is quit
+                while(autopilotOn && !gameQuit) gameLoop();
             } break;
              // options
             case 1:{
@@ -802,7 +711,6 @@ void mainMenu(){
                 endMenu = true;
             }
         }
-        msleep(10);
     }
 }
 //**************************************************************************************
@@ -815,18 +723,18 @@ void optionsMenu(){
     enum difficulty difficulty;
     enum theme theme;
     bool endMenu = false;
-    int option, initialX1, initialX2;
+    int option, initialX1 = 12, initialX2 = 19;
 
 
     while(!endMenu){
         printBackground(backGround.optionsMenu, OPTIONS_MENU_ROWS, OPTIONS_MENU_COLUMNS, OPTIONS_MENU_X, OPTIONS_MENU_Y);
         // print the already set difficulty or theme
-        switch(player.difficulty){
+        switch(game.player.difficulty){
             case easy   : initialX1 = 12; printSymbolMenu(false, initialX1, 38, symbX); break;
             case normal : initialX1 = 14; printSymbolMenu(false, initialX1, 38, symbX); break;
             case hard   : initialX1 = 16; printSymbolMenu(false, initialX1, 38, symbX); break;
         }
-        switch(player.theme){
+        switch(game.player.theme){
             case light   : initialX2 = 19; printSymbolMenu(false, initialX2, 38, symbX); break;
             case vanilla : initialX2 = 21; printSymbolMenu(false, initialX2, 38, symbX); break;
             case dark    : initialX2 = 23; printSymbolMenu(false, initialX2, 38, symbX); break;
@@ -841,9 +749,9 @@ void optionsMenu(){
             case 0: {
                 difficulty = symbolMenuMovement(initialX1, 38, 12, 16, 2, symbX);
                 switch(difficulty){
-                    case easy   : player.difficulty = easy; break;   // x=12, y=38
-                    case normal : player.difficulty = normal; break; // x=14, y=38
-                    case hard   : player.difficulty = hard; break;   // x=16, y=38
+                    case easy   : game.player.difficulty = easy; break;   // x=12, y=38
+                    case normal : game.player.difficulty = normal; break; // x=14, y=38
+                    case hard   : game.player.difficulty = hard; break;   // x=16, y=38
                 }
             } break;
             // get the theme selection
@@ -852,21 +760,22 @@ void optionsMenu(){
                 if (WINDOWS_EN)
                 {
                     switch(theme){
-                        case light   : system("Color 71"); player.theme = light; break;   // x=19, y=38
-                        case vanilla : system("Color 07"); player.theme = vanilla; break; // x=21, y=38
-                        case dark    : system("color 06"); player.theme = dark; break;    // x=23, y=38
-                        case matrix  : system("Color 0A"); player.theme = matrix; break;  // x=25, y=38
+                        case light   : system("Color 71"); game.player.theme = light; break;   // x=19, y=38
+                        case vanilla : system("Color 07"); game.player.theme = vanilla; break; // x=21, y=38
+                        case dark    : system("color 06"); game.player.theme = dark; break;    // x=23, y=38
+                        case matrix  : system("Color 0A"); game.player.theme = matrix; break;  // x=25, y=38
                     }
                 }
                 else
                 {
                     // ANSI color codes
                     switch(theme){
-                        case light   : printf("\e[47m \e[1;34m"); player.theme = light; break; // x=19, y=38
-                        case vanilla : printf("\x1b[0m"); player.theme = vanilla; break;       // x=21, y=38
-                        case dark    : printf("\x1b[33m"); player.theme = dark; break;         // x=23, y=38
-                        case matrix  : printf("\e[1;92m"); player.theme = matrix; break;       // x=25, y=38
+                        case light   : render_theme(&output, &encoder, ATTR_BG(white) | ATTR_FG(blue) | ATTR_BOLD); game.player.theme = light; break; // x=19, y=38
+                        case vanilla : render_theme(&output, &encoder, 0); game.player.theme = vanilla; break;                                    // x=21, y=38
+                        case dark    : render_theme(&output, &encoder, ATTR_FG(yellow)); game.player.theme = dark; break;                         // x=23, y=38
+                        case matrix  : render_theme(&output, &encoder, ATTR_FG(green) | ATTR_BOLD); game.player.theme = matrix; break;            // x=25, y=38
                     }
+                    writeOutput();
                 }
             } break;
             case ESC: endMenu = true; break;
@@ -880,188 +789,368 @@ void optionsMenu(){
  * @retval None
  */
 void gameLoop(){
-    int key = 0;
-
-    static ARCHER archer = {.active = true,
-                            .keyHitLimit = false,
-                            .x = ARCHER_INITIAL_X,
-                            .y = ARCHER_INITIAL_Y,
-                            .startTimeKeyHitLimit = 0 };
-
-    ARROW arrow = { .active = {false},
-                    .stagger = false,
-                    .keyHitLimit = false,
-                    .x = {0},
-                    .y = {0},
-                    .index = 0,
-                    .activeIndex = 0,
-                    .startTimeStagger = 0,
-                    .startTimeKeyHitLimit = 0 };
-
-    BALLOON balloon = { .active = {false},
-                        .stagger  = false,
-                        .individualStagger = {false},
-                        .x = {0},
-                        .y = {0},
-                        .activeIndex = 0,
-                        .IndividualDelay = {0},
-                        .startTimeStagger = 0,
-                        .startTimeIndividualStagger = {0} };
-
-    MONSTER monster = { .active = {0},
-                        .stagger = false,
-                        .spawn = false,
-                        .x = {0},
-                        .y = {0},
-                        .index = 0,
-                        .activeIndex = 0,
-                        .startTimeStagger = 0,
-                        .startTimeSpawn = 0 };
-
-
-    // just need to execute one time
-    if(player.level == 1){
-        // reset archer position and state
-        archer.active = true;
-        archer.x = ARCHER_INITIAL_X;
-        archer.y = ARCHER_INITIAL_Y;
+    // a saved game goes on where it was quit, a recording or the autopilot
+    // starts a new one and leaves the save for the player
+    bool resumed = (game.player.level == 1 && recordFile == NULL && !autopilotOn) && resumeGame();
 
+    if(resumed){
         printBackground(backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, 0, 0);
-        printNumberInGame(highScore.player[0].score, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+        gameRedraw(&game, backGround.game);
+        printNumberInGame(&game, highScore.player[0].score, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+        // the game time goes on from the saved one
+        setGameClock(game.now);
+        rewind_clear(&history);
     }
-    // print score
-    printNumberInGame(player.score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
-    // print the level number
-    printNumberInGame(player.level, 2, 39, "%03i");
-    setLevelPreset();
-
-    #if DEBUG_MODE
-        specialInterface(arrow, balloon, monster, true);
-    // print arrows left
-    #else
-        for(int i=0; i < MAX_ARROW_QUANTITY; i++){ //erase arrows left
-            gameLayer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-MAX_ARROW_QUANTITY)+ i] = ' ';
+    else{
+        // just need to execute one time
+        if(game.player.level == 1){
+            printBackground(backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, 0, 0);
+            printNumberInGame(&game, highScore.player[0].score, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+            rewind_clear(&history);
         }
-
-        for(int i=0; i < preset.arrowQuantity; i++){ //print arrows left
-            gameLayer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-preset.arrowQuantity)+ i] = ARROW_LEFT_DISPLAY_SYMBOL;
+        // the next level starts on the tick the last one ended, as in a replay
+        if(game.player.level == 1) game.now = gameClock(get_clock());
+        else setGameClock(game.now);
+        if(recordFile != NULL && game.player.level == 1){
+            // a known seed, so the game can be played again
+            uint32_t seed = (uint32_t) get_clock();
+            gameSeed(&game, seed);
+            replay_init(&recording, seed, game.player.difficulty, 1);
+            startTimeRecord = game.now;
         }
-    #endif
-
-    switch(preset.levelType){
-        case balloonLevel: {
-            setBalloonFirstRowPosition(&balloon);
-            balloon.startTimeStagger = get_clock();
-        } break;
-        case monsterLevel: {
-            setMonsterFirstPosition(&monster);
-            monster.startTimeSpawn = get_clock();
-        } break;
-        case balloonScatteredLevel: {
-            setBalloonScatteredPostition(&balloon);
-            for(int i=0; i < BALLOON_QUANTITY; i++){
-                balloon.startTimeIndividualStagger[i] = get_clock();
-            }
-        } break;
+        gameStartLevel(&game);
     }
+    metrics.level = game.player.level;
+
+    #if DEBUG_MODE
+        specialInterface(true);
+    #endif
 
     // time
     #if DEBUG_MODE
         fps.startTimeOneSecod = get_clock();
     #endif
-    fps.startTimeDelay = arrow.startTimeStagger = get_clock();
-    while(!player.gameOver && !player.levelOver) {
-        show(&archer, &arrow, &balloon, &monster);
-
-        if(kbhit()){
-            key = get_char();
-
-            switch(key){
-                case 'w': case 'W': case UP: archerMovUp(&archer); break;
-                case 's': case 'S': case DOWN: archerMovDown(&archer); break;
-                case SPACE: arrowShoot(archer, &arrow); break;
-                case ESC:{
-                    // PAUSE MENU
-                    uint64_t spentTime;
-                    spentTime =  setQuitGamePrompt(prompt.quitGamePrompt);
-                    // Update time
-                    arrow.startTimeKeyHitLimit += spentTime;
-                    switch((int)preset.levelType){
-                        case monsterLevel: monster.startTimeSpawn += spentTime; break;
-                        default: break;
-                    }
-                }  break;
+    fps.startTimeDelay = get_clock();
+    // a slow terminal must not hold the simulation back
+    display_start(&display, &output, &encoder, &screen);
+    // nor keys wait for a loop pass to be read
+    input_start(&input);
+    while(!game.player.gameOver && !game.player.levelOver) {
+        double tickCpu = cpu_clock();
+        INPUT_EVENT event;
+        bool paused = false;
+
+        // each key is played at the game time it was read, in order
+        while(!game.player.gameOver && !game.player.levelOver && input_pop(&input, &event)){
+            metrics.inputEvents++;
+
+            if(event.key == ESC){
+                // PAUSE MENU
+                uint64_t spentTime;
+                // the prompt prints and reads on this thread
+                input_stop(&input);
+                display_stop(&display);
+                spentTime =  setQuitGamePrompt(prompt.quitGamePrompt);
+                display_start(&display, &output, &encoder, &screen);
+                input_start(&input);
+                // Update time
+                pausedTime += spentTime;
+                fps.startTimeDelay += spentTime;
+                paused = true;
+                break;
+            }
+            if(event.key == REWIND_KEY && recordFile == NULL){
+                // back a few seconds, the game time goes on from there
+                if(rewind_back(&history, &game, REWIND_STEP) > 0){
+                    setGameClock(game.now);
+                    gameRedraw(&game, backGround.game);
+                    printNumberInGame(&game, highScore.player[0].score, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+                }
+                continue;
             }
+            // a key read before a rewind is played after it
+            gameStep(event.key, gameClock(event.time));
         }
-
-        //TIME CONTROL
-        archer.keyHitLimit = keyHitControl(archer.startTimeKeyHitLimit, preset.archerHitDelay);
-        arrow.stagger = staggerControl(&arrow.startTimeStagger, preset.arrowStaggerDelay);
-        arrow.keyHitLimit = keyHitControl(arrow.startTimeKeyHitLimit, preset.arrowHitDelay);
-        switch(preset.levelType){
-            case balloonLevel: {
-                balloon.stagger = staggerControl(&balloon.startTimeStagger, preset.balloonStaggerDelay);
-            } break;
-            case monsterLevel:{
-                monster.stagger = staggerControl(&monster.startTimeStagger, preset.monsterStaggerDelay);
-                spawnRateMonster(&monster, preset.monsterSpawnDelay);
-            }break;
-            case balloonScatteredLevel: {
-                staggerControlScatteredBalloon(&balloon);
+        if(paused || game.player.gameOver || game.player.levelOver) continue;
+
+        // art changed on disk, swapped between frames
+        uint32_t changed = reloadFiles() | artChanged;
+        artChanged = 0;
+        if(changed & ASSET_GAME_MASK){
+            gameRedraw(&game, (changed & ASSET_BIT(assetGame)) ? backGround.game : NULL);
+            if(changed & ASSET_BIT(assetGame)){
+                printNumberInGame(&game, highScore.player[0].score, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
             }
         }
 
+        gameStep(autopilotOn ? pilot_key(&pilot, &game) : 0, gameClock(get_clock()));
+        show();
+
         #if DEBUG_MODE
-            specialInterface(arrow, balloon, monster, false);
+            specialInterface(false);
         #endif
 
+        metrics.activeArrows = game.arrow.activeIndex;
+        metrics.activeBalloons = game.balloon.activeIndex;
+        metrics.activeMonsters = game.monster.activeIndex;
+        metrics.activeParticles = game.particle.count;
+        metrics.pilotPlans = pilot.plans;
+        metrics.pilotTicks = pilot.ticks;
+        metrics.pilotPlanWait = pilot.planWait;
+        metrics_tick(cpu_clock() - tickCpu);
+        metrics_poll();
     }
-    player.arrowsLeft += (preset.arrowQuantity - arrow.index);
-    player.score += (player.arrowsLeft * ARROW_LEFT_POINTS);
+    input_stop(&input);
+    display_stop(&display);
     //LEVELS
-    if(!player.gameOver){
-        player.level++;
-        player.levelOver = false;
-        if(player.level <= MAX_LEVEL){
-            gameLoop();
-        }
+    if(gameEndLevel(&game)){
+        gameLoop();
+        return;
     }
-    else{
-         // reset player status
+    if(recordFile != NULL){
+        recordKey(0);
+        replay_save(&recording, recordFile);
+        replay_free(&recording);
+    }
+    if(gameSaved){
+        // back to the menu, the score is kept for the resumed game
+        gameSaved = false;
+        gameReset(&game);
+    }
+    else if(autopilotOn){
+        // games of the autopilot don't make the high scores
+        gameReset(&game);
+    }
+    else if(game.player.gameOver){
         setGameOver(prompt.gameoverPrompt);
         if(highscoresPrompt()){
             rearrangeScores();
             writeHightScores();
         }
-         // reset player score
-        player.score = 0;
+         // reset player status and score
+        gameReset(&game);
     }
 }
 //**************************************************************************************
 
+/**
+ * @brief  Advance the local game to a game time
+ * @param  key: key read at that time or zero
+ * @param  time: game time, see gameClock()
+ * @retval None
+ */
+void gameStep(int key, uint64_t time){
+    // the key is recorded on the tick it was played
+    bool played = gameAdvance(&game, time, key);
+    if(recordFile != NULL) recordKey(played ? key : 0);
+    // a recording can't be rewound, a finished level is never gone back to
+    if(recordFile == NULL && !game.player.gameOver && !game.player.levelOver) rewind_push(&history, &game);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Game time of the local game
+ * @param  clock: get_clock() time
+ * @retval Game time in microseconds, it runs gameSpeed times the wall clock
+ *         and stops in the pause prompt
+ */
+uint64_t gameClock(uint64_t clock){
+    return (uint64_t) ((double) (clock - pausedTime) * gameSpeed);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Make the game time go on from a game time, after a rewind or a saved
+ *         game, see gameClock()
+ * @retval None
+ */
+void setGameClock(uint64_t time){
+    pausedTime = get_clock() - (uint64_t) ((double) time / gameSpeed);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Ticks of a recorded game played when a frame is drawn, the frames are
+ *         drawn FPS_LIMIT times per second of wall-clock time, see --speed
+ * @param  frame: frame number, from one
+ * @retval Env steps since the game started
+ */
+uint64_t frameTicks(uint64_t frame){
+    double ticks = (double) frame * 1000000 * gameSpeed / ((double) FPS_LIMIT * ENV_TICK);
+    // rounded up, the deadline is passed on that tick
+    return ((double) (uint64_t) ticks < ticks) ? (uint64_t) ticks + 1 : (uint64_t) ticks;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Record a key of the local game, see --record
+ * @param  key: key played on the current tick, zero to only account the game time
+ * @retval None
+ */
+void recordKey(int key){
+    enum envAction action = envNoop;
+    // env ticks start one tick after the level
+    uint64_t tick = (game.now - startTimeRecord) / ENV_TICK;
+    tick = (tick > 0) ? tick - 1 : 0;
+
+    switch(key){
+        case 'w': case 'W': case UP: action = envUp; break;
+        case 's': case 'S': case DOWN: action = envDown; break;
+        case SPACE: action = envShoot; break;
+    }
+    replay_add(&recording, tick, action);
+    if(recording.ticks <= tick) recording.ticks = tick + 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play recorded games headless, building their frames as the game does
+ * @note   The frames are thrown away, it trains the profile of make pgo
+ * @retval Zero if every file was played
+ */
+int replaySessions(int count, char *files[]){
+    OUTBUFFER out;
+    ENCODER replayEncoder;
+    SCREEN replayScreen;
+    ENV env;
+    REPLAY replay;
+    uint64_t ticks = 0, frames = 0, bytes = 0;
+    uint64_t startTime = get_clock(), startTimeFrame;
+    double frameTime = 0;
+
+    outbuf_init(&out);
+    for(int f = 0; f < count; f++){
+        if(!replay_load(&replay, files[f])){
+            printf("Invalid replay: %s\n", files[f]);
+            outbuf_free(&out);
+            return 1;
+        }
+        encoder_init(&replayEncoder, render_caps("xterm-256color"));
+        render_clear(&out);
+        screen_fill(&replayScreen, ' ', 0);
+        render_art(&out, &replayEncoder, &replayScreen, backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, 0, 0, false);
+        outbuf_consume(&out, out.len);
+
+        replay_start(&replay, &env);
+        int next = 0;
+        for(uint64_t frame = 1; env.steps < replay.ticks && !env.done; frame++){
+            replay_play(&replay, &env, &next, (frameTicks(frame) < replay.ticks) ? frameTicks(frame) : replay.ticks);
+            // a frame on every FPS_LIMIT deadline
+            if(env.steps == frameTicks(frame)){
+                startTimeFrame = get_clock();
+                bytes += render_layer(&out, &replayEncoder, &replayScreen, env.game.layer, env.game.attr);
+                memset(env.game.layer, '\0', sizeof(env.game.layer));
+                memset(env.game.attr, 0, sizeof(env.game.attr));
+                outbuf_consume(&out, out.len);
+                frameTime += time_diff(startTimeFrame);
+                frames++;
+            }
+        }
+        ticks += env.steps;
+        replay_free(&replay);
+    }
+    outbuf_free(&out);
+
+    double elapsed = time_diff(startTime);
+    // us/frame is the time spent drawing, us/tick counts everything
+    printf("%d replay(s): %" PRIu64 " ticks, %" PRIu64 " frames, %.2f bytes/frame in %.1f ms, %.3f us/tick, %.3f us/frame\n",
+           count, ticks, frames, (frames > 0) ? (double) bytes / frames : 0, elapsed, (ticks > 0) ? elapsed * 1000 / ticks : 0,
+           (frames > 0) ? frameTime * 1000 / frames : 0);
+    return 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write recorded games to an asciicast file, one after the other
+ * @param  path: asciicast file
+ * @note   The games are played headless at full speed, each frame is stamped
+ *         with the game time it is drawn at, as it was played
+ * @retval Zero if every file was written
+ */
+int castSessions(const char *path, int count, char *files[]){
+    OUTBUFFER out;
+    ENCODER castEncoder;
+    SCREEN castScreen;
+    ENV env;
+    REPLAY replay;
+    CAST cast;
+    double startTime = 0; // s, where the game starts in the cast
+
+    if(!cast_open(&cast, path, (count == 1) ? files[0] : NULL)){
+        printf("Can't create %s\n", path);
+        return 1;
+    }
+    outbuf_init(&out);
+    for(int f = 0; f < count; f++){
+        if(!replay_load(&replay, files[f])){
+            printf("Invalid replay: %s\n", files[f]);
+            outbuf_free(&out);
+            cast_close(&cast);
+            return 1;
+        }
+        // any terminal the cast is played on knows ECH, as a viewer of --server does
+        encoder_init(&castEncoder, RENDER_CAP_ECH);
+        render_clear(&out);
+        outbuf_append(&out, "\033[?25l", 6);
+        screen_fill(&castScreen, ' ', 0);
+        render_art(&out, &castEncoder, &castScreen, backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, 0, 0, false);
+        cast_output(&cast, startTime, out.data, out.len);
+        outbuf_consume(&out, out.len);
+
+        replay_start(&replay, &env);
+        int next = 0;
+        // a frame on every FPS_LIMIT deadline, and the last one
+        for(uint64_t frame = 1; env.steps < replay.ticks && !env.done; frame++){
+            replay_play(&replay, &env, &next, (frameTicks(frame) < replay.ticks) ? frameTicks(frame) : replay.ticks);
+            render_layer(&out, &castEncoder, &castScreen, env.game.layer, env.game.attr);
+            memset(env.game.layer, '\0', sizeof(env.game.layer));
+            memset(env.game.attr, 0, sizeof(env.game.attr));
+            cast_output(&cast, startTime + (double) (env.steps * ENV_TICK) / 1000000 / gameSpeed, out.data, out.len);
+            outbuf_consume(&out, out.len);
+        }
+        startTime += (double) (env.steps * ENV_TICK) / 1000000 / gameSpeed;
+        replay_free(&replay);
+    }
+    outbuf_free(&out);
+
+    if(!cast_close(&cast)){
+        printf("Can't write %s\n", path);
+        return 1;
+    }
+    printf("%d replay(s): %" PRIu64 " events, %" PRIu64 " bytes, %.1f s written to %s\n",
+           count, cast.events, cast.bytes, startTime, path);
+    return 0;
+}
+//**************************************************************************************
+
 /**
  * @brief  Print a prompt
  * @retval None
  */
 void printPrompt(char prompt[], int rows, int columns, int startRow, int startColumn, bool clean){
 
+#if WINDOWS_EN
     if(!clean){
         for(int i = 0; i < rows; i++){
             for(int j = 0; j < columns; j++){
-                gotoxy((i + startRow),(j + startColumn));
-                printf("%c", prompt[ (i * columns) + j]);
+                metrics.bytesWritten += gotoxy((i + startRow),(j + startColumn));
+                metrics.bytesWritten += glyph_print(prompt[ (i * columns) + j]);
             }
         }
     }
     else{
         for(int i = 0; i < rows; i++){
             for(int j = 0; j < columns; j++){
-                gotoxy((i + startRow),(j + startColumn));
-                printf(" ");
+                metrics.bytesWritten += gotoxy((i + startRow),(j + startColumn));
+                metrics.bytesWritten += printf(" ");
             }
         }
     }
     fflush(stdout);
+#else
+    metrics.bytesWritten += render_art(&output, &encoder, &screen, prompt, rows, columns, startRow, startColumn, clean);
+    writeOutput();
+#endif
 }
 //**************************************************************************************
 
@@ -1075,14 +1164,14 @@ uint64_t setQuitGamePrompt(char prompt[]){
     startTime = get_clock();
 
     printPrompt(prompt, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_X, QUITGAME_PROMPT_Y, false);
-    char key = 0;
+    int key = 0;
     do{
-        key = get_char();
-        msleep(10);
+        key = menuWaitKey(-1);
     } while(key != ENTER && key != ESC);
 
     switch(key){
-        case ENTER: player.gameOver = true; break;
+        // as for resuming, an unattended or recorded game leaves the save alone
+        case ENTER: gameSaved = (recordFile == NULL && !autopilotOn) && saveGame(); gameQuit = true; game.player.gameOver = true; break;
         case ESC: printPrompt(0, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_X, QUITGAME_PROMPT_Y, true); break;
     }
 
@@ -1098,148 +1187,25 @@ uint64_t setQuitGamePrompt(char prompt[]){
  * @retval None
  */
 void setGameOver(char prompt[]){
-    clrscr();
+    clearScreen();
     // balloon
     printPrompt(prompt, GAMEOVER_PROMPT_ROWS, GAMEOVER_PROMPT_COLUMNS, GAMEOVER_PROMPT_X, GAMEOVER_PROMPT_Y, false);
-    gotoxy(11,41); printf("%03i", player.balloonsDestroyed);
+    gotoxy(11,41); printf("%03i", game.player.balloonsDestroyed);
     gotoxy(11,47); printf("%03i", BALLOON_POINTS);
-    gotoxy(11,53); printf("%06i", player.balloonsDestroyed * BALLOON_POINTS);
+    gotoxy(11,53); printf("%06i", game.player.balloonsDestroyed * BALLOON_POINTS);
     // monster
-    gotoxy(13,41); printf("%03i", player.monstersKilled);
+    gotoxy(13,41); printf("%03i", game.player.monstersKilled);
     gotoxy(13,47); printf("%03i", MONSTER_POINTS);
-    gotoxy(13,53); printf("%06i", player.monstersKilled * MONSTER_POINTS);
+    gotoxy(13,53); printf("%06i", game.player.monstersKilled * MONSTER_POINTS);
     // arrows
-    gotoxy(15,41); printf("%03i", player.arrowsLeft);
+    gotoxy(15,41); printf("%03i", game.player.arrowsLeft);
     gotoxy(15,47); printf("%03i", ARROW_LEFT_POINTS);
-    gotoxy(15,53); printf("%06i", player.arrowsLeft * ARROW_LEFT_POINTS);
+    gotoxy(15,53); printf("%06i", game.player.arrowsLeft * ARROW_LEFT_POINTS);
     // total score
-    gotoxy(17,36); printf("%06i", player.score);
-
-    fflush(stdout);
-
-    // RESET PLAYER STATUS
-    player.level = 1;
-    player.gameOver = false;
-    player.levelOver = false;
-    player.balloonsDestroyed = 0;
-    player.monstersKilled = 0;
-    player.arrowsLeft = 0;
-
-    memset(gameLayer, '\0', sizeof(gameLayer));
-
-    char key = 0;
-    do{
-        key = get_char();
-        msleep(10);
-    } while(key != ENTER);
-
-}
-//**************************************************************************************
-
-/**
- * @brief  Configure entities characteristics based on the level
- * @retval None
- */
-void setLevelPreset(){
-    static int nBalloonLevel, nMonsterLevel, nBalloonScatteredLevel;
-
-    if(player.level == 1){ //Reset
-        nBalloonLevel = 0;
-        nMonsterLevel = 0;
-        nBalloonScatteredLevel = 0;
-    }
-
-    setDifficultyPreset(); // set the start status based on the difficulty
-    for(int i=0; i <= (MAX_LEVEL-N_LEVEL_TYPES); i+=N_LEVEL_TYPES){
-        if(player.level == (i+1)){ // BALLOON LEVEL
-            preset.levelType = balloonLevel;
-            if(nBalloonLevel == 0){
-                preset.balloonInitialX = BALLOON_ROW_INITIAL_X;
-            }
-            else{
-                preset.balloonInitialX = BALLOON_LOWER_LIMIT;
-            }
-            preset.balloonStaggerDelay -= nBalloonLevel*5;
-            preset.arrowHitDelay += nBalloonLevel*5;
-            preset.archerHitDelay += nBalloonLevel*5;
-            nBalloonLevel++;
-            break;
-        }
-        else if(player.level == (i+2)){ // MONSTER LEVEL
-            preset.levelType = monsterLevel;
-            preset.monsterStaggerDelay -= nMonsterLevel*5;
-            preset.arrowHitDelay += nMonsterLevel*5;
-            preset.archerHitDelay += nMonsterLevel*5;
-            nMonsterLevel++;
-            break;
-        }
-        else if(player.level == (i+3)){ // SCATTERED BALLOON LEVEL
-            preset.levelType = balloonScatteredLevel;
-            preset.balloonInitialX = BALLOON_LOWER_LIMIT;
-            preset.balloonScatteredDelayMax -= nBalloonScatteredLevel*5;
-            preset.balloonScatteredDelayMin -= nBalloonScatteredLevel*5;
-            preset.arrowHitDelay += nBalloonScatteredLevel*5;
-            preset.archerHitDelay += nBalloonScatteredLevel*5;
-            nBalloonScatteredLevel++;
-            break;
-        }
-    }
-
-    switch(preset.levelType){
-        case balloonLevel: case balloonScatteredLevel:{
-            preset.arrowConsumableArrows = false;
-            preset.arrowQuantity = BALLOON_ARROW_QUANTITY;
-        } break;
-        case monsterLevel:{
-            preset.arrowConsumableArrows = true;
-            preset.arrowQuantity = MONSTER_ARROW_QUANTITY;
-        } break;
-    }
-}
-//**************************************************************************************
+    gotoxy(17,36); printf("%06i", game.player.score);
 
-/**
- * @brief  Configure entity characteristics based on the difficulty
- * @retval None
- */
-void setDifficultyPreset(){
-
-    switch(player.difficulty){
-        case easy: {
-            preset.archerHitDelay = E_ARCHER_HIT_DELAY;
-            preset.arrowHitDelay = E_ARROW_HIT_DELAY;
-            preset.arrowStaggerDelay = E_ARROW_STAGGER_DELAY;
-            preset.balloonStaggerDelay = E_BALLOON_STAGGER_DELAY;
-            preset.balloonScatteredDelayMax = E_BALLOON_SCATTERED_DELAY_MAX;
-            preset.balloonScatteredDelayMin = E_BALLOON_SCATTERED_DELAY_MIN;
-            preset.monsterStaggerDelay = E_MONSTER_STAGGER_DELAY;
-            preset.monsterSpawnDelay = E_MONSTER_SPAWN_DELAY;
-            printStringInGame("Easy", 1, 8);
-        } break;
-        case normal:{
-            preset.archerHitDelay = M_ARCHER_HIT_DELAY;
-            preset.arrowHitDelay = M_ARROW_HIT_DELAY;
-            preset.arrowStaggerDelay = M_ARROW_STAGGER_DELAY;
-            preset.balloonStaggerDelay = M_BALLOON_STAGGER_DELAY;
-            preset.balloonScatteredDelayMax = M_BALLOON_SCATTERED_DELAY_MAX;
-            preset.balloonScatteredDelayMin = M_BALLOON_SCATTERED_DELAY_MIN;
-            preset.monsterStaggerDelay = M_MONSTER_STAGGER_DELAY;
-            preset.monsterSpawnDelay = M_MONSTER_SPAWN_DELAY;
-            printStringInGame("Normal", 1, 8);
+    while(menuWaitKey(-1) != ENTER);
 
-        } break;
-        case hard:{
-            preset.archerHitDelay = H_ARCHER_HIT_DELAY;
-            preset.arrowHitDelay = H_ARROW_HIT_DELAY;
-            preset.arrowStaggerDelay = H_ARROW_STAGGER_DELAY;
-            preset.balloonStaggerDelay = H_BALLOON_STAGGER_DELAY;
-            preset.balloonScatteredDelayMax = H_BALLOON_SCATTERED_DELAY_MAX;
-            preset.balloonScatteredDelayMin = H_BALLOON_SCATTERED_DELAY_MIN;
-            preset.monsterStaggerDelay = H_MONSTER_STAGGER_DELAY;
-            preset.monsterSpawnDelay = H_MONSTER_SPAWN_DELAY;
-            printStringInGame("Hard", 1, 8);
-        } break;
-    }
 }
 //**************************************************************************************
 
@@ -1247,7 +1213,7 @@ void setDifficultyPreset(){
  * @brief  Print debug information
  * @retval None
  */
-void specialInterface(ARROW arrow, BALLOON balloon, MONSTER monster, bool printTags){
+void specialInterface(bool printTags){
 
     if(printTags){
         hide_cursor(false);
@@ -1257,24 +1223,26 @@ void specialInterface(ARROW arrow, BALLOON balloon, MONSTER monster, bool printT
         gotoxy(3,46); printf("Active Arrows:");
         gotoxy(1,23); printf("Arrows:");
         gotoxy(2,23); printf("Monsters:");
+        // printed behind the encoder back
+        screen_fill(&screen, '\0', 0);
     }
 
     // active balloons
-    printNumberInGame(balloon.activeIndex, 1, 62, "%02i");
+    printNumberInGame(&game, game.balloon.activeIndex, 1, 62, "%02i");
 
     // active arrows
-    printNumberInGame(arrow.activeIndex, 3, 60, "%02i");
+    printNumberInGame(&game, game.arrow.activeIndex, 3, 60, "%02i");
 
     // active monsters
-    printNumberInGame(monster.activeIndex, 2, 62, "%02i");
+    printNumberInGame(&game, game.monster.activeIndex, 2, 62, "%02i");
 
     // arrows left
-    int arrowLeft = (preset.arrowQuantity - arrow.index);
-    printNumberInGame(arrowLeft, 1, 30, "%02i");
+    int arrowLeft = (game.preset.arrowQuantity - game.arrow.index);
+    printNumberInGame(&game, arrowLeft, 1, 30, "%02i");
 
     // monsters left
-    int monsterLeft = (MONSTER_QUANTITY - monster.index);
-    printNumberInGame(monsterLeft, 2, 32, "%02i");
+    int monsterLeft = (MONSTER_QUANTITY - game.monster.index);
+    printNumberInGame(&game, monsterLeft, 2, 32, "%02i");
 
 }
 //**************************************************************************************
@@ -1283,34 +1251,43 @@ void specialInterface(ARROW arrow, BALLOON balloon, MONSTER monster, bool printT
  * @brief  Update screen
  * @retval None
  */
-void show(ARCHER *archer, ARROW *arrow, BALLOON *balloon, MONSTER *monster){
-
-    switch(preset.levelType){
-        case balloonLevel: case balloonScatteredLevel: {
-            hitBalloonDetector(&(*arrow), &(*balloon));
-        } break;
-        case monsterLevel:{
-            hitMonsterDetector(&(*arrow), &(*monster));
-            player.gameOver = hitArcherDetector(&(*archer), &(*monster));
-        } break;
-    }
-    // update actions in game
-    update(&(*archer), &(*arrow), &(*balloon), &(*monster));
+void show(){
 
     // Frames per seconds (FPS) Control
-    if(time_diff(fps.startTimeDelay) >= fps.delay){
-        #if DEBUG_MODE
-            fps.frames++;
-        #endif
-        draw(); // print game screen
-        memset(gameLayer, '\0', sizeof(gameLayer));
-
+    double elapsed = time_diff(fps.startTimeDelay);
+    if(elapsed >= fps.delay){
+        // frame deadlines missed since the last frame
+        if(elapsed >= 2*fps.delay){
+            metrics.framesDropped += (uint64_t)(elapsed/fps.delay) - 1;
+        }
+        if(display.running){
+            // the render thread diffs, encodes and writes it, the newest frame replaces one it didn't take yet
+            if(display_publish(&display, game.layer, game.attr)){
+                metrics.framesCoalesced++;
+            }
+            #if DEBUG_MODE
+                fps.frames++;
+            #endif
+        }
+        else{
+            uint64_t startTimeFrame = get_clock();
+            int bytes = draw(); // print game screen
+            // nothing changed, nothing sent
+            if(bytes > 0){
+                #if DEBUG_MODE
+                    fps.frames++;
+                #endif
+                metrics_frame(time_diff(startTimeFrame), bytes);
+            }
+        }
+        memset(game.layer, '\0', sizeof(game.layer));
+        memset(game.attr, 0, sizeof(game.attr));
         fps.startTimeDelay = get_clock();
     }
     #if DEBUG_MODE
         if(time_diff(fps.startTimeOneSecod)  >= 1000){
             // print fps
-            printNumberInGame(fps.frames, 3, 73, "%04i");
+            printNumberInGame(&game, fps.frames, 3, 73, "%04i");
             fps.frames = 0;
             fps.startTimeOneSecod = get_clock();
         }
@@ -1318,583 +1295,55 @@ void show(ARCHER *archer, ARROW *arrow, BALLOON *balloon, MONSTER *monster){
 }
 //**************************************************************************************
 
-/**
- * @brief  Update entities movements
- * @retval None
- */
-void update(ARCHER *archer, ARROW *arrow, BALLOON *balloon, MONSTER *monster){
-
-    // Arrow
-    if(arrow->activeIndex > 0 && !arrow->stagger){
-        for(int i=0; i < arrow->index; i++){
-            if(arrow->active[i] && (arrow->y[i] < ARROW_RIGHT_LIMIT ) ){
-                gameLayer[arrow->x[i]][arrow->y[i]] = ' ';
-                arrow->y[i]++;
-
-                for(int j=0; j < ARROW_COLUMNS; j++){
-                    gameLayer[arrow->x[i]][arrow->y[i] + j] = skin.arrow[j];
-                }
-            }
-            else if(arrow->active[i]){
-                arrow->active[i] = false;
-                for(int j=0; j < ARROW_COLUMNS; j++){
-                    gameLayer[arrow->x[i]][arrow->y[i] + j] = ' ';
-                }
-                arrow->activeIndex--;
-            }
-        }
-    }
-    if(arrow->activeIndex == 0 && arrow->index == preset.arrowQuantity && (balloon->activeIndex > 0 || monster->activeIndex > 0)){
-        player.gameOver = true;
-    }
-
-    // Baloon
-    if(preset.levelType == balloonLevel || preset.levelType == balloonScatteredLevel){
-        if(balloon->activeIndex > 0 && !balloon->stagger){
-            for(int i=0; i < BALLOON_QUANTITY; i++){
-                if(balloon->active[i] && !balloon->individualStagger[i]){
-                    balloon->x[i]--;
-                    if(balloon->x[i] < (BALLOON_LOWER_LIMIT - BALLOON_ROWS)){
-                        for(int i2=0; i2 <= BALLOON_ROWS; i2++){
-                            if(balloon->x[i] > BALLOON_UPPER_LIMIT - i2){
-                                setBalloon(&(*balloon), i, i2, BALLOON_ROWS, true);
-                                break;
-                            }
-                            else if(i2 == BALLOON_ROWS) balloon->x[i] = BALLOON_LOWER_LIMIT - 1; //this one is why i3=1
-                        }
-                    }
-                    //can't be else!**
-                    if(balloon->x[i] >= (BALLOON_LOWER_LIMIT - BALLOON_ROWS)){
-                        for(int i3=1; i3 <= BALLOON_ROWS; i3++){
-                            if(balloon->x[i] == (BALLOON_LOWER_LIMIT - i3)){
-                                setBalloon(&(*balloon), i, 0, i3, false);
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        if(balloon->activeIndex == 0 && arrow->activeIndex == 0){
-            player.levelOver = true;
-        }
-    }
-
-    // Monster
-    if(preset.levelType == monsterLevel){
-        if(monster->activeIndex > 0 && !monster->stagger){
-            for(int i=0; i < monster->index; i++){
-                if(monster->active[i]){
-                    monster->y[i]--;
-                    //appearing from the right
-                    if(monster->y[i] > (MONSTER_RIGHT_LIMIT - MONSTER_COLUMNS)){
-                        for(int i2=1; i2 <= MONSTER_COLUMNS; i2++){
-                            if(monster->y[i] > (MONSTER_RIGHT_LIMIT - i2)){
-                                setMonster(&(*monster), i, 0, i2, false);
-                                break;
-                            }
-                        }
-                    }
-                    //in the middle of the screen
-                    else if(monster->y[i] >= (MONSTER_LEFT_LIMIT)){
-                        setMonster(&(*monster), i, 0, MONSTER_COLUMNS, true);
-                    }
-                    //disappearing from the left
-                    else{ // < MONSTER_LEFT_LIMIT
-                        for(int i3=0, i4=1; i3 > -MONSTER_COLUMNS; i3--, i4++){
-                            if(monster->y[i] == i3){
-
-                                for(int m=0; m < MONSTER_ROWS; m++){
-                                    for (int n=0, aux=i4; aux < MONSTER_COLUMNS; n++, aux++){
-                                        gameLayer[monster->x[i] + m][MONSTER_LEFT_LIMIT + n] = skin.monster[(m * MONSTER_COLUMNS) + aux];
-                                    }
-                                }
-                                for(int j=0; j < MONSTER_ROWS; j++){
-                                    gameLayer[monster->x[i] + j][MONSTER_COLUMNS+(i3)] = ' ';
-                                }
-                                if(i3 == -MONSTER_COLUMNS + 1){//turn off monster
-                                    monster->active[i] = false;
-                                    monster->activeIndex--;
-                                }
-                                break;
-                            }
-
-                        }
-                    }
-                }
-            }
-        }
-        if(monster->activeIndex == 0 && monster->index == MONSTER_QUANTITY && arrow->activeIndex == 0){
-            player.levelOver = true;
-        }
-    }
-
-    // Archer
-    if(archer->active){
-        for(int i=0; i < ARCHER_ROWS; i++){
-            for(int j=0; j < ARCHER_COLUMNS; j++){
-                gameLayer[archer->x + i][archer->y + j] = skin.archer[(i*ARCHER_COLUMNS) + j];
-            }
-        }
-        archer->active = false;
-    }
-
-}
-//**************************************************************************************
-
-
-/**
- * @brief  Detect monsters collisions
- * @retval None
- */
-void hitMonsterDetector(ARROW *arrow, MONSTER *monster){
-    if(arrow->activeIndex > 0 && monster->activeIndex >0){
-        for(int i=0; i < arrow->index; i++){
-            if(arrow->active[i]){
-                for(int j=0; j < monster->index; j++){
-                    if(monster->active[j]){
-                        // Y hitbox check
-                        for(int m=0; m < MONSTER_COLUMNS; m++){
-                            if(arrow->y[i] + ARROW_COLUMNS == monster->y[j] + m){
-                                // X hitbox check
-                                for(int n=0; n < MONSTER_ROWS; n++){
-                                    if(arrow->x[i] == monster->x[j] + n){
-                                        if(preset.arrowConsumableArrows){
-                                            arrow->active[i] = false;
-                                            for(int a=0; a < ARROW_COLUMNS; a++){
-                                                gameLayer[arrow->x[i]][arrow->y[i] + a] = ' ';
-                                            }
-                                            arrow->activeIndex--;
-                                        }
-                                        for(int m1=0; m1 < MONSTER_ROWS; m1++){
-                                            for(int m2=0; m2 < MONSTER_COLUMNS; m2++){
-                                                if((monster->y[j] + m2) < CANVAS_RIGHT_EDGE_Y){ //border limit
-                                                    gameLayer[monster->x[j] + m1][monster->y[j] + m2] = ' ';
-                                                }
-                                            }
-                                        }
-                                        monster->active[j] = false;
-                                        monster->activeIndex--;
-                                        player.monstersKilled++;
-                                        //score
-                                        player.score += MONSTER_POINTS;
-                                        printNumberInGame(player.score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
-                                        break;
-                                    }
-                                }
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Detect archer collisions
- * @retval True if hit detected
- */
-bool hitArcherDetector(ARCHER *archer, MONSTER *monster){
-    if(monster->activeIndex > 0){
-        for(int i=0; i < monster->index; i++){
-            if(monster->active[i]){
-                if(monster->y[i] < (ARCHER_COLUMNS+ARCHER_INITIAL_Y)){// Y hitbox 1
-                    //now just check the X hitbox
-                    for(int m=0; m < MONSTER_ROWS; m++){
-                        for(int a=0; a < ARCHER_ROWS; a++){
-                            if((monster->x[i] + m) == (archer->x + a)){
-                                // Y hitbox 2 <- more precision
-                                for(int m2=0; m2 < MONSTER_COLUMNS; m2++){
-                                    for(int a2=0; a2 < ARCHER_COLUMNS; a2++){
-                                        if((monster->y[i] + m2) == (archer->y + a2)){
-                                            if(skin.monster[(m * MONSTER_COLUMNS) + m2] != ' ' && skin.archer[(a * ARCHER_COLUMNS) + a2] != ' '){
-                                                return true;
-                                            }
-                                        }
-                                    }
-                                }
-                                if(!archer->active) archer->active = true; //keep archer fresh even if it's not moving
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return false;
-
-}
-//**************************************************************************************
-
-/**
- * @brief  Detect baloons collisions
- * @retval None
- */
-void hitBalloonDetector(ARROW *arrow, BALLOON *balloon){
-    if(arrow->activeIndex > 0 && balloon->activeIndex >0){
-        for(int i=0; i < arrow->index; i++){
-            if(arrow->active[i]){
-                for(int j=0; j < BALLOON_QUANTITY; j++){
-                    if(balloon->active[j]){
-                        // Y hitbox check
-                        for(int m=0; m < BALLOON_COLUMNS; m++){
-                            if(arrow->y[i] + ARROW_COLUMNS == balloon->y[j] + m){
-                                // X hitbox check
-                                for(int n=0; n < BALLOON_ROWS; n++){
-                                    if(arrow->x[i] == balloon->x[j] + n){
-                                        if(preset.arrowConsumableArrows){
-                                            arrow->active[i] = false;
-                                            for(int a=0; a < ARROW_COLUMNS; a++){
-                                                gameLayer[arrow->x[i]][arrow->y[i] + a] = ' ';
-                                            }
-                                            arrow->activeIndex--;
-                                        }
-                                        for(int b1=0; b1 < BALLOON_ROWS; b1++){
-                                            for(int b2=0; b2 < BALLOON_COLUMNS; b2++){
-                                                gameLayer[balloon->x[j] + b1][balloon->y[j] + b2] = ' ';
-                                            }
-                                        }
-                                        balloon->active[j] = false;
-                                        balloon->activeIndex--;
-                                        player.balloonsDestroyed++;
-                                        //score
-                                        player.score += BALLOON_POINTS;
-                                        printNumberInGame(player.score, SCORE_DISPLAY_X, SCORE_DISPLAY_Y, "%06i");
-                                        break;
-                                    }
-                                }
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Add a integer number to the game layer
- * @retval None
- */
-void printNumberInGame(int value, int x, int y, char format[4]){
-    char buf[10] = {0};
-    snprintf(buf, sizeof(buf),format, value);
-    for(int index=0; index < 10; index++){
-        if(buf[index] != '\0') gameLayer[x][y + index] = buf[index];
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Add a string to the game layer
- * @retval None
- */
-void printStringInGame(char *string, int x, int y){
-    char buf[10] = {0};
-    snprintf(buf, sizeof(buf),"%s", string);
-    for(int index=0; index < 10; index++){
-        if(buf[index] != '\0') gameLayer[x][y + index] = buf[index];
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Add monsters to the game layer
- * @retval None
- */
-void setMonster(MONSTER *monster, int i, int startColumn, int endColumn, bool clean){
-
-    for(int m=0; m < MONSTER_ROWS; m++){
-        for (int n=startColumn; n < endColumn; n++){
-            gameLayer[monster->x[i] + m][monster->y[i] + n] = skin.monster[(m * MONSTER_COLUMNS) + n];
-        }
-    }
-    if(clean){
-        for(int j=0; j < MONSTER_ROWS; j++){
-            gameLayer[monster->x[i] + j][monster->y[i] + MONSTER_COLUMNS] = ' ';
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Add baloons to the game layer
- * @retval None
- */
-void setBalloon(BALLOON *balloon, int  i, int startRow, int endRow, bool clean){
-
-    for(int m=startRow; m < endRow; m++){
-        for(int n=0; n < BALLOON_COLUMNS; n++){
-            gameLayer[balloon->x[i] + m][balloon->y[i] + n] = skin.balloon[(m * BALLOON_COLUMNS) + n];
-        }
-    }
-    if(clean){
-        for(int j=0; j < BALLOON_COLUMNS; j++){
-            gameLayer[balloon->x[i] + BALLOON_ROWS][balloon->y[i] + j] = ' ';
-        }
-    }
-}
-//**************************************************************************************
 
 /**
  * @brief  Print game layer to screen
- * @retval None
+ * @retval The number of bytes written
  */
-void draw(){
+int draw(){
+    int bytes = 0;
 
+#if WINDOWS_EN
     for(int i=0; i < CANVAS_ROWS; i++){
         if(i != CANVAS_UPPER_EDGE_X && i != CANVAS_MIDDLE_EDGE_X && i != CANVAS_LOWER_EDGE_X){
             for(int j=0; j < CANVAS_COLUMNS; j++){
                 if(j != CANVAS_LEFT_EDGE_Y && j != CANVAS_RIGHT_EDGE_Y){
-                    if(gameLayer[i][j] != '\0'){
-                        gotoxy(i,j);
-                        printf("%c", gameLayer[i][j]);
+                    if(game.layer[i][j] != '\0'){
+                        bytes += gotoxy(i,j);
+                        bytes += glyph_print(game.layer[i][j]);
                     }
                 }
             }
         }
     }
     fflush(stdout);
+#else
+    // only the cells that changed, see render_cells()
+    bytes = render_layer(&output, &encoder, &screen, game.layer, game.attr);
+    writeOutput();
+#endif
+    return bytes;
 }
 //**************************************************************************************
 
 /**
- * @brief  Move archer upwards
- * @retval None
- */
-void archerMovUp(ARCHER *archer){
-    if(time_diff(archer->startTimeKeyHitLimit) >= preset.archerHitDelay) archer->startTimeKeyHitLimit = get_clock();
-    if(!archer->keyHitLimit){
-        if(archer->x > ARCHER_UPPER_LIMIT){
-            for(int i=0; i < ARCHER_COLUMNS; i++){
-                gameLayer[archer->x + ARCHER_ROWS-1][archer->y + i] = ' ';
-            }
-            archer->x--;
-            archer->active = true;
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Move archer downwards
- * @retval None
- */
-void archerMovDown(ARCHER *archer){
-
-    if(time_diff(archer->startTimeKeyHitLimit) >= preset.archerHitDelay) archer->startTimeKeyHitLimit = get_clock();
-    if(!archer->keyHitLimit){
-        if(archer->x < ARCHER_LOWER_LIMIT){
-            for(int i=0; i < ARCHER_COLUMNS; i++){
-                gameLayer[archer->x][archer->y + i] = ' ';
-            }
-            archer->x++;
-            archer->active = true;
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Move arrows
- * @retval None
- */
-void arrowShoot(ARCHER archer, ARROW *arrow){
-
-    if(time_diff(arrow->startTimeKeyHitLimit) >= preset.arrowHitDelay) arrow->startTimeKeyHitLimit = get_clock();
-    if(!arrow->keyHitLimit){
-        if(arrow->index < preset.arrowQuantity){
-             // Decrease arrows left from display
-            if(!DEBUG_MODE)
-            {
-                gameLayer[ARROW_LEFT_DISPLAY_X][((CANVAS_RIGHT_EDGE_Y-1)-preset.arrowQuantity) + arrow->index] = ' ';
-            }
-
-            arrow->active[arrow->index] = true;
-            arrow->activeIndex++;
-            arrow->x[arrow->index] = archer.x + 1;
-            arrow->y[arrow->index] = archer.y + ARCHER_COLUMNS;
-
-            for(int i=0; i < ARROW_COLUMNS; i++){
-                gameLayer[ arrow->x[arrow->index] ][ arrow->y[arrow->index] + i] = skin.arrow[i];
-            }
-            arrow->index++;
-
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Read .txt files
- * @retval True if success
- */
-bool readTxtFiles(char matrixObject[], int row, int col, char txtFileName[]){
-    char buf[100];
-    FILE *pont_arq;
-    char read;
-    int file_size = 0;
-    char *rd_ptr = matrixObject;
-
-        snprintf(buf, sizeof(buf),"ascii_art%s%s.txt", FILE_SEPARATOR, txtFileName);
-        pont_arq = fopen(buf, "r");
-        if(pont_arq){
-            while(feof(pont_arq) == false){
-                if(fread(&read, sizeof(char), 1, pont_arq)){
-                    if (read != '\n' && read != '\r')
-                    {
-                        // Check file size
-                        if (file_size >= col * row)
-                        {
-                            clrscr();
-                            gotoxy(0,0);
-                            printf("Error, invalid file size. %s.txt -> %d chars\n", txtFileName, file_size);
-                            printf("Press ENTER to continue...\n");
-                            while(get_char() != ENTER) msleep(10);
-                            fclose(pont_arq);
-                            return false;
-                        }
-                        *rd_ptr++ = read;
-                        file_size++;
-                    }
-                }
-            }
-            fclose(pont_arq);
-        }
-        else{
-            clrscr();
-            gotoxy(0,0);
-            printf("Error in the opening of: %s.txt\n", txtFileName);
-            printf("Press ENTER to continue...\n");
-            while(get_char() != ENTER) msleep(10);
-            return false;
-        }
-
-    return true;
-}
-//**************************************************************************************
-
-/**
- * @brief  Keyboard pressing cooldown
- * @retval False if in cooldown
- */
-bool keyHitControl(uint64_t startTime, double delay){
-    if(time_diff(startTime) >= delay){
-        return false;
-    }
-    else{
-        return true;
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Entity movement cooldown
- * @retval False if in cooldown
- */
-bool staggerControl(uint64_t *startTime, double delay){
-
-    if(time_diff(*startTime) >= delay){
-        *startTime = get_clock();
-        return false;
-    }
-    else{
-        return true;
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Scattered balloons movement cooldown
- * @retval None
- */
-void staggerControlScatteredBalloon(BALLOON *balloon){
-
-    for(int i=0; i < BALLOON_QUANTITY; i++){
-        if(time_diff(balloon->startTimeIndividualStagger[i]) >= balloon->IndividualDelay[i]){
-            balloon->startTimeIndividualStagger[i] = get_clock();
-            balloon->individualStagger[i] = false;
-        }
-        else{
-            balloon->individualStagger[i] = true;
-        }
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Set baloons initial position
- * @retval None
- */
-void setBalloonFirstRowPosition(BALLOON *balloon){
-
-    balloon->activeIndex = BALLOON_QUANTITY;
-    for(int i=0; i < BALLOON_QUANTITY; i++){
-        balloon->x[i] = preset.balloonInitialX;
-        balloon->y[i] = BALLOON_ROW_INITIAL_Y + (i * (BALLOON_COLUMNS + 1));
-        balloon->active[i] = true;
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Set scattered baloons initial position
- * @retval None
- */
-void setBalloonScatteredPostition(BALLOON *balloon){
-    srand(time(0));
-    int max2 = preset.balloonScatteredDelayMax - preset.balloonScatteredDelayMin;
-
-    balloon->activeIndex = BALLOON_QUANTITY;
-    for(int i=0; i < BALLOON_QUANTITY; i++){
-        balloon->x[i] = preset.balloonInitialX;
-        balloon->y[i] = BALLOON_ROW_INITIAL_Y + (i * (BALLOON_COLUMNS + 1));
-        balloon->active[i] = true;
-        balloon->IndividualDelay[i] = preset.balloonScatteredDelayMin +  ( (rand() % max2)  + 1);
-    }
-}
-//**************************************************************************************
-
-/**
- * @brief  Set monsters initial position
+ * @brief  Send the queued output to the terminal, waiting for it if busy
  * @retval None
  */
-void setMonsterFirstPosition(MONSTER *monster){
-
-    int max = MONSTER_LOWER_LIMIT - MONSTER_UPPER_LIMIT;
-
-    for(int i=0; i < MONSTER_QUANTITY; i++){
-        monster->x[i] = MONSTER_UPPER_LIMIT + ( (rand() % max)  + 1);
-        monster->y[i] = MONSTER_INITIAL_Y;
-    }
-
-}
-//**************************************************************************************
-
-/**
- * @brief  Monster spawn cooldown
- * @retval False if in cooldown
- */
-bool spawnRateMonster(MONSTER *monster, double delay){
-
-    if(time_diff(monster->startTimeSpawn) >= delay){
-
-        if(monster->index < MONSTER_QUANTITY){
-            monster->active[monster->index] = true;
-            monster->activeIndex++;
-            monster->index++;
+void writeOutput(){
+#if LINUX_EN
+    // anything printed with stdio goes first
+    fflush(stdout);
+    while(output.len > 0){
+        int len = write(STDOUT_FILENO, output.data, output.len);
+        if(len < 0){
+            if(errno == EINTR) continue;
+            // terminal gone
+            output.len = 0;
+            break;
         }
-        monster->startTimeSpawn = get_clock();
-        return true;
+        outbuf_consume(&output, len);
     }
-    else{
-        return false;
-    }
-
+#endif
 }
 //**************************************************************************************
@@ -0,0 +1,469 @@
+/*******************************************************************************
+* @filename: metrics.c
+* @brief: Runtime counters and gauges published in Prometheus text format over
+*         a local UNIX domain socket
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "include/metrics.h"
+
+METRICS metrics = {0};
+
+static const double frameBucketsMs[METRICS_FRAME_BUCKETS] = METRICS_FRAME_BUCKETS_MS;
+
+/**
+ * @brief  Account one frame written to the terminal
+ * @param  frame_ms: time spent building and writing the frame
+ * @param  bytes: bytes written for the frame
+ */
+void metrics_frame(double frame_ms, int bytes)
+{
+    // counted before its bucket, see metrics_format()
+    metrics.framesRendered++;
+    metrics.frameTimeSum += (uint64_t) (frame_ms * 1000);
+    metrics.bytesWritten += bytes;
+
+    for (int i = 0; i < METRICS_FRAME_BUCKETS; i++)
+    {
+        if (frame_ms <= frameBucketsMs[i])
+        {
+            metrics.frameTimeBucket[i]++;
+            break;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Account one simulation tick
+ * @param  cpu_ms: CPU time spent in the tick
+ */
+void metrics_tick(double cpu_ms)
+{
+    metrics.ticks++;
+    metrics.tickCpuSum += cpu_ms;
+    metrics.tickCpuLast = cpu_ms;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Format the metrics in Prometheus text exposition format
+ * @param  buf: output buffer
+ * @param  size: output buffer size
+ * @retval The number of characters written
+ */
+static int metrics_format(char *buf, int size)
+{
+    int len = 0;
+    uint64_t cumulative = 0, frames;
+
+#define METRICS_PRINT(...) \
+    if (len < size) len += snprintf(buf + len, size - len, __VA_ARGS__)
+
+    METRICS_PRINT("# HELP bow_frames_rendered_total Frames written to the terminal.\n"
+                  "# TYPE bow_frames_rendered_total counter\n"
+                  "bow_frames_rendered_total %" PRIu64 "\n", metrics.framesRendered);
+    METRICS_PRINT("# HELP bow_frames_dropped_total Frame deadlines missed because the loop ran late.\n"
+                  "# TYPE bow_frames_dropped_total counter\n"
+                  "bow_frames_dropped_total %" PRIu64 "\n", metrics.framesDropped);
+    METRICS_PRINT("# HELP bow_frames_coalesced_total Frames merged into the next one because the terminal was still busy.\n"
+                  "# TYPE bow_frames_coalesced_total counter\n"
+                  "bow_frames_coalesced_total %" PRIu64 "\n", metrics.framesCoalesced);
+
+    METRICS_PRINT("# HELP bow_frame_time_seconds Time spent building and writing a frame.\n"
+                  "# TYPE bow_frame_time_seconds histogram\n");
+    for (int i = 0; i < METRICS_FRAME_BUCKETS; i++)
+    {
+        cumulative += metrics.frameTimeBucket[i];
+        METRICS_PRINT("bow_frame_time_seconds_bucket{le=\"%g\"} %" PRIu64 "\n",
+                      frameBucketsMs[i] / 1000, cumulative);
+    }
+    // read after the buckets, a frame the render thread adds meanwhile can't
+    // leave the total below them
+    frames = metrics.framesRendered;
+    METRICS_PRINT("bow_frame_time_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n"
+                  "bow_frame_time_seconds_sum %f\n"
+                  "bow_frame_time_seconds_count %" PRIu64 "\n",
+                  frames, (double) metrics.frameTimeSum / 1000000, frames);
+
+    METRICS_PRINT("# HELP bow_terminal_bytes_written_total Bytes written to the terminal.\n"
+                  "# TYPE bow_terminal_bytes_written_total counter\n"
+                  "bow_terminal_bytes_written_total %" PRIu64 "\n", metrics.bytesWritten);
+    METRICS_PRINT("# HELP bow_input_events_total Keys read from the keyboard.\n"
+                  "# TYPE bow_input_events_total counter\n"
+                  "bow_input_events_total %" PRIu64 "\n", metrics.inputEvents);
+
+    METRICS_PRINT("# HELP bow_ticks_total Simulation loop passes.\n"
+                  "# TYPE bow_ticks_total counter\n"
+                  "bow_ticks_total %" PRIu64 "\n", metrics.ticks);
+    METRICS_PRINT("# HELP bow_tick_cpu_seconds_total CPU time spent in simulation loop passes.\n"
+                  "# TYPE bow_tick_cpu_seconds_total counter\n"
+                  "bow_tick_cpu_seconds_total %f\n", metrics.tickCpuSum / 1000);
+    METRICS_PRINT("# HELP bow_tick_cpu_seconds CPU time spent in the last simulation loop pass.\n"
+                  "# TYPE bow_tick_cpu_seconds gauge\n"
+                  "bow_tick_cpu_seconds %f\n", metrics.tickCpuLast / 1000);
+
+    METRICS_PRINT("# HELP bow_asset_reloads_total Art files changed and swapped in while running.\n"
+                  "# TYPE bow_asset_reloads_total counter\n"
+                  "bow_asset_reloads_total %" PRIu64 "\n", metrics.assetReloads);
+    METRICS_PRINT("# HELP bow_asset_reload_errors_total Changed art files rejected, the old art is kept.\n"
+                  "# TYPE bow_asset_reload_errors_total counter\n"
+                  "bow_asset_reload_errors_total %" PRIu64 "\n", metrics.assetReloadErrors);
+
+    METRICS_PRINT("# HELP bow_level Current game level.\n"
+                  "# TYPE bow_level gauge\n"
+                  "bow_level %d\n", metrics.level);
+    METRICS_PRINT("# HELP bow_entities_active Active entities on the canvas.\n"
+                  "# TYPE bow_entities_active gauge\n"
+                  "bow_entities_active{kind=\"arrow\"} %d\n"
+                  "bow_entities_active{kind=\"balloon\"} %d\n"
+                  "bow_entities_active{kind=\"monster\"} %d\n"
+                  "bow_entities_active{kind=\"particle\"} %d\n",
+                  metrics.activeArrows, metrics.activeBalloons, metrics.activeMonsters, metrics.activeParticles);
+    METRICS_PRINT("# HELP bow_autopilot_plans_total Plans picked by the autopilot.\n"
+                  "# TYPE bow_autopilot_plans_total counter\n"
+                  "bow_autopilot_plans_total %" PRIu64 "\n", metrics.pilotPlans);
+    METRICS_PRINT("# HELP bow_autopilot_lookahead_ticks_total Game ticks the autopilot played ahead on copies of the game.\n"
+                  "# TYPE bow_autopilot_lookahead_ticks_total counter\n"
+                  "bow_autopilot_lookahead_ticks_total %" PRIu64 "\n", metrics.pilotTicks);
+    METRICS_PRINT("# HELP bow_autopilot_plan_wait_seconds_total Time from asking the autopilot for a plan to getting it.\n"
+                  "# TYPE bow_autopilot_plan_wait_seconds_total counter\n"
+                  "bow_autopilot_plan_wait_seconds_total %f\n", metrics.pilotPlanWait / 1000);
+    METRICS_PRINT("# HELP bow_sessions Connected players in server mode.\n"
+                  "# TYPE bow_sessions gauge\n"
+                  "bow_sessions %d\n", metrics.sessions);
+    METRICS_PRINT("# HELP bow_viewers Connected spectators in server mode.\n"
+                  "# TYPE bow_viewers gauge\n"
+                  "bow_viewers %d\n", metrics.viewers);
+    METRICS_PRINT("# HELP bow_viewer_frames_total Shared frames queued to spectators.\n"
+                  "# TYPE bow_viewer_frames_total counter\n"
+                  "bow_viewer_frames_total %" PRIu64 "\n", metrics.viewerFrames);
+    METRICS_PRINT("# HELP bow_viewer_resyncs_total Spectators that fell behind and got a keyframe.\n"
+                  "# TYPE bow_viewer_resyncs_total counter\n"
+                  "bow_viewer_resyncs_total %" PRIu64 "\n", metrics.viewerResyncs);
+
+#undef METRICS_PRINT
+
+    return (len < size) ? len : size - 1;
+}
+//**************************************************************************************
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Get the process CPU time
+ * @retval CPU time in milliseconds
+ */
+double cpu_clock()
+{
+    FILETIME creation, exit, kernel, user;
+    ULARGE_INTEGER k, u;
+
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    // 1 tick = 100 nanoseconds
+    return (double) (k.QuadPart + u.QuadPart) / 10000;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function, UNIX domain sockets are not supported
+ * @retval False
+ */
+bool metrics_init(const char *path)
+{
+    (void) path;
+    (void) metrics_format;
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ */
+void metrics_close()
+{
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ */
+void metrics_poll()
+{
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ * @retval Zero descriptors
+ */
+int metrics_fds(int fds[], int size, int *timeout_ms)
+{
+    (void) fds;
+    (void) size;
+    (void) timeout_ms;
+    return 0;
+}
+//**************************************************************************************
+#else // @linux
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Time a client has to send an HTTP request before it gets plain text
+#define METRICS_REQUEST_TIMEOUT 100 // ms
+#define METRICS_REQUEST_SIZE 1024
+#define METRICS_RESPONSE_SIZE 8192
+
+typedef struct metricsClient
+{
+    int fd;
+    int len;
+    uint64_t startTime;
+    char request[METRICS_REQUEST_SIZE];
+} METRICS_CLIENT;
+
+static int listenFd = -1;
+static char socketPath[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+static METRICS_CLIENT client[METRICS_MAX_CLIENTS];
+
+/**
+ * @brief  Get the calling thread CPU time
+ * @retval CPU time in milliseconds
+ */
+double cpu_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Open the metrics socket
+ * @param  path: socket path, metrics stay disabled when NULL or empty
+ * @retval True if the socket is listening
+ */
+bool metrics_init(const char *path)
+{
+    struct sockaddr_un addr = {0};
+
+    if (path == NULL || path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+    {
+        client[i].fd = -1;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    // remove a stale socket left by a crashed instance
+    unlink(path);
+    if (bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listenFd, METRICS_MAX_CLIENTS) < 0)
+    {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    strcpy(socketPath, path);
+
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Close the metrics socket and remove it from the file system
+ */
+void metrics_close()
+{
+    if (listenFd < 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+    {
+        if (client[i].fd >= 0)
+        {
+            close(client[i].fd);
+            client[i].fd = -1;
+        }
+    }
+    close(listenFd);
+    unlink(socketPath);
+    listenFd = -1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Send the metrics to a client and disconnect it
+ * @param  c: client to serve
+ * @param  http: wrap the body in an HTTP response
+ */
+static void metrics_reply(METRICS_CLIENT *c, bool http)
+{
+    char body[METRICS_RESPONSE_SIZE];
+    char header[128];
+    int bodyLen, headerLen = 0;
+
+    bodyLen = metrics_format(body, sizeof(body));
+    if (http)
+    {
+        headerLen = snprintf(header, sizeof(header),
+                             "HTTP/1.0 200 OK\r\n"
+                             "Content-Type: text/plain; version=0.0.4\r\n"
+                             "Content-Length: %d\r\n\r\n", bodyLen);
+    }
+
+    // the response fits in the socket buffer, a short write means the scraper is gone
+    if (headerLen == 0 || write(c->fd, header, headerLen) == headerLen)
+    {
+        if (write(c->fd, body, bodyLen) < 0)
+        {
+            // nothing to do, the connection is dropped below
+        }
+    }
+    close(c->fd);
+    c->fd = -1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Serve pending scrapes without blocking, call once per loop pass
+ * @note   HTTP scrapers get an HTTP response once their request header arrives,
+ *         raw readers (e.g. socat) get the plain text body after a short timeout
+ */
+void metrics_poll()
+{
+    if (listenFd < 0)
+    {
+        return;
+    }
+
+    // accept new scrapers
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+    {
+        if (client[i].fd < 0)
+        {
+            int fd = accept(listenFd, NULL, NULL);
+            if (fd < 0)
+            {
+                break;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            client[i].fd = fd;
+            client[i].len = 0;
+            client[i].request[0] = '\0';
+            client[i].startTime = get_clock();
+        }
+    }
+
+    // read requests
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+    {
+        METRICS_CLIENT *c = &client[i];
+        if (c->fd < 0)
+        {
+            continue;
+        }
+
+        int n = read(c->fd, c->request + c->len, (METRICS_REQUEST_SIZE - 1) - c->len);
+        if (n > 0)
+        {
+            c->len += n;
+            c->request[c->len] = '\0';
+            if (strstr(c->request, "\r\n\r\n") || strstr(c->request, "\n\n") || c->len == METRICS_REQUEST_SIZE - 1)
+            {
+                metrics_reply(c, strncmp(c->request, "GET ", 4) == 0);
+            }
+        }
+        else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            // peer shut down its writing side, answer right away
+            metrics_reply(c, strncmp(c->request, "GET ", 4) == 0);
+        }
+        else if (time_diff(c->startTime) >= METRICS_REQUEST_TIMEOUT)
+        {
+            metrics_reply(c, strncmp(c->request, "GET ", 4) == 0);
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Descriptors metrics_poll() serves, for loops that wait for them
+ *         instead of polling
+ * @param  fds: filled with the descriptors
+ * @param  size: room in fds
+ * @param  timeout_ms: longest wait, negative for none, lowered while a client
+ *                     is waiting for its request timeout
+ * @retval The number of descriptors
+ */
+int metrics_fds(int fds[], int size, int *timeout_ms)
+{
+    int count = 0;
+    bool full = true;
+
+    if (listenFd < 0)
+    {
+        return 0;
+    }
+    for (int i = 0; i < METRICS_MAX_CLIENTS && count < size; i++)
+    {
+        METRICS_CLIENT *c = &client[i];
+        if (c->fd < 0)
+        {
+            full = false;
+            continue;
+        }
+
+        int left = METRICS_REQUEST_TIMEOUT - (int) time_diff(c->startTime);
+        if (left < 0)
+        {
+            left = 0;
+        }
+        if (*timeout_ms < 0 || left < *timeout_ms)
+        {
+            *timeout_ms = left;
+        }
+        fds[count++] = c->fd;
+    }
+    // new scrapers wait in the backlog while every client slot is taken
+    if (!full && count < size)
+    {
+        fds[count++] = listenFd;
+    }
+    return count;
+}
+//**************************************************************************************
+#endif
@@ -0,0 +1,332 @@
+/*******************************************************************************
+* @filename: pilot.c
+* @brief: Autopilot, plans the archer moves and shots by playing copies of the
+*         game ahead on several threads
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/pilot.h"
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Plan of an index, the rows from the top, holding before shooting
+ */
+static PILOT_PLAN pilot_plan(int i)
+{
+    return (PILOT_PLAN) {ARCHER_UPPER_LIMIT + i / 2, (i % 2) != 0};
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play a plan ahead from a copy of a game
+ * @param  root: game to copy, left untouched
+ * @param  plan: plan played
+ * @param  ticks: set to the ticks played
+ * @retval The points the plan makes within PILOT_HORIZON, an arrow shot
+ *         costs the points it would make left at the end of the level
+ * @note   Safe to call from several threads on the same game
+ */
+int64_t pilot_evaluate(const GAME *root, PILOT_PLAN plan, uint64_t *ticks)
+{
+    ENV env;
+    GAME *game = &env.game;
+    int64_t value = 0;
+    bool shot = false;
+    uint64_t t = 0;
+
+    *game = *root;
+    env.steps = 0;
+    env.done = false;
+
+    while (t < PILOT_HORIZON && !env.done && game->player.level == root->player.level)
+    {
+        enum envAction action = envNoop;
+        // a key is only pressed once its cooldown is over, or it starts again
+        if (game->archer.x != plan.row)
+        {
+            if (!game->archer.keyHitLimit)
+            {
+                action = (game->archer.x > plan.row) ? envUp : envDown;
+            }
+        }
+        else if (plan.shoot && !shot && !game->arrow.keyHitLimit)
+        {
+            action = envShoot;
+            shot = true;
+        }
+        value += env_step(&env, action);
+        t++;
+    }
+    *ticks = t;
+
+    if (game->player.gameOver)
+    {
+        return value - PILOT_GAME_OVER_COST;
+    }
+    // a finished level already counted the arrows left
+    if (shot && game->player.level == root->player.level)
+    {
+        value -= ARROW_LEFT_POINTS;
+    }
+    return value;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Follow a plan in the game played
+ * @retval The key pressed for this pass or zero
+ */
+static int pilot_follow(PILOT *pilot, const GAME *game)
+{
+    if (game->archer.x != pilot->plan.row)
+    {
+        if (!game->archer.keyHitLimit)
+        {
+            return (game->archer.x > pilot->plan.row) ? UP : DOWN;
+        }
+    }
+    else if (pilot->plan.shoot && !game->arrow.keyHitLimit)
+    {
+        pilot->plan.shoot = false;
+        return SPACE;
+    }
+    return 0;
+}
+//**************************************************************************************
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Dummy function, there are no planning threads
+ * @retval False
+ */
+bool pilot_start(PILOT *pilot, int threads)
+{
+    (void) threads;
+    pilot->running = false;
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ * @retval Zero
+ */
+int pilot_key(PILOT *pilot, const GAME *game)
+{
+    (void) pilot;
+    (void) game;
+    return 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Dummy function
+ */
+void pilot_stop(PILOT *pilot)
+{
+    (void) pilot;
+}
+//**************************************************************************************
+#else // @linux
+
+/**
+ * @brief  Pick the best plan, the nearest row and holding win the ties
+ * @param  row: archer row when the plans were asked for
+ * @retval None
+ * @note   Call with the lock held
+ */
+static void pilot_pick(PILOT *pilot, int row)
+{
+    int best = 0;
+
+    for (int i = 1; i < PILOT_PLANS; i++)
+    {
+        int distance = abs(pilot_plan(i).row - row), bestDistance = abs(pilot_plan(best).row - row);
+        if (pilot->value[i] > pilot->value[best] ||
+            (pilot->value[i] == pilot->value[best] && distance < bestDistance))
+        {
+            best = i;
+        }
+    }
+    pilot->best = pilot_plan(best);
+    pilot->picked = true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Planning thread, plays the plans not taken yet by the other threads
+ * @param  arg: the autopilot
+ * @retval NULL
+ */
+static void *pilot_run(void *arg)
+{
+    PILOT *pilot = arg;
+
+    for (;;)
+    {
+        int i;
+        bool stop;
+
+        pthread_mutex_lock(&pilot->lock);
+        while (!pilot->stop && atomic_load(&pilot->next) >= PILOT_PLANS)
+        {
+            pthread_cond_wait(&pilot->wake, &pilot->lock);
+        }
+        stop = pilot->stop;
+        pthread_mutex_unlock(&pilot->lock);
+        if (stop)
+        {
+            break;
+        }
+
+        // the root is never written while plans are left
+        while ((i = atomic_fetch_add(&pilot->next, 1)) < PILOT_PLANS)
+        {
+            int64_t value = pilot_evaluate(&pilot->root.game, pilot_plan(i), &pilot->planTicks[i]);
+
+            pthread_mutex_lock(&pilot->lock);
+            pilot->value[i] = value;
+            if (++pilot->done == PILOT_PLANS)
+            {
+                pilot_pick(pilot, pilot->root.game.archer.x);
+            }
+            pthread_mutex_unlock(&pilot->lock);
+        }
+    }
+    return NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start the planning threads
+ * @param  threads: number of threads, zero for one less than the cores
+ * @retval True if at least one thread runs
+ */
+bool pilot_start(PILOT *pilot, int threads)
+{
+    if (threads <= 0)
+    {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > PILOT_MAX_THREADS) threads = PILOT_MAX_THREADS;
+
+    pilot->running = false;
+    pilot->plan = (PILOT_PLAN) {ARCHER_INITIAL_X, false};
+    pilot->planning = false;
+    pilot->planTime = 0;
+    pilot->plans = 0;
+    pilot->ticks = 0;
+    pilot->planWait = 0;
+    atomic_store(&pilot->next, PILOT_PLANS);
+    pilot->done = 0;
+    pilot->picked = false;
+    pilot->stop = false;
+    pthread_mutex_init(&pilot->lock, NULL);
+    pthread_cond_init(&pilot->wake, NULL);
+
+    for (pilot->nThreads = 0; pilot->nThreads < threads; pilot->nThreads++)
+    {
+        if (pthread_create(&pilot->thread[pilot->nThreads], NULL, pilot_run, pilot) != 0)
+        {
+            break;
+        }
+    }
+    if (pilot->nThreads == 0)
+    {
+        pthread_cond_destroy(&pilot->wake);
+        pthread_mutex_destroy(&pilot->lock);
+        return false;
+    }
+    pilot->running = true;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Key the autopilot presses in the game played, never waits
+ * @param  game: game played, copied when a new plan is asked for
+ * @retval The key for this pass or zero
+ * @note   Call from the game thread only
+ */
+int pilot_key(PILOT *pilot, const GAME *game)
+{
+    if (!pilot->running)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pilot->lock);
+    if (pilot->picked)
+    {
+        pilot->plan = pilot->best;
+        pilot->picked = false;
+        pilot->planning = false;
+        pilot->plans++;
+        for (int i = 0; i < PILOT_PLANS; i++)
+        {
+            pilot->ticks += pilot->planTicks[i];
+        }
+        pilot->planWait += time_diff(pilot->askTime);
+    }
+    // a rewound game plans again at once
+    if (!pilot->planning && (game->now < pilot->planTime || game->now - pilot->planTime >= PILOT_REPLAN))
+    {
+        pilot->root.game = *game;
+        pilot->done = 0;
+        pilot->planning = true;
+        pilot->planTime = game->now;
+        pilot->askTime = get_clock();
+        atomic_store(&pilot->next, 0);
+        pthread_cond_broadcast(&pilot->wake);
+    }
+    pthread_mutex_unlock(&pilot->lock);
+
+    return pilot_follow(pilot, game);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Stop the planning threads, the plans being played are finished first
+ * @retval None
+ */
+void pilot_stop(PILOT *pilot)
+{
+    if (!pilot->running)
+    {
+        return;
+    }
+    pthread_mutex_lock(&pilot->lock);
+    pilot->stop = true;
+    pthread_cond_broadcast(&pilot->wake);
+    pthread_mutex_unlock(&pilot->lock);
+    for (int i = 0; i < pilot->nThreads; i++)
+    {
+        pthread_join(pilot->thread[i], NULL);
+    }
+    pthread_cond_destroy(&pilot->wake);
+    pthread_mutex_destroy(&pilot->lock);
+    pilot->running = false;
+}
+//**************************************************************************************
+#endif
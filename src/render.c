@@ -0,0 +1,1221 @@
+/*******************************************************************************
+* @filename: render.c
+* @brief: ANSI rendering of game layers and ASCII Art into memory buffers, the
+*         encoder sends only the cells that changed with the cheapest cursor moves
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "include/render.h"
+
+/**
+ * @brief  Initialize an empty output buffer
+ * @param  buf: buffer to initialize
+ */
+void outbuf_init(OUTBUFFER *buf)
+{
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Release an output buffer
+ * @param  buf: buffer to release
+ */
+void outbuf_free(OUTBUFFER *buf)
+{
+    free(buf->data);
+    outbuf_init(buf);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Make room for more bytes
+ * @param  buf: buffer to grow
+ * @param  len: bytes that will be appended
+ */
+static void outbuf_reserve(OUTBUFFER *buf, int len)
+{
+    if (buf->len + len <= buf->cap)
+    {
+        return;
+    }
+
+    int cap = (buf->cap > 0) ? buf->cap : OUTBUF_INITIAL_SIZE;
+    while (cap < buf->len + len)
+    {
+        cap *= 2;
+    }
+
+    char *data = realloc(buf->data, cap);
+    if (data == NULL)
+    {
+        // out of memory, the caller sees a buffer that stopped growing
+        return;
+    }
+    buf->data = data;
+    buf->cap = cap;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Append raw bytes
+ * @param  buf: destination buffer
+ * @param  data: bytes to append
+ * @param  len: number of bytes
+ */
+void outbuf_append(OUTBUFFER *buf, const char *data, int len)
+{
+    outbuf_reserve(buf, len);
+    if (buf->len + len <= buf->cap)
+    {
+        memcpy(buf->data + buf->len, data, len);
+        buf->len += len;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Append formatted text
+ * @param  buf: destination buffer
+ * @param  format: printf like format
+ */
+void outbuf_printf(OUTBUFFER *buf, const char *format, ...)
+{
+    va_list args;
+    char text[256];
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        outbuf_append(buf, text, (len < (int) sizeof(text)) ? len : (int) sizeof(text) - 1);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Drop bytes already written from the start of the buffer
+ * @param  buf: buffer to shrink
+ * @param  len: number of bytes written
+ */
+void outbuf_consume(OUTBUFFER *buf, int len)
+{
+    if (len >= buf->len)
+    {
+        buf->len = 0;
+        return;
+    }
+    memmove(buf->data, buf->data + len, buf->len - len);
+    buf->len -= len;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Create a shared frame holding a copy of the encoded bytes
+ * @param  data: encoded bytes
+ * @param  len: number of bytes
+ * @retval The frame with one reference owned by the caller, NULL if out of memory
+ */
+FRAME *frame_new(const char *data, int len)
+{
+    FRAME *frame = malloc(sizeof(FRAME) + len);
+    if (frame != NULL)
+    {
+        frame->refs = 1;
+        frame->len = len;
+        memcpy(frame->data, data, len);
+    }
+    return frame;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take a reference to a frame
+ * @retval The same frame
+ */
+FRAME *frame_retain(FRAME *frame)
+{
+    frame->refs++;
+    return frame;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Drop a reference, the last one frees the frame
+ */
+void frame_release(FRAME *frame)
+{
+    if (frame != NULL && --frame->refs == 0)
+    {
+        free(frame);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start an encoder
+ * @param  enc: encoder to initialize
+ * @param  caps: RENDER_CAP_* sequences the terminal understands
+ */
+void encoder_init(ENCODER *enc, int caps)
+{
+    enc->caps = caps;
+    enc->row = -1;
+    enc->column = -1;
+    // terminals start with the default attributes
+    enc->theme = 0;
+    enc->pen = 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Guess the optional sequences a terminal understands from its name
+ * @param  term: TERM environment variable, may be NULL
+ * @retval RENDER_CAP_* flags
+ */
+int render_caps(const char *term)
+{
+    int caps = 0;
+
+    if (term == NULL || term[0] == '\0' || strcmp(term, "dumb") == 0)
+    {
+        return caps;
+    }
+
+    // ECH comes from the VT220, REP from xterm
+    caps |= RENDER_CAP_ECH;
+    if (strncmp(term, "xterm", 5) == 0)
+    {
+        caps |= RENDER_CAP_REP;
+    }
+    return caps;
+}
+//**************************************************************************************
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Dummy function, the console isn't queried
+ * @retval The guessed flags
+ */
+int render_probe(int caps, int timeout_ms)
+{
+    (void) timeout_ms;
+    return caps;
+}
+//**************************************************************************************
+#else // @linux
+
+// XTVERSION names of the terminals known to repeat glyphs
+static const char *const repTerminals[] = {"XTerm", "kitty", "foot", "WezTerm", "tmux"};
+
+/**
+ * @brief  Read the answers to the capability queries
+ * @param  reply: bytes read from the terminal
+ * @param  len: number of bytes
+ * @param  caps: flags guessed from the terminal name
+ * @param  answered: set if the primary device attributes came back, the
+ *         terminal answers in order so nothing else is coming
+ * @retval RENDER_CAP_* flags, the guessed ones if the terminal didn't answer
+ */
+static int render_probe_parse(const unsigned char *reply, int len, int caps, bool *answered)
+{
+    bool sync = false, rep = false;
+    int level = 0;
+
+    *answered = false;
+    for (int i = 0; i + 1 < len; i++)
+    {
+        if (reply[i] != ESC)
+        {
+            continue;
+        }
+        if (reply[i + 1] == '[')
+        {
+            // CSI, private marker, up to two parameters, intermediate, final
+            int j = i + 2, n = 0;
+            int param[2] = {0, 0};
+            unsigned char mark = (j < len && (reply[j] == '?' || reply[j] == '>')) ? reply[j++] : '\0';
+            for (; j < len && reply[j] >= '0' && reply[j] <= '?'; j++)
+            {
+                if (reply[j] == ';')
+                {
+                    n++;
+                }
+                else if (reply[j] <= '9' && n < 2)
+                {
+                    param[n] = param[n] * 10 + (reply[j] - '0');
+                }
+            }
+            unsigned char inter = (j < len && reply[j] >= ' ' && reply[j] <= '/') ? reply[j++] : '\0';
+            if (j >= len)
+            {
+                break;
+            }
+            // DECRQM: set or reset means the mode exists
+            if (mark == '?' && inter == '$' && reply[j] == 'y' && param[0] == 2026)
+            {
+                sync = (param[1] == 1 || param[1] == 2);
+            }
+            // DA1: 62 and above is a VT220 or later
+            else if (mark == '?' && reply[j] == 'c')
+            {
+                level = param[0];
+                *answered = true;
+            }
+            // DA2: 41 is xterm
+            else if (mark == '>' && reply[j] == 'c' && param[0] == 41)
+            {
+                rep = true;
+            }
+            i = j;
+        }
+        // XTVERSION: DCS > | name ST
+        else if (reply[i + 1] == 'P' && i + 3 < len && reply[i + 2] == '>' && reply[i + 3] == '|')
+        {
+            for (size_t k = 0; k < sizeof(repTerminals) / sizeof(repTerminals[0]); k++)
+            {
+                size_t nameLen = strlen(repTerminals[k]);
+                if ((size_t) (len - (i + 4)) >= nameLen && memcmp(reply + i + 4, repTerminals[k], nameLen) == 0)
+                {
+                    rep = true;
+                }
+            }
+        }
+    }
+
+    if (!*answered)
+    {
+        return caps;
+    }
+    caps &= ~(RENDER_CAP_ECH | RENDER_CAP_REP | RENDER_CAP_SYNC);
+    if (level >= 62)
+    {
+        caps |= RENDER_CAP_ECH;
+    }
+    if (rep)
+    {
+        caps |= RENDER_CAP_REP;
+    }
+    if (sync)
+    {
+        caps |= RENDER_CAP_SYNC;
+    }
+    return caps;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Ask the terminal for the optional sequences it understands
+ * @param  caps: flags guessed from the terminal name, see render_caps()
+ * @param  timeout_ms: longest wait for the answers
+ * @retval RENDER_CAP_* flags, the guessed ones if the terminal didn't answer
+ * @note   The terminal input must be in raw mode. Keys typed meanwhile are lost
+ */
+int render_probe(int caps, int timeout_ms)
+{
+    // mode 2026, XTVERSION, DA2, then DA1 which every terminal answers
+    static const char query[] = "\033[?2026$p\033[>q\033[>c\033[c";
+    unsigned char reply[512];
+    int len = 0;
+    bool answered = false;
+    uint64_t deadline = get_clock() + (uint64_t) timeout_ms * 1000;
+
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+    {
+        return caps;
+    }
+    fflush(stdout);
+    if (write(STDOUT_FILENO, query, sizeof(query) - 1) != (ssize_t) (sizeof(query) - 1))
+    {
+        return caps;
+    }
+
+    while (!answered && len < (int) sizeof(reply))
+    {
+        int64_t left = (int64_t) (deadline - get_clock());
+        if (left <= 0 || !wait_input((int) ((left + 999) / 1000), NULL, 0))
+        {
+            break;
+        }
+        int n = read(STDIN_FILENO, reply + len, sizeof(reply) - len);
+        if (n <= 0)
+        {
+            break;
+        }
+        len += n;
+        render_probe_parse(reply, len, caps, &answered);
+    }
+    return render_probe_parse(reply, len, caps, &answered);
+}
+//**************************************************************************************
+#endif
+
+/**
+ * @brief  Number of decimal digits
+ */
+static int encoder_digits(int n)
+{
+    int digits = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Bytes of a CSI sequence with one parameter, 1 is left out
+ */
+static int encoder_csi_cost(int n)
+{
+    return (n == 1) ? 3 : encoder_digits(n) + 3;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Append a CSI sequence with one parameter, 1 is left out
+ */
+static void encoder_csi(OUTBUFFER *buf, int n, char final)
+{
+    if (n == 1)
+    {
+        outbuf_printf(buf, "\033[%c", final);
+    }
+    else
+    {
+        outbuf_printf(buf, "\033[%d%c", n, final);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Bytes of an absolute cursor position (CUP)
+ */
+static int encoder_cup_cost(int row, int column)
+{
+    if (column == 0)
+    {
+        return (row == 0) ? 3 : encoder_digits(row + 1) + 3;
+    }
+    return encoder_digits(row + 1) + encoder_digits(column + 1) + 4;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Attribute a cell is drawn with, the theme fills what the cell leaves out
+ * @param  attr: cell attribute, zero for the theme
+ * @retval The attribute sent to the terminal
+ */
+static ATTR encoder_resolve(const ENCODER *enc, ATTR attr)
+{
+    ATTR fg = ATTR_FG_OF(attr) ? ATTR_FG_OF(attr) : ATTR_FG_OF(enc->theme);
+    ATTR bg = ATTR_BG_OF(attr) ? ATTR_BG_OF(attr) : ATTR_BG_OF(enc->theme);
+
+    return fg | (bg << 4) | ((attr | enc->theme) & ATTR_BOLD);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Columns a glyph takes, zero for the unknown glyph and wide tails
+ */
+static int encoder_width(char id)
+{
+    if (GLYPH_IS_EXTENDED(id))
+    {
+        return GLYPH(id)->width;
+    }
+    return (id == '\0' || id == GLYPH_WIDE_TAIL) ? 0 : 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Bytes of a glyph
+ */
+static int encoder_glyph_len(char id)
+{
+    return GLYPH_IS_EXTENDED(id) ? GLYPH(id)->len : 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Append the bytes of a glyph, encoded when the art was loaded
+ */
+static void encoder_glyph(OUTBUFFER *buf, char id)
+{
+    if (GLYPH_IS_EXTENDED(id))
+    {
+        outbuf_append(buf, GLYPH(id)->bytes, GLYPH(id)->len);
+    }
+    else
+    {
+        outbuf_append(buf, &id, 1);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Whether a glyph looks the same in two attributes, blanks only show the background
+ */
+static bool encoder_same(char glyph, ATTR a, ATTR b)
+{
+    return a == b || (glyph == ' ' && ATTR_BG_OF(a) == ATTR_BG_OF(b));
+}
+//**************************************************************************************
+
+/**
+ * @brief  Append the shortest SGR sequence switching between two attributes
+ * @param  buf: destination buffer
+ * @param  from: attribute the terminal draws with
+ * @param  to: attribute wanted
+ * @retval The number of bytes appended
+ * @note   Either only the parameters that change, or a reset followed by the
+ *         parameters that are set, the reset is the omitted first parameter
+ */
+static int encoder_sgr(OUTBUFFER *buf, ATTR from, ATTR to)
+{
+    char change[24] = "", reset[24] = "";
+    int nChange = 0, nReset = 0;
+
+    if (from == to)
+    {
+        return 0;
+    }
+
+    if ((from & ATTR_BOLD) != (to & ATTR_BOLD))
+    {
+        nChange += sprintf(change + nChange, (to & ATTR_BOLD) ? ";1" : ";22");
+    }
+    if (ATTR_FG_OF(from) != ATTR_FG_OF(to))
+    {
+        nChange += ATTR_FG_OF(to) ? sprintf(change + nChange, ";3%d", ATTR_FG_OF(to) - 1) : sprintf(change + nChange, ";39");
+    }
+    if (ATTR_BG_OF(from) != ATTR_BG_OF(to))
+    {
+        nChange += ATTR_BG_OF(to) ? sprintf(change + nChange, ";4%d", ATTR_BG_OF(to) - 1) : sprintf(change + nChange, ";49");
+    }
+
+    if (to & ATTR_BOLD)
+    {
+        nReset += sprintf(reset + nReset, ";1");
+    }
+    if (ATTR_FG_OF(to))
+    {
+        nReset += sprintf(reset + nReset, ";3%d", ATTR_FG_OF(to) - 1);
+    }
+    if (ATTR_BG_OF(to))
+    {
+        nReset += sprintf(reset + nReset, ";4%d", ATTR_BG_OF(to) - 1);
+    }
+
+    // the changes drop their leading separator
+    if (nChange - 1 <= nReset)
+    {
+        outbuf_printf(buf, "\033[%sm", change + 1);
+        return nChange + 2;
+    }
+    outbuf_printf(buf, "\033[%sm", reset);
+    return nReset + 3;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Make the terminal draw with an attribute
+ * @param  attr: resolved attribute
+ */
+static void encoder_pen(OUTBUFFER *buf, ENCODER *enc, ATTR attr)
+{
+    encoder_sgr(buf, enc->pen, attr);
+    enc->pen = attr;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Cheapest move along the row the cursor is on
+ * @param  buf: destination buffer, NULL only prices the move
+ * @param  enc: encoder
+ * @param  screen: screen model, known glyphs in the pen attribute can be sent again to move right
+ * @param  row: cursor row
+ * @param  from: cursor column
+ * @param  to: target column
+ * @retval The number of bytes of the move
+ */
+static int encoder_horizontal(OUTBUFFER *buf, const ENCODER *enc, const SCREEN *screen, int row, int from, int to)
+{
+    const char *line = screen->glyph[row];
+    int best = 0;
+    char how = 0;
+
+    if (to > from)
+    {
+        // CUF, or the narrow glyphs already on screen when shorter
+        best = encoder_csi_cost(to - from);
+        how = 'C';
+        if (to - from < best)
+        {
+            bool resend = true;
+            int bytes = 0;
+            for (int j = from; j < to && resend; j++)
+            {
+                resend = (encoder_width(line[j]) == 1 && encoder_same(line[j], screen->attr[row][j], enc->pen));
+                bytes += encoder_glyph_len(line[j]);
+            }
+            if (resend && bytes < best)
+            {
+                best = bytes;
+                how = 'r';
+            }
+        }
+    }
+    else if (to < from)
+    {
+        // CUB, backspaces or a carriage return and a move from the first column
+        best = encoder_csi_cost(from - to);
+        how = 'D';
+        if (from - to < best)
+        {
+            best = from - to;
+            how = '\b';
+        }
+        int cr = 1 + encoder_horizontal(NULL, enc, screen, row, 0, to);
+        if (cr < best)
+        {
+            best = cr;
+            how = '\r';
+        }
+    }
+
+    if (buf != NULL)
+    {
+        switch (how)
+        {
+            case 'C': case 'D': encoder_csi(buf, abs(to - from), how); break;
+            case 'r': for (int j = from; j < to; j++) encoder_glyph(buf, line[j]); break;
+            case '\b': for (int j = to; j < from; j++) outbuf_append(buf, "\b", 1); break;
+            case '\r':
+                outbuf_append(buf, "\r", 1);
+                encoder_horizontal(buf, enc, screen, row, 0, to);
+                break;
+        }
+    }
+    return best;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move the cursor with the fewest bytes
+ * @param  screen: screen model
+ * @param  row: target row
+ * @param  column: target column
+ */
+static void encoder_move(OUTBUFFER *buf, ENCODER *enc, const SCREEN *screen, int row, int column)
+{
+    int best = encoder_cup_cost(row, column);
+    char how = 'H';
+
+    if (enc->row == row && enc->column == column)
+    {
+        return;
+    }
+
+    if (enc->row == row)
+    {
+        int cost = encoder_horizontal(NULL, enc, screen, row, enc->column, column);
+        if (cost < best)
+        {
+            best = cost;
+            how = '-';
+        }
+    }
+    else if (enc->row >= 0)
+    {
+        int lines = abs(row - enc->row);
+        // CUD or CUU keep the column
+        int cost = encoder_csi_cost(lines) + encoder_horizontal(NULL, enc, screen, row, enc->column, column);
+        if (cost < best)
+        {
+            best = cost;
+            how = (row > enc->row) ? 'B' : 'A';
+        }
+        // CR LF pairs start the row from the first column
+        if (row > enc->row)
+        {
+            cost = 2 * lines + encoder_horizontal(NULL, enc, screen, row, 0, column);
+            if (cost < best)
+            {
+                best = cost;
+                how = '\n';
+            }
+        }
+    }
+
+    switch (how)
+    {
+        case 'H':
+            if (column == 0)
+            {
+                encoder_csi(buf, row + 1, 'H');
+            }
+            else
+            {
+                outbuf_printf(buf, "\033[%d;%dH", row + 1, column + 1);
+            }
+            break;
+        case '-':
+            encoder_horizontal(buf, enc, screen, row, enc->column, column);
+            break;
+        case 'A': case 'B':
+            encoder_csi(buf, abs(row - enc->row), how);
+            encoder_horizontal(buf, enc, screen, row, enc->column, column);
+            break;
+        case '\n':
+            for (int i = enc->row; i < row; i++)
+            {
+                outbuf_append(buf, "\r\n", 2);
+            }
+            encoder_horizontal(buf, enc, screen, row, 0, column);
+            break;
+    }
+    enc->row = row;
+    enc->column = column;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Forget the halves of wide glyphs left over when cells are overwritten
+ * @param  screen: screen model
+ * @param  row: screen row
+ * @param  from: first cell overwritten
+ * @param  to: cell after the last one overwritten
+ * @note   Terminals differ on what is left, the halves become unknown
+ */
+static void encoder_clip(SCREEN *screen, int row, int from, int to)
+{
+    // the tail may be unknown and still on screen
+    if (from > 0 && (screen->glyph[row][from] == GLYPH_WIDE_TAIL || encoder_width(screen->glyph[row][from - 1]) == 2))
+    {
+        screen->glyph[row][from - 1] = '\0';
+    }
+    if (to < CANVAS_COLUMNS && screen->glyph[row][to] == GLYPH_WIDE_TAIL)
+    {
+        screen->glyph[row][to] = '\0';
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Whether a cell has to be drawn
+ * @param  screen: screen model
+ * @param  cells: new glyphs, '\0' cells are left untouched
+ * @param  attrs: resolved attributes of the new glyphs
+ * @retval True if the glyph, or the tail of a wide one, differs from the screen
+ * @note   Wide tails are drawn with their glyph, never on their own
+ */
+static bool encoder_changed(const SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS], ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS],
+                            int row, int column)
+{
+    char ch = cells[row][column];
+
+    if (ch == '\0' || ch == GLYPH_WIDE_TAIL)
+    {
+        return false;
+    }
+    if (ch != screen->glyph[row][column] || !encoder_same(ch, attrs[row][column], screen->attr[row][column]))
+    {
+        return true;
+    }
+    return encoder_width(ch) == 2 && screen->glyph[row][column + 1] != GLYPH_WIDE_TAIL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Cells from a column on that end up blank in the background of an attribute
+ * @param  screen: screen model
+ * @param  cells: new glyphs, '\0' cells keep the screen ones
+ * @param  attrs: resolved attributes of the new glyphs
+ * @param  row: screen row
+ * @param  column: first column
+ * @param  attr: attribute of the blanks
+ * @retval The length of the run
+ */
+static int encoder_blanks(const SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS], ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS],
+                          int row, int column, ATTR attr)
+{
+    int j = column;
+
+    for (; j < CANVAS_COLUMNS; j++)
+    {
+        bool drawn = (cells[row][j] != '\0');
+        char glyph = drawn ? cells[row][j] : screen->glyph[row][j];
+        ATTR glyphAttr = drawn ? attrs[row][j] : screen->attr[row][j];
+
+        if (glyph != ' ' || !encoder_same(' ', glyphAttr, attr))
+        {
+            break;
+        }
+    }
+    return j - column;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render the changed cells in screen order
+ * @param  screen: screen model, updated
+ * @param  cells: new glyphs, '\0' cells are left untouched
+ * @param  attrs: resolved attributes of the new glyphs
+ * @param  only: render only the cells that look the same in this attribute, -1 for all of them
+ */
+static void encoder_pass(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS],
+                         ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS], int only)
+{
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        char *line = screen->glyph[i];
+        ATTR *lineAttr = screen->attr[i];
+        const char *want = cells[i];
+        const ATTR *wantAttr = attrs[i];
+
+        int j = 0;
+        while (j < CANVAS_COLUMNS)
+        {
+            if (!encoder_changed(screen, cells, attrs, i, j) || (only >= 0 && !encoder_same(want[j], wantAttr[j], only)))
+            {
+                j++;
+                continue;
+            }
+
+            char ch = want[j];
+
+            encoder_move(buf, enc, screen, i, j);
+            if (!encoder_same(ch, wantAttr[j], enc->pen))
+            {
+                encoder_pen(buf, enc, wantAttr[j]);
+            }
+            ATTR pen = enc->pen;
+
+            // a wide glyph and its tail
+            if (encoder_width(ch) == 2)
+            {
+                encoder_clip(screen, i, j, j + 2);
+                encoder_glyph(buf, ch);
+                line[j] = ch;
+                line[j + 1] = GLYPH_WIDE_TAIL;
+                lineAttr[j] = pen;
+                lineAttr[j + 1] = pen;
+                enc->column += 2;
+                j += 2;
+                continue;
+            }
+
+            // EL when the rest of the row only needs blanks
+            if (ch == ' ' && encoder_blanks(screen, cells, attrs, i, j, pen) == CANVAS_COLUMNS - j)
+            {
+                int changes = 0;
+                for (int k = j; k < CANVAS_COLUMNS; k++)
+                {
+                    changes += encoder_changed(screen, cells, attrs, i, k);
+                }
+                if (changes > 3)
+                {
+                    outbuf_append(buf, "\033[K", 3);
+                    encoder_clip(screen, i, j, CANVAS_COLUMNS);
+                    memset(&line[j], ' ', CANVAS_COLUMNS - j);
+                    for (int k = j; k < CANVAS_COLUMNS; k++)
+                    {
+                        lineAttr[k] = pen;
+                    }
+                    break;
+                }
+            }
+
+            // run of one glyph
+            int len = 1;
+            while (j + len < CANVAS_COLUMNS && want[j + len] == ch && encoder_same(ch, wantAttr[j + len], pen) &&
+                   (line[j + len] != ch || !encoder_same(ch, lineAttr[j + len], pen)))
+            {
+                len++;
+            }
+
+            // ECH may also cover the blanks already there between the changes
+            int blanks = (ch == ' ') ? encoder_blanks(screen, cells, attrs, i, j, pen) : 0;
+
+            int glyphLen = encoder_glyph_len(ch);
+            if ((enc->caps & RENDER_CAP_ECH) && blanks > 0 && encoder_csi_cost(blanks) < blanks)
+            {
+                // ECH leaves the cursor at the start of the run
+                encoder_csi(buf, blanks, 'X');
+                len = blanks;
+            }
+            else
+            {
+                if ((enc->caps & RENDER_CAP_REP) && len > 1 && glyphLen + encoder_csi_cost(len - 1) < len * glyphLen)
+                {
+                    encoder_glyph(buf, ch);
+                    encoder_csi(buf, len - 1, 'b');
+                }
+                else
+                {
+                    for (int k = 0; k < len; k++)
+                    {
+                        encoder_glyph(buf, ch);
+                    }
+                }
+                enc->column += len;
+            }
+            encoder_clip(screen, i, j, j + len);
+            memset(&line[j], ch, len);
+            for (int k = j; k < j + len; k++)
+            {
+                lineAttr[k] = pen;
+            }
+            j += len;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Wrap the bytes of a frame in the synchronized output markers
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  start: where the frame starts in the buffer
+ * @retval The number of bytes of the frame
+ * @note   An empty frame stays empty
+ */
+static int encoder_sync(OUTBUFFER *buf, const ENCODER *enc, int start)
+{
+    int len = buf->len - start;
+    int beginLen = sizeof(RENDER_SYNC_BEGIN) - 1;
+
+    if (!(enc->caps & RENDER_CAP_SYNC) || len == 0)
+    {
+        return len;
+    }
+    // room for the marker in front
+    outbuf_append(buf, RENDER_SYNC_BEGIN, beginLen);
+    memmove(buf->data + start + beginLen, buf->data + start, len);
+    memcpy(buf->data + start, RENDER_SYNC_BEGIN, beginLen);
+    outbuf_append(buf, RENDER_SYNC_END, sizeof(RENDER_SYNC_END) - 1);
+    return buf->len - start;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Encode the cells that differ from the screen model, see render_cells()
+ * @param  buf: destination buffer, not wrapped in the synchronized output markers
+ * @retval None
+ */
+static void encoder_cells(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS],
+                          ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    char glyphs[CANVAS_ROWS][CANVAS_COLUMNS];
+    ATTR want[CANVAS_ROWS][CANVAS_COLUMNS];
+    ATTR groups[RENDER_MAX_GROUPS];
+    int nGroups = 0;
+    int start = buf->len;
+
+    enc->row = -1;
+    enc->column = -1;
+
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        for (int j = 0; j < CANVAS_COLUMNS; j++)
+        {
+            want[i][j] = encoder_resolve(enc, (attrs != NULL) ? attrs[i][j] : 0);
+        }
+    }
+
+    // wide glyphs come with their tail, a glyph without room for it or a
+    // tail without its glyph is drawn blank
+    memcpy(glyphs, cells, sizeof(glyphs));
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        for (int j = 0; j < CANVAS_COLUMNS; j++)
+        {
+            char *ch = &glyphs[i][j];
+            if (encoder_width(*ch) == 2)
+            {
+                if (j + 1 < CANVAS_COLUMNS && (ch[1] == GLYPH_WIDE_TAIL || ch[1] == '\0'))
+                {
+                    ch[1] = GLYPH_WIDE_TAIL;
+                    j++;
+                }
+                else
+                {
+                    *ch = ' ';
+                }
+            }
+            else if (*ch == GLYPH_WIDE_TAIL)
+            {
+                bool onScreen = (j > 0 && glyphs[i][j - 1] == '\0' && encoder_width(screen->glyph[i][j - 1]) == 2 &&
+                                 screen->glyph[i][j] == GLYPH_WIDE_TAIL);
+                *ch = onScreen ? '\0' : ' ';
+            }
+        }
+    }
+
+    // attributes of the changed glyphs, then of the blanks no glyph attribute can draw
+    for (int blank = 0; blank < 2; blank++)
+    {
+        for (int i = 0; i < CANVAS_ROWS; i++)
+        {
+            for (int j = 0; j < CANVAS_COLUMNS; j++)
+            {
+                char ch = glyphs[i][j];
+                if ((ch == ' ') != blank || !encoder_changed(screen, glyphs, want, i, j))
+                {
+                    continue;
+                }
+                int g = 0;
+                while (g < nGroups && g < RENDER_MAX_GROUPS && !encoder_same(ch, want[i][j], groups[g]))
+                {
+                    g++;
+                }
+                if (g == nGroups)
+                {
+                    if (nGroups < RENDER_MAX_GROUPS)
+                    {
+                        groups[nGroups] = want[i][j];
+                    }
+                    nGroups++;
+                }
+            }
+        }
+    }
+
+    if (nGroups <= 1 || nGroups > RENDER_MAX_GROUPS)
+    {
+        encoder_pass(buf, enc, screen, glyphs, want, -1);
+        encoder_pen(buf, enc, enc->theme);
+        return;
+    }
+
+    // screen order may switch attributes back and forth, one attribute at a
+    // time may need more cursor moves, the shorter one is kept
+    SCREEN grouped = *screen;
+    ENCODER groupedEnc = *enc;
+    OUTBUFFER scratch;
+
+    outbuf_init(&scratch);
+    for (int g = 0; g < nGroups; g++)
+    {
+        if (groups[g] != enc->theme)
+        {
+            encoder_pass(&scratch, &groupedEnc, &grouped, glyphs, want, groups[g]);
+        }
+    }
+    // the theme last, nothing to restore after it
+    encoder_pass(&scratch, &groupedEnc, &grouped, glyphs, want, enc->theme);
+    encoder_pen(&scratch, &groupedEnc, enc->theme);
+
+    encoder_pass(buf, enc, screen, glyphs, want, -1);
+    encoder_pen(buf, enc, enc->theme);
+    if (scratch.len < buf->len - start)
+    {
+        buf->len = start;
+        outbuf_append(buf, scratch.data, scratch.len);
+        *screen = grouped;
+        *enc = groupedEnc;
+    }
+    outbuf_free(&scratch);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render the cells that differ from the screen model
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  screen: screen model, updated with the rendered cells
+ * @param  cells: new glyph IDs, '\0' cells are left untouched
+ * @param  attrs: attributes of the new glyphs, NULL draws them all with the theme
+ * @retval The number of bytes appended
+ * @note   The cursor position is unknown on entry, anything may have been
+ *         printed since the last call. The terminal is left drawing with the
+ *         theme, so text printed between calls gets the theme colors. With
+ *         RENDER_CAP_SYNC the terminal paints the cells all at once
+ */
+int render_cells(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char cells[CANVAS_ROWS][CANVAS_COLUMNS],
+                 ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    int start = buf->len;
+
+    encoder_cells(buf, enc, screen, cells, attrs);
+    return encoder_sync(buf, enc, start);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render the changed cells of a game layer
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  screen: screen model, updated
+ * @param  layer: game layer, '\0' cells are left untouched
+ * @param  attrs: attributes of the layer cells
+ * @retval The number of bytes appended
+ * @note   The canvas borders are never redrawn
+ */
+int render_layer(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, char layer[CANVAS_ROWS][CANVAS_COLUMNS],
+                 ATTR attrs[CANVAS_ROWS][CANVAS_COLUMNS])
+{
+    char cells[CANVAS_ROWS][CANVAS_COLUMNS];
+
+    memcpy(cells, layer, sizeof(cells));
+    memset(cells[CANVAS_UPPER_EDGE_X], '\0', CANVAS_COLUMNS);
+    memset(cells[CANVAS_MIDDLE_EDGE_X], '\0', CANVAS_COLUMNS);
+    memset(cells[CANVAS_LOWER_EDGE_X], '\0', CANVAS_COLUMNS);
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        cells[i][CANVAS_LEFT_EDGE_Y] = '\0';
+        cells[i][CANVAS_RIGHT_EDGE_Y] = '\0';
+    }
+    return render_cells(buf, enc, screen, cells, attrs);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render a background or prompt
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  screen: screen model, updated
+ * @param  art: ASCII Art matrix, '\0' cells are skipped
+ * @param  rows: art rows
+ * @param  columns: art columns
+ * @param  startRow: screen row of the upper left corner
+ * @param  startColumn: screen column of the upper left corner
+ * @param  clean: erase the area instead of printing the art
+ * @retval The number of bytes appended
+ * @note   Cells outside the canvas are ignored, the art takes the theme colors
+ */
+int render_art(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen, const char art[], int rows, int columns,
+               int startRow, int startColumn, bool clean)
+{
+    char cells[CANVAS_ROWS][CANVAS_COLUMNS];
+
+    memset(cells, '\0', sizeof(cells));
+    for (int i = 0; i < rows && (i + startRow) < CANVAS_ROWS; i++)
+    {
+        for (int j = 0; j < columns && (j + startColumn) < CANVAS_COLUMNS; j++)
+        {
+            cells[i + startRow][j + startColumn] = clean ? ' ' : art[(i * columns) + j];
+        }
+    }
+    return render_cells(buf, enc, screen, cells, NULL);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Change the colors of the cells drawn without attributes
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  theme: new theme attribute
+ * @retval The number of bytes appended
+ * @note   Cells already on screen keep their colors until drawn again
+ */
+int render_theme(OUTBUFFER *buf, ENCODER *enc, ATTR theme)
+{
+    int start = buf->len;
+
+    enc->theme = theme;
+    encoder_pen(buf, enc, theme);
+    return buf->len - start;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Clear the whole screen
+ * @param  buf: destination buffer
+ * @retval The number of bytes appended
+ * @note   The terminal fills the screen with the theme background
+ */
+int render_clear(OUTBUFFER *buf)
+{
+    int start = buf->len;
+    outbuf_printf(buf, "\033[H\033[2J");
+    return buf->len - start;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Render a whole screen, used to resynchronize a terminal
+ * @param  buf: destination buffer
+ * @param  enc: encoder
+ * @param  screen: screen model
+ * @retval The number of bytes appended
+ */
+int render_keyframe(OUTBUFFER *buf, ENCODER *enc, SCREEN *screen)
+{
+    SCREEN blank;
+    ATTR theme = enc->theme;
+    int start = buf->len;
+
+    // the clear goes in the same synchronized update, the terminal never shows it alone
+    render_clear(buf);
+    screen_fill(&blank, ' ', theme);
+    // the model attributes are resolved already, with a zero theme they are drawn as they are
+    enc->theme = 0;
+    encoder_cells(buf, enc, &blank, screen->glyph, screen->attr);
+    enc->theme = theme;
+    encoder_pen(buf, enc, theme);
+    return encoder_sync(buf, enc, start);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Set every cell of a screen model
+ * @param  screen: screen model
+ * @param  glyph: glyph of every cell, '\0' when unknown
+ * @param  attr: resolved attribute of every cell
+ */
+void screen_fill(SCREEN *screen, char glyph, ATTR attr)
+{
+    memset(screen->glyph, glyph, sizeof(screen->glyph));
+    for (int i = 0; i < CANVAS_ROWS; i++)
+    {
+        for (int j = 0; j < CANVAS_COLUMNS; j++)
+        {
+            screen->attr[i][j] = attr;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Apply a text printed at a position to a screen model
+ * @param  screen: screen model
+ * @param  row: screen row
+ * @param  column: screen column of the first character
+ * @param  text: printed text
+ * @param  attr: resolved attribute the text was printed with
+ */
+void screen_apply_text(SCREEN *screen, int row, int column, const char *text, ATTR attr)
+{
+    if (row < 0 || row >= CANVAS_ROWS)
+    {
+        return;
+    }
+    for (int j = column; *text != '\0' && j < CANVAS_COLUMNS; j++, text++)
+    {
+        screen->glyph[row][j] = *text;
+        screen->attr[row][j] = attr;
+    }
+}
+//**************************************************************************************
@@ -0,0 +1,248 @@
+/*******************************************************************************
+* @filename: replay.c
+* @brief: Recorded games, the seed and the actions of a game saved as text and
+*         played again on the env fixed tick
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/replay.h"
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+static const char *actionName[] = {[envNoop] = "noop", [envUp] = "up", [envDown] = "down", [envShoot] = "shoot"};
+static const char *difficultyName[] = {[easy] = "easy", [normal] = "normal", [hard] = "hard"};
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Find a name in a table
+ * @retval Its index, -1 if not found
+ */
+static int replay_lookup(const char *names[], int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start an empty recording
+ * @param  seed: game random seed, see gameSeed()
+ * @param  level: first level played
+ * @retval None
+ */
+void replay_init(REPLAY *replay, uint32_t seed, enum difficulty difficulty, int level)
+{
+    memset(replay, 0, sizeof(REPLAY));
+    replay->seed = seed;
+    replay->difficulty = difficulty;
+    replay->level = level;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Release the recorded actions
+ * @retval None
+ */
+void replay_free(REPLAY *replay)
+{
+    free(replay->event);
+    replay->event = NULL;
+    replay->nEvents = replay->size = 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Record an action
+ * @param  tick: env steps since the game started
+ * @retval None
+ * @note   The game takes one key per tick, a second one on the same tick
+ *         moves to the next
+ */
+void replay_add(REPLAY *replay, uint64_t tick, enum envAction action)
+{
+    if (action == envNoop)
+    {
+        return;
+    }
+    if (replay->nEvents > 0 && tick <= replay->event[replay->nEvents - 1].tick)
+    {
+        tick = replay->event[replay->nEvents - 1].tick + 1;
+    }
+    if (replay->nEvents == replay->size)
+    {
+        int size = (replay->size > 0) ? replay->size * 2 : 256;
+        REPLAY_EVENT *event = realloc(replay->event, size * sizeof(REPLAY_EVENT));
+        if (event == NULL)
+        {
+            return;
+        }
+        replay->event = event;
+        replay->size = size;
+    }
+    replay->event[replay->nEvents++] = (REPLAY_EVENT) {tick, action};
+    if (replay->ticks <= tick)
+    {
+        replay->ticks = tick + 1;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write a replay file
+ * @retval True if success
+ */
+bool replay_save(const REPLAY *replay, const char *path)
+{
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "%s\nseed %" PRIu32 "\ndifficulty %s\nlevel %d\nticks %" PRIu64 "\n",
+            REPLAY_MAGIC, replay->seed, difficultyName[replay->difficulty], replay->level, replay->ticks);
+    for (int i = 0; i < replay->nEvents; i++)
+    {
+        fprintf(file, "%" PRIu64 " %s\n", replay->event[i].tick, actionName[replay->event[i].action]);
+    }
+    return fclose(file) == 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read a replay file
+ * @retval True if success, free it with replay_free()
+ */
+bool replay_load(REPLAY *replay, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[128], name[16];
+    bool valid;
+    uint64_t tick;
+
+    replay_init(replay, 0, normal, 1);
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    valid = fgets(line, sizeof(line), file) != NULL && strncmp(line, REPLAY_MAGIC, strlen(REPLAY_MAGIC)) == 0;
+    while (valid && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "seed %" SCNu32, &replay->seed) == 1 ||
+            sscanf(line, "level %d", &replay->level) == 1 ||
+            sscanf(line, "ticks %" SCNu64, &replay->ticks) == 1)
+        {
+            continue;
+        }
+        if (sscanf(line, "difficulty %15s", name) == 1)
+        {
+            int difficulty = replay_lookup(difficultyName, 3, name);
+            valid = (difficulty >= 0);
+            replay->difficulty = (enum difficulty) difficulty;
+        }
+        else if (sscanf(line, "%" SCNu64 " %15s", &tick, name) == 2)
+        {
+            int action = replay_lookup(actionName, 4, name);
+            valid = (action > envNoop);
+            if (valid)
+            {
+                replay_add(replay, tick, (enum envAction) action);
+            }
+        }
+        else
+        {
+            valid = (line[0] == '\n' || line[0] == '#');
+        }
+    }
+    fclose(file);
+
+    if (!valid)
+    {
+        replay_free(replay);
+    }
+    return valid;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start the recorded game
+ * @retval None
+ */
+void replay_start(const REPLAY *replay, ENV *env)
+{
+    env_reset(env, replay->seed, replay->difficulty, replay->level);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Action recorded for a tick
+ * @param  next: first event not played yet, zero when the game starts
+ * @param  tick: env steps since the game started
+ * @retval The action to pass to env_step()
+ */
+enum envAction replay_action(const REPLAY *replay, int *next, uint64_t tick)
+{
+    if (*next < replay->nEvents && replay->event[*next].tick == tick)
+    {
+        return replay->event[(*next)++].action;
+    }
+    return envNoop;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the recorded game up to a tick, as env_step() with
+ *         replay_action() on every tick would. The ticks between two actions
+ *         go through env_skip()
+ * @param  next: first event not played yet, zero when the game starts
+ * @param  ticks: env steps since the game started when it returns, fewer if
+ *         the game ends
+ * @retval None
+ */
+void replay_play(const REPLAY *replay, ENV *env, int *next, uint64_t ticks)
+{
+    while (env->steps < ticks && !env->done)
+    {
+        uint64_t tick = ticks;
+
+        // an event left behind by one on the same tick is never played, as in replay_action()
+        if (*next < replay->nEvents && replay->event[*next].tick >= env->steps && replay->event[*next].tick < ticks)
+        {
+            tick = replay->event[*next].tick;
+        }
+        env_skip(env, tick - env->steps);
+        if (tick < ticks && !env->done)
+        {
+            env_step(env, replay_action(replay, next, tick));
+        }
+    }
+}
+//**************************************************************************************
@@ -0,0 +1,469 @@
+/*******************************************************************************
+* @filename: rewind.c
+* @brief: Rewind history, a memory bounded ring of the recent game states kept
+*         as keyframes and XOR deltas with their zero runs packed
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/rewind.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Length fields around each entry
+#define REWIND_HEADER 2
+#define REWIND_ENTRY_OVERHEAD (2 * REWIND_HEADER)
+
+// Longest packed state, a run header and a literal byte every two bytes
+#define REWIND_MAX_PACKED (REWIND_STATE_SIZE * 2 + 16)
+
+// entry kinds, first packed byte
+#define REWIND_DELTA 0
+#define REWIND_KEYFRAME 1
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Write a run length, seven bits per byte
+ * @retval Bytes written
+ */
+static int rewind_put(uint8_t *out, unsigned value)
+{
+    int len = 0;
+
+    do
+    {
+        out[len++] = (uint8_t) ((value & 0x7F) | ((value > 0x7F) ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+    return len;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read a run length written by rewind_put()
+ * @param  pos: read position, advanced
+ * @retval The run length, -1 past the end
+ */
+static int rewind_get(const uint8_t *data, int len, int *pos)
+{
+    unsigned value = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        if (*pos >= len || shift > 28)
+        {
+            return -1;
+        }
+        byte = data[(*pos)++];
+        value |= (unsigned) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return (int) value;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write a zero run and a literal run, one byte when both are short
+ * @retval Bytes written
+ */
+static int rewind_put_runs(uint8_t *out, int zeros, int literals)
+{
+    int len = 1;
+
+    // a nibble each, 15 means the rest follows
+    out[0] = (uint8_t) (((zeros < 15) ? zeros : 15) << 4 | ((literals < 15) ? literals : 15));
+    if (zeros >= 15)
+    {
+        len += rewind_put(out + len, zeros - 15);
+    }
+    if (literals >= 15)
+    {
+        len += rewind_put(out + len, literals - 15);
+    }
+    return len;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read the runs written by rewind_put_runs()
+ * @param  pos: read position, advanced
+ * @retval True if success
+ */
+static bool rewind_get_runs(const uint8_t *data, int len, int *pos, int *zeros, int *literals)
+{
+    int more;
+
+    if (*pos >= len)
+    {
+        return false;
+    }
+    *zeros = data[*pos] >> 4;
+    *literals = data[*pos] & 0x0F;
+    (*pos)++;
+    if (*zeros == 15)
+    {
+        more = rewind_get(data, len, pos);
+        *zeros += more;
+        if (more < 0) return false;
+    }
+    if (*literals == 15)
+    {
+        more = rewind_get(data, len, pos);
+        *literals += more;
+        if (more < 0) return false;
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Pack the XOR of two states, as pairs of a zero run and a literal run
+ * @param  base: state before, NULL for a keyframe
+ * @param  out: at least REWIND_MAX_PACKED bytes
+ * @retval Packed length
+ */
+static int rewind_pack(const uint8_t *state, const uint8_t *base, uint8_t *out)
+{
+    int len = 0, i = 0;
+
+    while (i < (int) REWIND_STATE_SIZE)
+    {
+        int zeros = 0, literals = 0;
+
+        while (i + zeros < (int) REWIND_STATE_SIZE && state[i + zeros] == (base ? base[i + zeros] : 0))
+        {
+            zeros++;
+        }
+        i += zeros;
+        // a lone unchanged byte is cheaper inside the literal run
+        while (i + literals < (int) REWIND_STATE_SIZE)
+        {
+            int j = i + literals;
+            bool same = (state[j] == (base ? base[j] : 0));
+            bool nextSame = (j + 1 >= (int) REWIND_STATE_SIZE) || (state[j + 1] == (base ? base[j + 1] : 0));
+            if (same && nextSame)
+            {
+                break;
+            }
+            literals++;
+        }
+
+        len += rewind_put_runs(out + len, zeros, literals);
+        for (int j = 0; j < literals; j++, i++)
+        {
+            out[len++] = state[i] ^ (base ? base[i] : 0);
+        }
+    }
+    return len;
+}
+//**************************************************************************************
+
+/**
+ * @brief  XOR packed bytes into a state
+ * @retval True if they covered the whole state
+ */
+static bool rewind_unpack(uint8_t *state, const uint8_t *data, int len)
+{
+    int pos = 0, i = 0;
+
+    while (i < (int) REWIND_STATE_SIZE)
+    {
+        int zeros, literals;
+
+        if (!rewind_get_runs(data, len, &pos, &zeros, &literals) ||
+            i + zeros + literals > (int) REWIND_STATE_SIZE || pos + literals > len)
+        {
+            return false;
+        }
+        i += zeros;
+        for (int j = 0; j < literals; j++)
+        {
+            state[i++] ^= data[pos++];
+        }
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Length field of an entry
+ * @retval The packed length
+ */
+static int rewind_length(const REWIND *history, int pos)
+{
+    return history->data[pos] | (history->data[pos + 1] << 8);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Entry after the one at pos
+ * @retval Its position
+ */
+static int rewind_next(const REWIND *history, int pos)
+{
+    pos += REWIND_ENTRY_OVERHEAD + rewind_length(history, pos);
+    return (history->wrapped && pos == history->wrapEnd) ? 0 : pos;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Entry ending at end
+ * @retval Its position
+ */
+static int rewind_before(const REWIND *history, int end)
+{
+    if (history->wrapped && end == 0)
+    {
+        end = history->wrapEnd;
+    }
+    return end - REWIND_ENTRY_OVERHEAD - rewind_length(history, end - REWIND_HEADER);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Drop the oldest entry
+ * @retval None
+ */
+static void rewind_evict(REWIND *history)
+{
+    history->tail = rewind_next(history, history->tail);
+    history->count--;
+    if (history->count == 0)
+    {
+        rewind_clear(history);
+    }
+    else if (history->wrapped && history->tail == 0)
+    {
+        // the entries above head are all gone
+        history->wrapped = false;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Make room for an entry at head, dropping the oldest ones
+ * @retval True if it fits the ring
+ */
+static bool rewind_reserve(REWIND *history, int need)
+{
+    if (need > history->size)
+    {
+        return false;
+    }
+    for (;;)
+    {
+        if (!history->wrapped)
+        {
+            if (history->head + need <= history->size)
+            {
+                return true;
+            }
+            // entries never wrap, the next one starts at zero
+            history->wrapEnd = history->head;
+            history->head = 0;
+            history->wrapped = true;
+        }
+        else if (history->head + need <= history->tail)
+        {
+            return true;
+        }
+        else
+        {
+            rewind_evict(history);
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Allocate an empty history
+ * @param  size: ring bytes, see REWIND_BUFFER_SIZE
+ * @retval True if success
+ */
+bool rewind_init(REWIND *history, int size)
+{
+    memset(history, 0, sizeof(REWIND));
+    history->data = malloc(size);
+    history->size = (history->data != NULL) ? size : 0;
+    return history->data != NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Release the history
+ * @retval None
+ */
+void rewind_free(REWIND *history)
+{
+    free(history->data);
+    memset(history, 0, sizeof(REWIND));
+}
+//**************************************************************************************
+
+/**
+ * @brief  Forget every state, when a new game starts
+ * @retval None
+ */
+void rewind_clear(REWIND *history)
+{
+    history->head = history->tail = history->wrapEnd = 0;
+    history->wrapped = false;
+    history->count = 0;
+    history->sinceKeyframe = 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Save the game state, call it every tick
+ * @retval True if it was saved, states closer than REWIND_INTERVAL are skipped
+ */
+bool rewind_push(REWIND *history, const GAME *game)
+{
+    uint8_t packed[REWIND_MAX_PACKED];
+    bool keyframe;
+    int len, need;
+
+    if (history->data == NULL ||
+        (history->count > 0 && game->now >= history->lastTime && game->now - history->lastTime < REWIND_INTERVAL))
+    {
+        return false;
+    }
+
+    keyframe = (history->count == 0 || history->sinceKeyframe + 1 >= REWIND_KEYFRAME_INTERVAL);
+    packed[0] = keyframe ? REWIND_KEYFRAME : REWIND_DELTA;
+    len = 1 + rewind_pack((const uint8_t *) game, keyframe ? NULL : history->last, packed + 1);
+    need = len + REWIND_ENTRY_OVERHEAD;
+    if (!rewind_reserve(history, need))
+    {
+        return false;
+    }
+
+    uint8_t *entry = &history->data[history->head];
+    entry[0] = entry[need - 2] = (uint8_t) len;
+    entry[1] = entry[need - 1] = (uint8_t) (len >> 8);
+    memcpy(entry + REWIND_HEADER, packed, len);
+    history->head += need;
+    history->count++;
+    history->sinceKeyframe = keyframe ? 0 : history->sinceKeyframe + 1;
+
+    memcpy(history->last, game, REWIND_STATE_SIZE);
+    history->lastTime = game->now;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Put the game back to an older state, the newer ones are dropped
+ * @param  time: game time to go back, REWIND_INTERVAL steps
+ * @retval Game time actually gone back from the newest state, zero if none
+ * @note   Only the game state is restored, redraw the game after it
+ */
+uint64_t rewind_back(REWIND *history, GAME *game, uint64_t time)
+{
+    uint8_t state[REWIND_STATE_SIZE];
+    uint64_t steps = (time + REWIND_INTERVAL - 1) / REWIND_INTERVAL;
+    int target, keyframe, index, keyframeIndex, pos;
+
+    if (history->count < 2)
+    {
+        return 0;
+    }
+
+    // the entry to go back to, no further than the oldest one
+    target = rewind_before(history, history->head);
+    index = history->count - 1;
+    while (steps > 0 && target != history->tail)
+    {
+        target = rewind_before(history, target);
+        index--;
+        steps--;
+    }
+
+    // the keyframe it's rebuilt from
+    keyframe = target;
+    keyframeIndex = index;
+    while (history->data[keyframe + REWIND_HEADER] != REWIND_KEYFRAME && keyframe != history->tail)
+    {
+        keyframe = rewind_before(history, keyframe);
+        keyframeIndex--;
+    }
+    if (history->data[keyframe + REWIND_HEADER] != REWIND_KEYFRAME)
+    {
+        // the keyframe before it was dropped, the next one is the oldest state
+        // left, a ring shorter than REWIND_KEYFRAME_INTERVAL may hold none
+        int newest = rewind_before(history, history->head);
+        while (history->data[target + REWIND_HEADER] != REWIND_KEYFRAME)
+        {
+            if (target == newest)
+            {
+                return 0;
+            }
+            target = rewind_next(history, target);
+            index++;
+        }
+        keyframe = target;
+        keyframeIndex = index;
+    }
+    if (index == history->count - 1)
+    {
+        return 0;
+    }
+
+    // forward from the keyframe to the target
+    memset(state, 0, sizeof(state));
+    pos = keyframe;
+    for (;;)
+    {
+        const uint8_t *packed = &history->data[pos + REWIND_HEADER];
+        if (!rewind_unpack(state, packed + 1, rewind_length(history, pos) - 1))
+        {
+            rewind_clear(history);
+            return 0;
+        }
+        if (pos == target)
+        {
+            break;
+        }
+        pos = rewind_next(history, pos);
+    }
+
+    // the states after the target are gone
+    if (history->wrapped && target >= history->tail)
+    {
+        history->wrapped = false;
+    }
+    history->head = target + REWIND_ENTRY_OVERHEAD + rewind_length(history, target);
+    history->count = index + 1;
+    history->sinceKeyframe = index - keyframeIndex;
+
+    memcpy(history->last, state, REWIND_STATE_SIZE);
+    memcpy(game, state, REWIND_STATE_SIZE);
+    // the debris of the dropped states is dropped too
+    game->particle.count = 0;
+    time = history->lastTime - game->now;
+    history->lastTime = game->now;
+    return time;
+}
+//**************************************************************************************
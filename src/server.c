@@ -0,0 +1,1420 @@
+/*******************************************************************************
+* @filename: server.c
+* @brief: Multi-session game server, players connect over TCP (e.g. telnet) and
+*         every session is driven by an epoll loop on its tick deadlines.
+*         Spectators attach to running sessions and share the encoded frames
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/server.h"
+#include "include/metrics.h"
+#include "include/rewind.h"
+
+#ifdef _WIN32 // @windows
+
+/**
+ * @brief  Dummy function, the server needs epoll
+ * @retval Non zero
+ */
+int serverRun(const char *address, int workers, const char *spectate, double speed)
+{
+    (void) address;
+    (void) workers;
+    (void) spectate;
+    (void) speed;
+    printf("Server mode is only available on Linux\n");
+    return 1;
+}
+//**************************************************************************************
+#else // @linux
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Telnet commands
+#define TELNET_IAC 255
+#define TELNET_DONT 254
+#define TELNET_WILL 251
+#define TELNET_SB 250
+#define TELNET_SE 240
+#define TELNET_ECHO 1
+#define TELNET_SGA 3
+
+// Games listed in the spectator lobby
+#define LOBBY_MAX_GAMES 20
+#define LOBBY_MAX_ID_DIGITS 6
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// what an epoll event points to, first member of every connection
+enum connectionKind
+{
+    connectionPlayerListener,
+    connectionViewerListener,
+    connectionAssetWatch,
+    connectionPlayer,
+    connectionViewer
+};
+
+// session screen
+enum sessionState
+{
+    sessionPlaying,
+    sessionPaused,
+    sessionGameOver
+};
+
+// input decoder state
+enum inputState
+{
+    inputNormal,
+    inputEsc,
+    inputCsi,
+    inputIac,
+    inputIacOption,
+    inputIacSub
+};
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// keys decoded from a connection
+typedef struct KeyDecoder
+{
+    int input[SERVER_INPUT_RING];
+    unsigned head, tail;
+    enum inputState state;
+    bool lastCr;
+} KEYDECODER;
+
+typedef struct Listener
+{
+    enum connectionKind kind;
+    int fd;
+} LISTENER;
+
+typedef struct Viewer VIEWER;
+
+typedef struct Session
+{
+    enum connectionKind kind;
+    int fd;
+    int index, id;
+    bool closed, writeWait;
+    enum sessionState state;
+    GAME game;
+    int bestScore;
+    KEYDECODER keys;
+    // terminal output not sent yet
+    OUTBUFFER out;
+    // what the player terminal shows, spectator keyframes are built from it
+    SCREEN screen;
+    ENCODER encoder;
+    VIEWER *viewers;
+    int nViewers;
+    // time
+    uint64_t pausedTime, startTimePause, startTimeFrame;
+    // recent game states, the rewind key goes back to them
+    REWIND history;
+} SESSION;
+
+struct Viewer
+{
+    enum connectionKind kind;
+    int fd;
+    int index;
+    bool closed, writeWait, needKeyframe;
+    KEYDECODER keys;
+    // watched session, NULL while in the lobby
+    SESSION *session;
+    VIEWER *prev, *next;
+    // shared frames not sent yet, the head one may be partially sent
+    FRAME *queue[SERVER_VIEWER_QUEUE];
+    unsigned queueHead, queueTail;
+    int sent;
+    // game ID typed in the lobby
+    char line[LOBBY_MAX_ID_DIGITS + 1];
+    int lineLen;
+};
+
+typedef struct Worker
+{
+    int epollFd;
+    LISTENER players, viewers;
+    // art files changes, see reloadFiles()
+    LISTENER assets;
+    int nSessions, nViewers, nextId;
+    SESSION *session[SERVER_MAX_SESSIONS];
+    VIEWER *viewer[SERVER_MAX_VIEWERS];
+} WORKER;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+static volatile sig_atomic_t running = 1;
+
+// Game time played per wall-clock time in every session, see --speed
+static double gameSpeed = 1;
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Stop the server loops
+ */
+static void serverSignal(int sig)
+{
+    (void) sig;
+    running = 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Queue a decoded key
+ * @retval None
+ */
+static void keyPush(KEYDECODER *k, int key)
+{
+    if (k->tail - k->head < SERVER_INPUT_RING)
+    {
+        k->input[k->tail++ & (SERVER_INPUT_RING - 1)] = key;
+        metrics.inputEvents++;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take the oldest queued key
+ * @retval The key or zero if none
+ */
+static int keyPop(KEYDECODER *k)
+{
+    if (k->head == k->tail)
+    {
+        return 0;
+    }
+    return k->input[k->head++ & (SERVER_INPUT_RING - 1)];
+}
+//**************************************************************************************
+
+/**
+ * @brief  Decode telnet commands and ANSI arrow keys from the client bytes
+ * @retval None
+ */
+static void keyDecode(KEYDECODER *k, const unsigned char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        unsigned char ch = data[i];
+        bool lastCr = k->lastCr;
+        k->lastCr = false;
+
+        switch (k->state)
+        {
+            case inputNormal:
+                if (ch == TELNET_IAC) k->state = inputIac;
+                else if (ch == ESC) k->state = inputEsc;
+                else if (ch == '\r') { keyPush(k, ENTER); k->lastCr = true; }
+                else if (ch == '\n' || ch == '\0') { if (!lastCr) keyPush(k, ENTER); }
+                else keyPush(k, ch);
+                break;
+
+            case inputEsc:
+                if (ch == '[' || ch == 'O')
+                {
+                    k->state = inputCsi;
+                }
+                else
+                {
+                    // lone escape followed by a regular key
+                    keyPush(k, ESC);
+                    k->state = inputNormal;
+                    i--;
+                }
+                break;
+
+            case inputCsi:
+                // parameters end at the final byte
+                if (ch >= 0x40 && ch <= 0x7E)
+                {
+                    if (ch == 'A') keyPush(k, UP);
+                    else if (ch == 'B') keyPush(k, DOWN);
+                    k->state = inputNormal;
+                }
+                break;
+
+            case inputIac:
+                if (ch >= TELNET_WILL && ch <= TELNET_DONT) k->state = inputIacOption;
+                else if (ch == TELNET_SB) k->state = inputIacSub;
+                else k->state = inputNormal;
+                break;
+
+            case inputIacOption:
+                k->state = inputNormal;
+                break;
+
+            case inputIacSub:
+                if (ch == TELNET_SE) k->state = inputNormal;
+                break;
+        }
+    }
+
+    // an escape alone at the end of a read is the ESC key
+    if (k->state == inputEsc)
+    {
+        keyPush(k, ESC);
+        k->state = inputNormal;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read everything a client sent into its key decoder
+ * @retval False if the connection is gone
+ */
+static bool keyRead(int fd, KEYDECODER *k)
+{
+    unsigned char buf[SERVER_READ_SIZE];
+
+    while (true)
+    {
+        int n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            keyDecode(k, buf, n);
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            return !(n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write queued output without blocking
+ * @retval None
+ */
+static void sessionFlush(WORKER *w, SESSION *s)
+{
+    while (s->out.len > 0)
+    {
+        int n = send(s->fd, s->out.data, s->out.len, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            outbuf_consume(&s->out, n);
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            s->closed = true;
+            return;
+        }
+    }
+
+    // only wait for EPOLLOUT while there is something queued
+    bool writeWait = (s->out.len > 0);
+    if (writeWait != s->writeWait)
+    {
+        struct epoll_event ev = {.events = EPOLLIN | (writeWait ? EPOLLOUT : 0), .data.ptr = s};
+        epoll_ctl(w->epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->writeWait = writeWait;
+    }
+    if (s->out.len > SERVER_MAX_OUTPUT)
+    {
+        s->closed = true;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Clear the player screen
+ * @retval None
+ */
+static void sessionClear(SESSION *s)
+{
+    metrics.bytesWritten += render_clear(&s->out);
+    screen_fill(&s->screen, ' ', s->encoder.theme);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print a background or prompt on the player screen
+ * @note   Same parameters as render_art()
+ * @retval None
+ */
+static void sessionArt(SESSION *s, const char art[], int rows, int columns, int startRow, int startColumn, bool clean)
+{
+    metrics.bytesWritten += render_art(&s->out, &s->encoder, &s->screen, art, rows, columns, startRow, startColumn, clean);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print a number on the player screen
+ * @param  row: screen row, from zero
+ * @param  column: screen column, from zero
+ * @retval None
+ */
+static void sessionNumber(SESSION *s, int row, int column, const char *format, int value)
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), format, value);
+    outbuf_printf(&s->out, "\033[%d;%dH%s", row + 1, column + 1, text);
+    screen_apply_text(&s->screen, row, column, text, s->encoder.theme);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print the game over prompt with the player results
+ * @retval None
+ */
+static void sessionSetGameOver(SESSION *s)
+{
+    PLAYER *player = &s->game.player;
+
+    if (player->score > s->bestScore)
+    {
+        s->bestScore = player->score;
+    }
+
+    sessionClear(s);
+    sessionArt(s, prompt.gameoverPrompt, GAMEOVER_PROMPT_ROWS, GAMEOVER_PROMPT_COLUMNS, GAMEOVER_PROMPT_X, GAMEOVER_PROMPT_Y, false);
+    sessionNumber(s, 11, 41, "%03i", player->balloonsDestroyed);
+    sessionNumber(s, 11, 47, "%03i", BALLOON_POINTS);
+    sessionNumber(s, 11, 53, "%06i", player->balloonsDestroyed * BALLOON_POINTS);
+    sessionNumber(s, 13, 41, "%03i", player->monstersKilled);
+    sessionNumber(s, 13, 47, "%03i", MONSTER_POINTS);
+    sessionNumber(s, 13, 53, "%06i", player->monstersKilled * MONSTER_POINTS);
+    sessionNumber(s, 15, 41, "%03i", player->arrowsLeft);
+    sessionNumber(s, 15, 47, "%03i", ARROW_LEFT_POINTS);
+    sessionNumber(s, 15, 53, "%06i", player->arrowsLeft * ARROW_LEFT_POINTS);
+    sessionNumber(s, 17, 36, "%06i", player->score);
+
+    s->state = sessionGameOver;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Game time of a session
+ * @param  now: wall-clock time in microseconds
+ * @retval Game time in microseconds, it runs gameSpeed times the wall clock
+ *         and stops while the session is paused
+ */
+static uint64_t sessionClock(SESSION *s, uint64_t now)
+{
+    return (uint64_t) ((double) (now - s->pausedTime) * gameSpeed);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start a game from level one
+ * @retval None
+ */
+static void sessionStartGame(SESSION *s, uint64_t now)
+{
+    gameReset(&s->game);
+    sessionClear(s);
+    sessionArt(s, backGround.game, CANVAS_ROWS, CANVAS_COLUMNS, 0, 0, false);
+    printNumberInGame(&s->game, s->bestScore, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+
+    s->game.now = sessionClock(s, now);
+    gameStartLevel(&s->game);
+    rewind_clear(&s->history);
+    s->state = sessionPlaying;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Redraw the game of a player after the art changed
+ * @param  changed: ASSET_BIT() mask from reloadFiles()
+ * @retval None
+ */
+static void sessionRedraw(SESSION *s, uint32_t changed)
+{
+    // other screens are printed whole every time they are shown
+    if (s->state == sessionGameOver || !(changed & ASSET_GAME_MASK))
+    {
+        return;
+    }
+
+    gameRedraw(&s->game, (changed & ASSET_BIT(assetGame)) ? backGround.game : NULL);
+    if (changed & ASSET_BIT(assetGame))
+    {
+        printNumberInGame(&s->game, s->bestScore, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Advance a session by one tick
+ * @param  now: wall-clock time in microseconds
+ * @retval None
+ */
+static void sessionTick(SESSION *s, uint64_t now)
+{
+    GAME *game = &s->game;
+    int key = keyPop(&s->keys);
+
+    switch (s->state)
+    {
+        case sessionPlaying:
+            if (key == ESC)
+            {
+                // PAUSE MENU
+                s->startTimePause = now;
+                sessionArt(s, prompt.quitGamePrompt, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_X, QUITGAME_PROMPT_Y, false);
+                s->state = sessionPaused;
+                return;
+            }
+            if (key == REWIND_KEY)
+            {
+                // back a few seconds, the game time goes on from there
+                if (rewind_back(&s->history, game, REWIND_STEP) > 0)
+                {
+                    s->pausedTime = now - (uint64_t) ((double) game->now / gameSpeed);
+                    gameRedraw(game, backGround.game);
+                    printNumberInGame(game, s->bestScore, HIGHSCORE_DISPLAY_X, HIGHSCORE_DISPLAY_Y, "%06i");
+                }
+                return;
+            }
+
+            gameAdvance(game, sessionClock(s, now), key);
+
+            if (game->player.gameOver || game->player.levelOver)
+            {
+                if (gameEndLevel(game))
+                {
+                    gameStartLevel(game);
+                }
+                else
+                {
+                    sessionSetGameOver(s);
+                    return;
+                }
+            }
+            rewind_push(&s->history, game);
+
+            // Frames per seconds (FPS) Control, a client still reading the last frame is skipped
+            if ((now - s->startTimeFrame) >= (1000000 / FPS_LIMIT))
+            {
+                if (s->out.len == 0)
+                {
+                    uint64_t startTimeFrame = get_clock();
+                    int bytes = render_layer(&s->out, &s->encoder, &s->screen, game->layer, game->attr);
+                    memset(game->layer, '\0', sizeof(game->layer));
+                    memset(game->attr, 0, sizeof(game->attr));
+                    metrics_frame(time_diff(startTimeFrame), bytes);
+                    s->startTimeFrame = now;
+                }
+                else
+                {
+                    metrics.framesDropped++;
+                }
+            }
+            break;
+
+        case sessionPaused:
+            if (key == ENTER)
+            {
+                game->player.gameOver = true;
+                gameEndLevel(game);
+                sessionSetGameOver(s);
+            }
+            else if (key == ESC)
+            {
+                s->pausedTime += now - s->startTimePause;
+                sessionArt(s, NULL, QUITGAME_PROMPT_ROWS, QUITGAME_PROMPT_COLUMNS, QUITGAME_PROMPT_X, QUITGAME_PROMPT_Y, true);
+                s->state = sessionPlaying;
+            }
+            break;
+
+        case sessionGameOver:
+            if (key == ENTER)
+            {
+                sessionStartGame(s, now);
+            }
+            break;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write queued frames without blocking, several frames per system call
+ * @retval None
+ */
+static void viewerFlush(WORKER *w, VIEWER *v)
+{
+    while (v->queueHead != v->queueTail)
+    {
+        struct iovec iov[SERVER_VIEWER_IOV];
+        struct msghdr msg = {.msg_iov = iov};
+        int n = 0;
+
+        for (unsigned i = v->queueHead; i != v->queueTail && n < SERVER_VIEWER_IOV; i++, n++)
+        {
+            FRAME *frame = v->queue[i & (SERVER_VIEWER_QUEUE - 1)];
+            int offset = (i == v->queueHead) ? v->sent : 0;
+            iov[n].iov_base = frame->data + offset;
+            iov[n].iov_len = frame->len - offset;
+        }
+        msg.msg_iovlen = n;
+
+        ssize_t sent = sendmsg(v->fd, &msg, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            // release the frames sent completely
+            sent += v->sent;
+            while (v->queueHead != v->queueTail)
+            {
+                FRAME *frame = v->queue[v->queueHead & (SERVER_VIEWER_QUEUE - 1)];
+                if (sent < frame->len)
+                {
+                    break;
+                }
+                sent -= frame->len;
+                frame_release(frame);
+                v->queueHead++;
+            }
+            v->sent = (int) sent;
+        }
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            v->closed = true;
+            return;
+        }
+    }
+
+    // only wait for EPOLLOUT while there is something queued
+    bool writeWait = (v->queueHead != v->queueTail);
+    if (writeWait != v->writeWait)
+    {
+        struct epoll_event ev = {.events = EPOLLIN | (writeWait ? EPOLLOUT : 0), .data.ptr = v};
+        epoll_ctl(w->epollFd, EPOLL_CTL_MOD, v->fd, &ev);
+        v->writeWait = writeWait;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Drop the queued frames
+ * @param  keepStarted: keep a partially sent frame, so the terminal never gets a
+ *         sequence cut in half
+ * @retval None
+ */
+static void viewerDrop(VIEWER *v, bool keepStarted)
+{
+    unsigned keep = v->queueHead + ((keepStarted && v->sent > 0) ? 1 : 0);
+
+    while (v->queueTail != v->queueHead && v->queueTail != keep)
+    {
+        frame_release(v->queue[--v->queueTail & (SERVER_VIEWER_QUEUE - 1)]);
+    }
+    if (v->queueHead == v->queueTail)
+    {
+        v->sent = 0;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Queue a shared frame for a viewer
+ * @note   A viewer too slow to keep up loses its queued frames and gets a keyframe
+ *         instead, the player never waits for it
+ * @retval None
+ */
+static void viewerQueue(WORKER *w, VIEWER *v, FRAME *frame)
+{
+    if (v->queueTail - v->queueHead >= SERVER_VIEWER_QUEUE)
+    {
+        viewerDrop(v, true);
+        v->needKeyframe = true;
+        metrics.viewerResyncs++;
+        return;
+    }
+
+    v->queue[v->queueTail++ & (SERVER_VIEWER_QUEUE - 1)] = frame_retain(frame);
+    metrics.viewerFrames++;
+
+    // a viewer waiting for EPOLLOUT is flushed by the event loop
+    if (!v->writeWait)
+    {
+        viewerFlush(w, v);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Queue bytes meant for a single viewer
+ * @retval None
+ */
+static void viewerSend(WORKER *w, VIEWER *v, const char *data, int len)
+{
+    FRAME *frame = frame_new(data, len);
+    if (frame != NULL)
+    {
+        viewerQueue(w, v, frame);
+        frame_release(frame);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Show the games a viewer can watch
+ * @param  message: line printed below the list, may be NULL
+ * @retval None
+ */
+static void viewerLobby(WORKER *w, VIEWER *v, const char *message)
+{
+    OUTBUFFER buf;
+
+    // whatever was left of the last game is not worth sending
+    viewerDrop(v, true);
+    v->needKeyframe = false;
+    v->lineLen = 0;
+
+    outbuf_init(&buf);
+    render_clear(&buf);
+    outbuf_printf(&buf, "Bow and Arrow - Spectate\r\n\r\n");
+    if (w->nSessions == 0)
+    {
+        outbuf_printf(&buf, "No games running\r\n");
+    }
+    else
+    {
+        outbuf_printf(&buf, "  GAME  LEVEL   SCORE  VIEWERS\r\n");
+        for (int i = 0; i < w->nSessions && i < LOBBY_MAX_GAMES; i++)
+        {
+            SESSION *s = w->session[i];
+            outbuf_printf(&buf, "%6d  %5d  %06d  %7d%s\r\n", s->id, s->game.player.level, s->game.player.score,
+                          s->nViewers, (s->state == sessionGameOver) ? "  game over" : "");
+        }
+    }
+    outbuf_printf(&buf, "\r\n%s%s", (message != NULL) ? message : "", (message != NULL) ? "\r\n" : "");
+    outbuf_printf(&buf, "Game to watch (ENTER refreshes, q quits): ");
+
+    viewerSend(w, v, buf.data, buf.len);
+    outbuf_free(&buf);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Start watching a session, the first frame is a keyframe
+ * @retval None
+ */
+static void viewerAttach(VIEWER *v, SESSION *s)
+{
+    v->session = s;
+    v->prev = NULL;
+    v->next = s->viewers;
+    if (s->viewers != NULL)
+    {
+        s->viewers->prev = v;
+    }
+    s->viewers = v;
+    s->nViewers++;
+
+    viewerDrop(v, true);
+    v->needKeyframe = true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Stop watching the current session
+ * @retval None
+ */
+static void viewerDetach(VIEWER *v)
+{
+    SESSION *s = v->session;
+
+    if (s == NULL)
+    {
+        return;
+    }
+    if (v->prev != NULL)
+    {
+        v->prev->next = v->next;
+    }
+    else
+    {
+        s->viewers = v->next;
+    }
+    if (v->next != NULL)
+    {
+        v->next->prev = v->prev;
+    }
+    s->nViewers--;
+    v->session = NULL;
+    v->prev = v->next = NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Handle the keys typed by a viewer
+ * @retval None
+ */
+static void viewerInput(WORKER *w, VIEWER *v)
+{
+    int key;
+
+    while ((key = keyPop(&v->keys)) != 0)
+    {
+        if (v->session != NULL)
+        {
+            if (key == ESC || key == 'q')
+            {
+                viewerDetach(v);
+                viewerLobby(w, v, NULL);
+            }
+        }
+        else if (key == 'q')
+        {
+            v->closed = true;
+        }
+        else if (key >= '0' && key <= '9' && v->lineLen < LOBBY_MAX_ID_DIGITS)
+        {
+            char ch = (char) key;
+            v->line[v->lineLen++] = ch;
+            viewerSend(w, v, &ch, 1);
+        }
+        else if ((key == 127 || key == '\b') && v->lineLen > 0)
+        {
+            v->lineLen--;
+            viewerSend(w, v, "\b \b", 3);
+        }
+        else if (key == ENTER)
+        {
+            SESSION *found = NULL;
+
+            v->line[v->lineLen] = '\0';
+            for (int i = 0; i < w->nSessions && v->lineLen > 0; i++)
+            {
+                if (w->session[i]->id == atoi(v->line) && !w->session[i]->closed)
+                {
+                    found = w->session[i];
+                }
+            }
+
+            if (found != NULL)
+            {
+                viewerAttach(v, found);
+            }
+            else if (v->lineLen > 0)
+            {
+                char message[64];
+                snprintf(message, sizeof(message), "Game %s not found", v->line);
+                viewerLobby(w, v, message);
+            }
+            else
+            {
+                viewerLobby(w, v, NULL);
+            }
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Share the output of the last tick with every viewer of a session
+ * @param  mark: length of the player output before the tick
+ * @retval None
+ */
+static void sessionBroadcast(WORKER *w, SESSION *s, int mark)
+{
+    FRAME *delta = NULL, *keyframe = NULL;
+
+    // encoded once, whatever the number of viewers
+    if (s->out.len > mark)
+    {
+        delta = frame_new(s->out.data + mark, s->out.len - mark);
+    }
+
+    for (VIEWER *v = s->viewers; v != NULL; v = v->next)
+    {
+        if (v->needKeyframe)
+        {
+            if (keyframe == NULL)
+            {
+                OUTBUFFER buf;
+                outbuf_init(&buf);
+                render_keyframe(&buf, &s->encoder, &s->screen);
+                keyframe = frame_new(buf.data, buf.len);
+                outbuf_free(&buf);
+            }
+            if (keyframe != NULL)
+            {
+                // the keyframe already holds the delta
+                v->needKeyframe = false;
+                viewerQueue(w, v, keyframe);
+            }
+        }
+        else if (delta != NULL)
+        {
+            viewerQueue(w, v, delta);
+        }
+    }
+
+    frame_release(delta);
+    frame_release(keyframe);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Prepare a new connection for the event loop
+ * @param  ptr: connection the epoll events point to
+ * @retval False if the connection can't be watched
+ */
+static bool serverAccept(WORKER *w, int fd, void *ptr)
+{
+    int one = 1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = ptr};
+    return epoll_ctl(w->epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Accept a new player
+ * @retval None
+ */
+static void sessionOpen(WORKER *w, int fd, uint64_t now)
+{
+    static const unsigned char negotiation[] = {TELNET_IAC, TELNET_WILL, TELNET_ECHO, TELNET_IAC, TELNET_WILL, TELNET_SGA};
+
+    if (w->nSessions >= SERVER_MAX_SESSIONS)
+    {
+        close(fd);
+        return;
+    }
+
+    SESSION *s = calloc(1, sizeof(SESSION));
+    if (s == NULL)
+    {
+        close(fd);
+        return;
+    }
+
+    s->kind = connectionPlayer;
+    s->fd = fd;
+    s->index = w->nSessions;
+    s->id = ++w->nextId;
+    outbuf_init(&s->out);
+    // the client terminal type is not negotiated, REP may be missing
+    encoder_init(&s->encoder, RENDER_CAP_ECH);
+    screen_fill(&s->screen, '\0', 0);
+    gameInit(&s->game, normal);
+    rewind_init(&s->history, REWIND_BUFFER_SIZE);
+
+    if (!serverAccept(w, fd, s))
+    {
+        rewind_free(&s->history);
+        free(s);
+        close(fd);
+        return;
+    }
+    w->session[w->nSessions++] = s;
+    metrics.sessions = w->nSessions;
+
+    // character mode without local echo, resize the window and hide the cursor
+    outbuf_append(&s->out, (const char *) negotiation, sizeof(negotiation));
+    outbuf_printf(&s->out, "\033[8;36;82t\033[?25l");
+    sessionStartGame(s, now);
+    sessionFlush(w, s);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Disconnect a player, its viewers go back to the lobby
+ * @retval None
+ */
+static void sessionClose(WORKER *w, SESSION *s)
+{
+    epoll_ctl(w->epollFd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    outbuf_free(&s->out);
+    rewind_free(&s->history);
+
+    // swap the last session into the free slot
+    w->nSessions--;
+    w->session[s->index] = w->session[w->nSessions];
+    w->session[s->index]->index = s->index;
+    metrics.sessions = w->nSessions;
+
+    while (s->viewers != NULL)
+    {
+        VIEWER *v = s->viewers;
+        viewerDetach(v);
+        viewerLobby(w, v, "The player left");
+    }
+
+    free(s);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Accept a new viewer, it starts in the lobby
+ * @retval None
+ */
+static void viewerOpen(WORKER *w, int fd)
+{
+    static const unsigned char negotiation[] = {TELNET_IAC, TELNET_WILL, TELNET_ECHO, TELNET_IAC, TELNET_WILL, TELNET_SGA};
+    static const char terminal[] = "\033[8;36;82t\033[?25l";
+
+    if (w->nViewers >= SERVER_MAX_VIEWERS)
+    {
+        close(fd);
+        return;
+    }
+
+    VIEWER *v = calloc(1, sizeof(VIEWER));
+    if (v == NULL)
+    {
+        close(fd);
+        return;
+    }
+
+    v->kind = connectionViewer;
+    v->fd = fd;
+    v->index = w->nViewers;
+
+    if (!serverAccept(w, fd, v))
+    {
+        free(v);
+        close(fd);
+        return;
+    }
+    w->viewer[w->nViewers++] = v;
+    metrics.viewers = w->nViewers;
+
+    viewerSend(w, v, (const char *) negotiation, sizeof(negotiation));
+    viewerSend(w, v, terminal, sizeof(terminal) - 1);
+    viewerLobby(w, v, NULL);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Disconnect a viewer
+ * @retval None
+ */
+static void viewerClose(WORKER *w, VIEWER *v)
+{
+    viewerDetach(v);
+    viewerDrop(v, false);
+    epoll_ctl(w->epollFd, EPOLL_CTL_DEL, v->fd, NULL);
+    close(v->fd);
+
+    // swap the last viewer into the free slot
+    w->nViewers--;
+    w->viewer[v->index] = w->viewer[w->nViewers];
+    w->viewer[v->index]->index = v->index;
+    metrics.viewers = w->nViewers;
+
+    free(v);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Open a listening socket shared between workers
+ * @param  address: [host:]port
+ * @param  portOffset: added to the port, gives every worker its own port
+ * @retval The socket or -1 on failure
+ */
+static int serverListen(const char *address, int portOffset)
+{
+    char host[256] = SERVER_DEFAULT_HOST;
+    char port[16];
+    const char *colon = strrchr(address, ':');
+    struct addrinfo hints = {0}, *res;
+    int fd, one = 1;
+
+    // [host:]port
+    if (colon != NULL)
+    {
+        snprintf(host, sizeof(host), "%.*s", (int) (colon - address), address);
+        address = colon + 1;
+    }
+    snprintf(port, sizeof(port), "%d", atoi(address) + portOffset);
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+    {
+        return -1;
+    }
+
+    fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd >= 0)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        if (bind(fd, res->ai_addr, res->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Update the game state gauges from every session
+ * @retval None
+ */
+static void serverGauges(WORKER *w)
+{
+    metrics.level = 0;
+    metrics.activeArrows = metrics.activeBalloons = metrics.activeMonsters = metrics.activeParticles = 0;
+
+    for (int i = 0; i < w->nSessions; i++)
+    {
+        GAME *game = &w->session[i]->game;
+        if (game->player.level > metrics.level)
+        {
+            metrics.level = game->player.level;
+        }
+        metrics.activeArrows += game->arrow.activeIndex;
+        metrics.activeBalloons += game->balloon.activeIndex;
+        metrics.activeMonsters += game->monster.activeIndex;
+        metrics.activeParticles += game->particle.count;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Event loop of one worker
+ * @param  address: [host:]port players connect to
+ * @param  spectate: [host:]port viewers connect to, NULL to disable spectating
+ * @param  index: worker index, added to the spectate port
+ * @retval Zero on a clean shutdown
+ */
+static int serverWorker(const char *address, const char *spectate, int index)
+{
+    WORKER *w = calloc(1, sizeof(WORKER));
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    uint64_t nextTick;
+
+    if (w == NULL)
+    {
+        return 1;
+    }
+
+    w->players.kind = connectionPlayerListener;
+    w->players.fd = serverListen(address, 0);
+    w->viewers.kind = connectionViewerListener;
+    w->viewers.fd = (spectate != NULL) ? serverListen(spectate, index) : -1;
+    w->assets.kind = connectionAssetWatch;
+    // one watch per worker, each one swaps its own copy of the art
+    w->assets.fd = watchFiles();
+    w->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->players.fd < 0 || w->epollFd < 0 || (spectate != NULL && w->viewers.fd < 0))
+    {
+        printf("Failed to listen on %s\n", (w->players.fd < 0) ? address : spectate);
+        free(w);
+        return 1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &w->players};
+    epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->players.fd, &ev);
+    if (w->viewers.fd >= 0)
+    {
+        ev.data.ptr = &w->viewers;
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->viewers.fd, &ev);
+    }
+    if (w->assets.fd >= 0)
+    {
+        ev.data.ptr = &w->assets;
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->assets.fd, &ev);
+    }
+
+    nextTick = get_clock();
+    while (running)
+    {
+        // sleep until the next tick deadline, or until a player shows up
+        int timeout = -1;
+        if (w->nSessions > 0)
+        {
+            int64_t wait = (int64_t) nextTick - (int64_t) get_clock();
+            timeout = (wait > 0) ? (int) ((wait + 999) / 1000) : 0;
+        }
+        else
+        {
+            // bounded so the metrics socket keeps being served
+            timeout = 100;
+        }
+
+        int n = epoll_wait(w->epollFd, events, SERVER_MAX_EVENTS, timeout);
+        uint64_t now = get_clock();
+
+        for (int i = 0; i < n; i++)
+        {
+            enum connectionKind *kind = events[i].data.ptr;
+            int fd;
+
+            switch (*kind)
+            {
+                case connectionPlayerListener:
+                    while ((fd = accept(w->players.fd, NULL, NULL)) >= 0)
+                    {
+                        sessionOpen(w, fd, now);
+                    }
+                    break;
+
+                case connectionViewerListener:
+                    while ((fd = accept(w->viewers.fd, NULL, NULL)) >= 0)
+                    {
+                        viewerOpen(w, fd);
+                    }
+                    break;
+
+                case connectionAssetWatch:
+                {
+                    // between ticks, so no frame mixes old and new art
+                    uint32_t changed = reloadFiles();
+                    for (int j = 0; j < w->nSessions && changed != 0; j++)
+                    {
+                        sessionRedraw(w->session[j], changed);
+                    }
+                    break;
+                }
+
+                case connectionPlayer:
+                {
+                    SESSION *s = (SESSION *) kind;
+                    if ((events[i].events & (EPOLLERR | EPOLLHUP)) || ((events[i].events & EPOLLIN) && !keyRead(s->fd, &s->keys)))
+                    {
+                        s->closed = true;
+                    }
+                    if (events[i].events & EPOLLOUT)
+                    {
+                        sessionFlush(w, s);
+                    }
+                    break;
+                }
+
+                case connectionViewer:
+                {
+                    VIEWER *v = (VIEWER *) kind;
+                    if ((events[i].events & (EPOLLERR | EPOLLHUP)) || ((events[i].events & EPOLLIN) && !keyRead(v->fd, &v->keys)))
+                    {
+                        v->closed = true;
+                    }
+                    if (events[i].events & EPOLLOUT)
+                    {
+                        viewerFlush(w, v);
+                    }
+                    if (!v->closed)
+                    {
+                        viewerInput(w, v);
+                    }
+                    break;
+                }
+            }
+        }
+
+        // tick every session whose deadline passed
+        if (now >= nextTick)
+        {
+            double tickCpu = cpu_clock();
+            for (int i = 0; i < w->nSessions; i++)
+            {
+                SESSION *s = w->session[i];
+                if (!s->closed)
+                {
+                    int mark = s->out.len;
+                    sessionTick(s, now);
+                    if (s->viewers != NULL)
+                    {
+                        sessionBroadcast(w, s, mark);
+                    }
+                    sessionFlush(w, s);
+                }
+            }
+            serverGauges(w);
+            metrics_tick(cpu_clock() - tickCpu);
+
+            nextTick += SERVER_TICK * 1000;
+            // an overloaded worker skips ticks instead of bursting to catch up
+            if (nextTick < now)
+            {
+                nextTick = now + SERVER_TICK * 1000;
+            }
+        }
+
+        // drop disconnected players and viewers
+        for (int i = w->nSessions - 1; i >= 0; i--)
+        {
+            if (w->session[i]->closed)
+            {
+                sessionClose(w, w->session[i]);
+            }
+        }
+        for (int i = w->nViewers - 1; i >= 0; i--)
+        {
+            if (w->viewer[i]->closed)
+            {
+                viewerClose(w, w->viewer[i]);
+            }
+        }
+
+        metrics_poll();
+    }
+
+    while (w->nSessions > 0)
+    {
+        sessionClose(w, w->session[0]);
+    }
+    while (w->nViewers > 0)
+    {
+        viewerClose(w, w->viewer[0]);
+    }
+    close(w->players.fd);
+    if (w->viewers.fd >= 0)
+    {
+        close(w->viewers.fd);
+    }
+    if (w->assets.fd >= 0)
+    {
+        close(w->assets.fd);
+    }
+    close(w->epollFd);
+    free(w);
+    return 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Run the game server until interrupted
+ * @param  address: [host:]port to listen on
+ * @param  workers: number of worker processes, each one with its own epoll loop
+ * @param  spectate: [host:]port for spectators, worker i listens on port + i,
+ *         NULL to disable spectating
+ * @param  speed: game time played per wall-clock time, the spectators watch
+ *         the games at that speed too
+ * @retval Zero on a clean shutdown
+ */
+int serverRun(const char *address, int workers, const char *spectate, double speed)
+{
+    struct sigaction sa = {0};
+    const char *metricsPath = getenv(METRICS_SOCKET_ENV);
+    char path[256];
+
+    sa.sa_handler = serverSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    gameSpeed = speed;
+
+    printf("Listening on %s with %d worker(s)\n", address, workers);
+    if (spectate != NULL)
+    {
+        printf("Spectators on %s%s\n", spectate, (workers > 1) ? ", port + worker index" : "");
+    }
+    fflush(stdout);
+
+    if (workers <= 1)
+    {
+        metrics_init(metricsPath);
+        int ret = serverWorker(address, spectate, 0);
+        metrics_close();
+        return ret;
+    }
+
+    // the assets are loaded once and shared copy-on-write with every worker,
+    // a file changed later is loaded again by each worker on its own
+    pid_t pid[workers];
+    for (int i = 0; i < workers; i++)
+    {
+        pid[i] = fork();
+        if (pid[i] == 0)
+        {
+            if (metricsPath != NULL)
+            {
+                snprintf(path, sizeof(path), "%s.%d", metricsPath, i);
+                metrics_init(path);
+            }
+            int ret = serverWorker(address, spectate, i);
+            metrics_close();
+            exit(ret);
+        }
+    }
+
+    while (running)
+    {
+        int status;
+        pid_t done = wait(&status);
+        if (done < 0 && errno == ECHILD)
+        {
+            break;
+        }
+    }
+    for (int i = 0; i < workers; i++)
+    {
+        if (pid[i] > 0)
+        {
+            kill(pid[i], SIGTERM);
+        }
+    }
+    while (wait(NULL) > 0);
+
+    return 0;
+}
+//**************************************************************************************
+#endif
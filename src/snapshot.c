@@ -0,0 +1,504 @@
+/*******************************************************************************
+* @filename: snapshot.c
+* @brief: Game snapshots, the whole state of a running game packed in a small
+*         versioned binary blob to save, resume or fork it
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "include/snapshot.h"
+#include <stddef.h>
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// Snapshot being written or read
+typedef struct SnapshotBuffer
+{
+    uint8_t *data;
+    int size, len;
+    bool valid; // false once it ran out of room or of data
+    uint64_t now; // times are kept relative to it
+} SNAPSHOT_BUFFER;
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Write a number, seven bits per byte, small magnitudes take one byte
+ * @retval None
+ */
+static void snapshot_put(SNAPSHOT_BUFFER *buf, int64_t value)
+{
+    // zigzag, the sign goes to the lowest bit
+    uint64_t bits = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+
+    do
+    {
+        if (buf->len == buf->size)
+        {
+            buf->valid = false;
+            return;
+        }
+        buf->data[buf->len++] = (uint8_t) ((bits & 0x7F) | ((bits > 0x7F) ? 0x80 : 0));
+        bits >>= 7;
+    } while (bits != 0);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read a number written by snapshot_put()
+ * @retval The number, zero past the end
+ */
+static int64_t snapshot_get(SNAPSHOT_BUFFER *buf)
+{
+    uint64_t bits = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        if (buf->len == buf->size || shift > 63)
+        {
+            buf->valid = false;
+            return 0;
+        }
+        byte = buf->data[buf->len++];
+        bits |= (uint64_t) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return (int64_t) (bits >> 1) ^ -(int64_t) (bits & 1);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write flags as one bit mask
+ * @retval None
+ */
+static void snapshot_put_flags(SNAPSHOT_BUFFER *buf, const bool flag[], int count)
+{
+    uint64_t mask = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        mask |= (uint64_t) flag[i] << i;
+    }
+    snapshot_put(buf, (int64_t) mask);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read flags written by snapshot_put_flags()
+ * @retval None
+ */
+static void snapshot_get_flags(SNAPSHOT_BUFFER *buf, bool flag[], int count)
+{
+    uint64_t mask = (uint64_t) snapshot_get(buf);
+
+    for (int i = 0; i < count; i++)
+    {
+        flag[i] = (mask >> i) & 1;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write or read an int array
+ * @retval None
+ */
+static void snapshot_put_ints(SNAPSHOT_BUFFER *buf, const int value[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        snapshot_put(buf, value[i]);
+    }
+}
+
+static void snapshot_get_ints(SNAPSHOT_BUFFER *buf, int value[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        value[i] = (int) snapshot_get(buf);
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write or read a time as its distance to the game time, it stays small
+ * @retval None
+ */
+static void snapshot_put_time(SNAPSHOT_BUFFER *buf, uint64_t time)
+{
+    snapshot_put(buf, (int64_t) (buf->now - time));
+}
+
+static uint64_t snapshot_get_time(SNAPSHOT_BUFFER *buf)
+{
+    return buf->now - (uint64_t) snapshot_get(buf);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Pack the state of a game
+ * @param  data: where the snapshot goes, SNAPSHOT_MAX_SIZE always fits
+ * @retval Snapshot length, zero if it didn't fit
+ * @note   The frame layer and the preset the delays are tuned from aren't saved,
+ *         redraw the game after loading it, see gameRedraw()
+ */
+int snapshot_save(const GAME *game, uint8_t *data, int size)
+{
+    SNAPSHOT_BUFFER buf = {data, size, 0, true, game->now};
+    const PLAYER *player = &game->player;
+    const PRESETS *preset = &game->preset;
+    const ARCHER *archer = &game->archer;
+    const ARROW *arrow = &game->arrow;
+    const BALLOON *balloon = &game->balloon;
+    const MONSTER *monster = &game->monster;
+    int nameLen = strnlen(player->name, HIGHSCORES_MAX_PLAYER_NAME);
+
+    if (size < SNAPSHOT_MAGIC_LEN + 1)
+    {
+        return 0;
+    }
+    memcpy(buf.data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    buf.data[SNAPSHOT_MAGIC_LEN] = SNAPSHOT_VERSION;
+    buf.len = SNAPSHOT_MAGIC_LEN + 1;
+
+    snapshot_put(&buf, (int64_t) game->now);
+    snapshot_put(&buf, game->random);
+    snapshot_put(&buf, game->nBalloonLevel);
+    snapshot_put(&buf, game->nMonsterLevel);
+    snapshot_put(&buf, game->nBalloonScatteredLevel);
+
+    // player
+    snapshot_put(&buf, nameLen);
+    for (int i = 0; i < nameLen; i++)
+    {
+        snapshot_put(&buf, (uint8_t) player->name[i]);
+    }
+    snapshot_put(&buf, player->score);
+    snapshot_put(&buf, player->difficulty);
+    snapshot_put(&buf, player->theme);
+    snapshot_put(&buf, player->level);
+    snapshot_put(&buf, player->gameOver | (player->levelOver << 1));
+    snapshot_put(&buf, player->arrowsLeft);
+    snapshot_put(&buf, player->balloonsDestroyed);
+    snapshot_put(&buf, player->monstersKilled);
+
+    // preset
+    snapshot_put(&buf, preset->levelType);
+    snapshot_put(&buf, preset->arrowQuantity);
+    snapshot_put(&buf, preset->arrowStaggerDelay);
+    snapshot_put(&buf, preset->arrowHitDelay);
+    snapshot_put(&buf, preset->arrowConsumableArrows);
+    snapshot_put(&buf, preset->archerHitDelay);
+    snapshot_put(&buf, preset->balloonInitialX);
+    snapshot_put(&buf, preset->balloonStaggerDelay);
+    snapshot_put(&buf, preset->balloonScatteredDelayMax);
+    snapshot_put(&buf, preset->balloonScatteredDelayMin);
+    snapshot_put(&buf, preset->monsterStaggerDelay);
+    snapshot_put(&buf, preset->monsterSpawnDelay);
+
+    // archer
+    snapshot_put(&buf, archer->active | (archer->keyHitLimit << 1));
+    snapshot_put(&buf, archer->x);
+    snapshot_put(&buf, archer->y);
+    snapshot_put_time(&buf, archer->startTimeKeyHitLimit);
+
+    // arrows
+    snapshot_put_flags(&buf, arrow->active, MAX_ARROW_QUANTITY);
+    snapshot_put(&buf, arrow->stagger | (arrow->keyHitLimit << 1));
+    snapshot_put_ints(&buf, arrow->x, MAX_ARROW_QUANTITY);
+    snapshot_put_ints(&buf, arrow->y, MAX_ARROW_QUANTITY);
+    snapshot_put(&buf, arrow->index);
+    snapshot_put(&buf, arrow->activeIndex);
+    snapshot_put_time(&buf, arrow->startTimeStagger);
+    snapshot_put_time(&buf, arrow->startTimeKeyHitLimit);
+
+    // balloons
+    snapshot_put_flags(&buf, balloon->active, BALLOON_QUANTITY);
+    snapshot_put(&buf, balloon->stagger);
+    snapshot_put_flags(&buf, balloon->individualStagger, BALLOON_QUANTITY);
+    snapshot_put_ints(&buf, balloon->x, BALLOON_QUANTITY);
+    snapshot_put_ints(&buf, balloon->y, BALLOON_QUANTITY);
+    snapshot_put(&buf, balloon->activeIndex);
+    snapshot_put_ints(&buf, balloon->IndividualDelay, BALLOON_QUANTITY);
+    snapshot_put_time(&buf, balloon->startTimeStagger);
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        snapshot_put_time(&buf, balloon->startTimeIndividualStagger[i]);
+    }
+
+    // monsters
+    snapshot_put_flags(&buf, monster->active, MONSTER_QUANTITY);
+    snapshot_put(&buf, monster->stagger | (monster->spawn << 1));
+    snapshot_put_ints(&buf, monster->x, MONSTER_QUANTITY);
+    snapshot_put_ints(&buf, monster->y, MONSTER_QUANTITY);
+    snapshot_put(&buf, monster->index);
+    snapshot_put(&buf, monster->activeIndex);
+    snapshot_put_time(&buf, monster->startTimeStagger);
+    snapshot_put_time(&buf, monster->startTimeSpawn);
+
+    return buf.valid ? buf.len : 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check a delay read from a snapshot
+ * @retval True if it's a delay the game can run with
+ */
+static bool snapshot_valid_delay(int delay)
+{
+    return delay >= 0 && delay <= SNAPSHOT_MAX_DELAY;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check the preset read from a snapshot, the arrays and the canvas
+ *         are indexed with its quantities
+ * @retval True if the game can run with it
+ */
+static bool snapshot_valid_preset(const PRESETS *preset)
+{
+    return (preset->levelType == balloonLevel || preset->levelType == monsterLevel ||
+            preset->levelType == balloonScatteredLevel) &&
+           preset->arrowQuantity >= 1 && preset->arrowQuantity <= MAX_ARROW_QUANTITY &&
+           preset->balloonInitialX >= 0 && preset->balloonInitialX < CANVAS_ROWS &&
+           snapshot_valid_delay(preset->arrowStaggerDelay) && snapshot_valid_delay(preset->arrowHitDelay) &&
+           snapshot_valid_delay(preset->archerHitDelay) && snapshot_valid_delay(preset->balloonStaggerDelay) &&
+           snapshot_valid_delay(preset->balloonScatteredDelayMax) && snapshot_valid_delay(preset->balloonScatteredDelayMin) &&
+           snapshot_valid_delay(preset->monsterStaggerDelay) && snapshot_valid_delay(preset->monsterSpawnDelay);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Restore a game from a snapshot
+ * @retval True if success, the game is left untouched otherwise
+ * @note   The game time goes back to the snapshot time, the layer and the preset
+ *         the delays are tuned from are kept, the debris is cleared. Safe to
+ *         call from several threads on different games
+ */
+bool snapshot_load(GAME *game, const uint8_t *data, int len)
+{
+    SNAPSHOT_BUFFER buf = {(uint8_t *) data, len, SNAPSHOT_MAGIC_LEN + 1, true, 0};
+    // only the state before the layer is read into it
+    GAME next;
+    PLAYER *player = &next.player;
+    PRESETS *preset = &next.preset;
+    ARCHER *archer = &next.archer;
+    ARROW *arrow = &next.arrow;
+    BALLOON *balloon = &next.balloon;
+    MONSTER *monster = &next.monster;
+    int nameLen, flags;
+
+    if (len < SNAPSHOT_MAGIC_LEN + 1 || memcmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0 ||
+        data[SNAPSHOT_MAGIC_LEN] != SNAPSHOT_VERSION)
+    {
+        return false;
+    }
+    // the fields not in the snapshot stay as they are
+    memcpy(&next, game, offsetof(GAME, layer));
+
+    next.now = buf.now = (uint64_t) snapshot_get(&buf);
+    next.random = (uint32_t) snapshot_get(&buf);
+    next.nBalloonLevel = (int) snapshot_get(&buf);
+    next.nMonsterLevel = (int) snapshot_get(&buf);
+    next.nBalloonScatteredLevel = (int) snapshot_get(&buf);
+
+    // player
+    nameLen = (int) snapshot_get(&buf);
+    if (nameLen < 0 || nameLen > HIGHSCORES_MAX_PLAYER_NAME)
+    {
+        return false;
+    }
+    memset(player->name, 0, sizeof(player->name));
+    for (int i = 0; i < nameLen; i++)
+    {
+        player->name[i] = (char) snapshot_get(&buf);
+    }
+    player->score = (int) snapshot_get(&buf);
+    player->difficulty = (enum difficulty) snapshot_get(&buf);
+    player->theme = (enum theme) snapshot_get(&buf);
+    player->level = (int) snapshot_get(&buf);
+    flags = (int) snapshot_get(&buf);
+    player->gameOver = flags & 1;
+    player->levelOver = (flags >> 1) & 1;
+    player->arrowsLeft = (int) snapshot_get(&buf);
+    player->balloonsDestroyed = (int) snapshot_get(&buf);
+    player->monstersKilled = (int) snapshot_get(&buf);
+
+    // preset
+    preset->levelType = (enum levelType) snapshot_get(&buf);
+    preset->arrowQuantity = (short) snapshot_get(&buf);
+    preset->arrowStaggerDelay = (short) snapshot_get(&buf);
+    preset->arrowHitDelay = (short) snapshot_get(&buf);
+    preset->arrowConsumableArrows = snapshot_get(&buf) != 0;
+    preset->archerHitDelay = (short) snapshot_get(&buf);
+    preset->balloonInitialX = (short) snapshot_get(&buf);
+    preset->balloonStaggerDelay = (short) snapshot_get(&buf);
+    preset->balloonScatteredDelayMax = (short) snapshot_get(&buf);
+    preset->balloonScatteredDelayMin = (short) snapshot_get(&buf);
+    preset->monsterStaggerDelay = (short) snapshot_get(&buf);
+    preset->monsterSpawnDelay = (short) snapshot_get(&buf);
+
+    // archer
+    flags = (int) snapshot_get(&buf);
+    archer->active = flags & 1;
+    archer->keyHitLimit = (flags >> 1) & 1;
+    archer->x = (int) snapshot_get(&buf);
+    archer->y = (int) snapshot_get(&buf);
+    archer->startTimeKeyHitLimit = snapshot_get_time(&buf);
+
+    // arrows
+    snapshot_get_flags(&buf, arrow->active, MAX_ARROW_QUANTITY);
+    flags = (int) snapshot_get(&buf);
+    arrow->stagger = flags & 1;
+    arrow->keyHitLimit = (flags >> 1) & 1;
+    snapshot_get_ints(&buf, arrow->x, MAX_ARROW_QUANTITY);
+    snapshot_get_ints(&buf, arrow->y, MAX_ARROW_QUANTITY);
+    arrow->index = (int) snapshot_get(&buf);
+    arrow->activeIndex = (int) snapshot_get(&buf);
+    arrow->startTimeStagger = snapshot_get_time(&buf);
+    arrow->startTimeKeyHitLimit = snapshot_get_time(&buf);
+
+    // balloons
+    snapshot_get_flags(&buf, balloon->active, BALLOON_QUANTITY);
+    balloon->stagger = snapshot_get(&buf) != 0;
+    snapshot_get_flags(&buf, balloon->individualStagger, BALLOON_QUANTITY);
+    snapshot_get_ints(&buf, balloon->x, BALLOON_QUANTITY);
+    snapshot_get_ints(&buf, balloon->y, BALLOON_QUANTITY);
+    balloon->activeIndex = (int) snapshot_get(&buf);
+    snapshot_get_ints(&buf, balloon->IndividualDelay, BALLOON_QUANTITY);
+    balloon->startTimeStagger = snapshot_get_time(&buf);
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        balloon->startTimeIndividualStagger[i] = snapshot_get_time(&buf);
+    }
+
+    // monsters
+    snapshot_get_flags(&buf, monster->active, MONSTER_QUANTITY);
+    flags = (int) snapshot_get(&buf);
+    monster->stagger = flags & 1;
+    monster->spawn = (flags >> 1) & 1;
+    snapshot_get_ints(&buf, monster->x, MONSTER_QUANTITY);
+    snapshot_get_ints(&buf, monster->y, MONSTER_QUANTITY);
+    monster->index = (int) snapshot_get(&buf);
+    monster->activeIndex = (int) snapshot_get(&buf);
+    monster->startTimeStagger = snapshot_get_time(&buf);
+    monster->startTimeSpawn = snapshot_get_time(&buf);
+
+    // a damaged snapshot must not place entities out of the canvas, the
+    // indexes count the entities placed so far and may reach the quantity
+    if (!buf.valid || buf.len != len || player->level < 1 || player->level > MAX_LEVEL ||
+        (unsigned) player->difficulty > hard || (unsigned) player->theme > matrix ||
+        archer->x < ARCHER_UPPER_LIMIT - 1 || archer->x > ARCHER_LOWER_LIMIT || archer->y != ARCHER_INITIAL_Y ||
+        !snapshot_valid_preset(preset) ||
+        arrow->index < 0 || arrow->index > preset->arrowQuantity ||
+        arrow->activeIndex < 0 || arrow->activeIndex > arrow->index ||
+        balloon->activeIndex < 0 || balloon->activeIndex > BALLOON_QUANTITY ||
+        monster->index < 0 || monster->index > MONSTER_QUANTITY ||
+        monster->activeIndex < 0 || monster->activeIndex > monster->index)
+    {
+        return false;
+    }
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        if (!snapshot_valid_delay(balloon->IndividualDelay[i]))
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < MAX_ARROW_QUANTITY; i++)
+    {
+        if (arrow->active[i] && (arrow->x[i] < 0 || arrow->x[i] >= CANVAS_ROWS ||
+                                 arrow->y[i] < 0 || arrow->y[i] + ARROW_COLUMNS > CANVAS_COLUMNS))
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < BALLOON_QUANTITY; i++)
+    {
+        if (balloon->y[i] < 0 || balloon->y[i] + BALLOON_COLUMNS > CANVAS_COLUMNS ||
+            balloon->x[i] < -BALLOON_ROWS || balloon->x[i] >= CANVAS_ROWS)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < MONSTER_QUANTITY; i++)
+    {
+        if (monster->x[i] < 0 || monster->x[i] + MONSTER_ROWS > CANVAS_ROWS ||
+            monster->y[i] < -MONSTER_COLUMNS || monster->y[i] > CANVAS_COLUMNS)
+        {
+            return false;
+        }
+    }
+
+    memcpy(game, &next, offsetof(GAME, layer));
+    // debris of the game replaced, the redraw clears it from the screen
+    game->particle.count = 0;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Save a game to a file
+ * @retval True if success
+ */
+bool snapshot_write(const GAME *game, const char *path)
+{
+    uint8_t data[SNAPSHOT_MAX_SIZE];
+    int len = snapshot_save(game, data, sizeof(data));
+    FILE *file;
+    bool written;
+
+    if (len == 0)
+    {
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    written = fwrite(data, 1, len, file) == (size_t) len;
+    return (fclose(file) == 0) && written;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Load a game saved with snapshot_write()
+ * @retval True if success, the game is left untouched otherwise
+ */
+bool snapshot_read(GAME *game, const char *path)
+{
+    uint8_t data[SNAPSHOT_MAX_SIZE];
+    FILE *file = fopen(path, "rb");
+    int len;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    len = (int) fread(data, 1, sizeof(data), file);
+    fclose(file);
+    return snapshot_load(game, data, len);
+}
+//**************************************************************************************
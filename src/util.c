@@ -57,21 +57,25 @@ char *get_timeinfo(time_t timestamp)
 
 /**
  * @brief  Get user string input from keyboard
+ * @param  ch: key pressed, zero when the blink timer expired
  * @param  input_layer: screen layer to print over the background
  * @param  str_buffer: buffer to store the input string
  * @param  max_str_len: maximum input string length
  * @retval string length when input confirmed, -1 when input canceled and -2 otherwise
+ * @note   The caller waits for a key at most KEYBOARD_BLINK_INTERVAL, the cursor
+ *         blinks on each timeout and stays shown while typing
  */
-int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len)
+int get_keyboard_str(int ch, char *input_layer, char *str_buffer, int max_str_len)
 {
     static int str_len = 0, blink_latch = 0;
-    static uint64_t blink_timer = 0;
-
-    int ch = 0;
-    if(kbhit()){
-        // Read a key form keyboard
-        ch = get_char();
 
+    if (ch == 0)
+    {
+        blink_latch = !blink_latch;
+    }
+    else
+    {
+        blink_latch = 1;
         switch(ch)
         {
             // Cancel input
@@ -108,11 +112,6 @@ int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len)
     if (input_layer != NULL && str_buffer != NULL)
     {
         memcpy(input_layer, str_buffer, str_len);
-        if ( time_diff(blink_timer) >= 500 )
-        {
-            blink_timer = get_clock();
-            blink_latch = !blink_latch;
-        }
         if (blink_latch)
         {
             memcpy(input_layer + str_len, "_", 1);
@@ -126,23 +125,19 @@ int get_keyboard_str(char *input_layer, char *str_buffer, int max_str_len)
 
 /**
  * @brief  Get time in microseconds
- * @retval The wall-clock time in microseconds
+ * @retval The monotonic time in microseconds, unaffected by clock adjustments
  */
 long long get_clock()
 {
-    //The epoch used by FILETIME starts from January 1, 1601
-    FILETIME ft;
-    ULARGE_INTEGER ui;
-
-    // Get the current system time as a FILETIME
-    GetSystemTimeAsFileTime(&ft);
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
 
-    // Convert FILETIME to ULARGE_INTEGER
-    ui.LowPart = ft.dwLowDateTime;
-    ui.HighPart = ft.dwHighDateTime;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
 
-    // Convert to microseconds (1 tick = 100 nanoseconds)
-    return  (long long) (ui.QuadPart / 10);
+    // Split before scaling so the product does not overflow
+    return (long long) ((counter.QuadPart / frequency.QuadPart) * 1000000LL +
+                        (counter.QuadPart % frequency.QuadPart) * 1000000LL / frequency.QuadPart);
 }
 //**************************************************************************************
 
@@ -150,13 +145,15 @@ long long get_clock()
  * @brief  Move terminal cursor
  * @param  x: row number
  * @param  y: column number
+ * @retval Zero, the console API writes no bytes
  */
-void gotoxy(int x, int y)
+int gotoxy(int x, int y)
 {
     COORD coord = {0, 0};
     coord.X = y;
     coord.Y = x;
     SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
+    return 0;
 }
 //****************************************************************************************
 
@@ -181,6 +178,25 @@ char get_char()
 }
 //****************************************************************************************
 
+/**
+ * @brief  Wait for a key
+ * @param  timeout_ms: longest wait, negative to wait forever
+ * @param  fds: ignored, the console can't wait on descriptors
+ * @retval True if a key was pressed
+ */
+int wait_input(int timeout_ms, const int fds[], int count)
+{
+    (void) fds;
+    (void) count;
+    if (WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE), (timeout_ms < 0) ? INFINITE : (DWORD) timeout_ms) != WAIT_OBJECT_0)
+    {
+        return 0;
+    }
+    // mouse and focus events wake the wait too
+    return _kbhit();
+}
+//****************************************************************************************
+
 /**
  * @brief  Dummy function
  * @retval None
@@ -207,12 +223,12 @@ char get_char()
 
 /**
  * @brief  Get time in microseconds
- * @retval The wall-clock time in microseconds
+ * @retval The monotonic time in microseconds, unaffected by clock adjustments
  */
 long long get_clock()
 {
     struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
     return (long long) ((ts.tv_sec * 1000000LL) + (ts.tv_nsec / 1000));
 }
 //**************************************************************************************
@@ -221,10 +237,11 @@ long long get_clock()
  * @brief  Move terminal cursor
  * @param  x: row number
  * @param  y: column number
+ * @retval The number of bytes written
  */
-void gotoxy(int x, int y)
+int gotoxy(int x, int y)
 {
-    printf("\033[%d;%dH",x+1, y+1);
+    return printf("\033[%d;%dH",x+1, y+1);
 }
 //****************************************************************************************
 
@@ -264,6 +281,44 @@ int kbhit()
 }
 //****************************************************************************************
 
+/**
+ * @brief  Wait for a key or for other descriptors, without using the CPU
+ * @param  timeout_ms: longest wait, negative to wait forever
+ * @param  fds: other descriptors that end the wait when readable
+ * @param  count: number of descriptors in fds
+ * @retval True if a key was pressed, false if the time is over or another
+ *         descriptor is readable
+ */
+int wait_input(int timeout_ms, const int fds[], int count)
+{
+    struct timeval tv, *timeout = NULL;
+    fd_set set;
+    int max = STDIN_FILENO;
+
+    FD_ZERO(&set);
+    FD_SET(STDIN_FILENO, &set);
+    for (int i = 0; i < count; i++)
+    {
+        FD_SET(fds[i], &set);
+        if (fds[i] > max)
+        {
+            max = fds[i];
+        }
+    }
+    if (timeout_ms >= 0)
+    {
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        timeout = &tv;
+    }
+    if (select(max + 1, &set, NULL, NULL, timeout) <= 0)
+    {
+        return 0;
+    }
+    return FD_ISSET(STDIN_FILENO, &set);
+}
+//****************************************************************************************
+
 /**
  * @brief  Set non-blocking terminal input and disable echo mode
  * @param  state: enable or disable
@@ -0,0 +1,212 @@
+/*******************************************************************************
+* @filename: artc.c
+* @brief: ASCII Art compiler, checks every art file against the size the game
+*         declares for it and writes the cells and the UTF-8 glyphs as C data
+*         compiled into the binary
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "assets.h"
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Largest asset
+#define ARTC_MAX_CELLS 4096
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// where an asset comes from and its size, from ASSET_LIST
+typedef struct ArtFile
+{
+    const char *name; // enum assetType value
+    int rows, columns;
+    const char *file;
+} ARTFILE;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+// the art destination is the game's, only the size and the file are used here
+#define ARTC_ENTRY(asset, art, rows, columns, file) [asset] = {#asset, rows, columns, file},
+static const ARTFILE artFiles[assetCount] =
+{
+    ASSET_LIST(ARTC_ENTRY)
+};
+#undef ARTC_ENTRY
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Write bytes as a C string literal
+ * @retval None
+ */
+static void writeString(FILE *out, const char *data, int len)
+{
+    fputc('"', out);
+    for (int i = 0; i < len; i++)
+    {
+        unsigned char ch = data[i];
+        if (ch == '"' || ch == '\\' || ch == '?')
+        {
+            // '?' too, it could start a trigraph
+            fprintf(out, "\\%c", ch);
+        }
+        else if (ch >= ' ' && ch < 0x7F)
+        {
+            fputc(ch, out);
+        }
+        else
+        {
+            // always three digits, the next character can't extend it
+            fprintf(out, "\\%03o", ch);
+        }
+    }
+    fputc('"', out);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read and check one art file
+ * @param  glyphs: glyphs of the files read so far, the new ones are added
+ * @param  cells: rows * columns glyph IDs read
+ * @retval True if the file has the declared size
+ */
+static bool readArt(const char *dir, const ARTFILE *art, GLYPH_SCRATCH *glyphs, char cells[])
+{
+    char path[256];
+    FILE *file;
+    char *text;
+    long size;
+    int line = 1;
+    bool valid;
+
+    snprintf(path, sizeof(path), "%s%s%s.txt", dir, FILE_SEPARATOR, art->file);
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "artc: can't open %s\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+    text = malloc((size > 0) ? size : 1);
+    size = (text != NULL && size > 0) ? (long) fread(text, sizeof(char), size, file) : 0;
+    fclose(file);
+
+    valid = (text != NULL) && glyph_decode_art(glyphs, text, size, cells, art->rows, art->columns, &line);
+    free(text);
+    if (!valid)
+    {
+        fprintf(stderr, "%s:%d: art must be %d rows of %d columns\n", path, line, art->rows, art->columns);
+    }
+    return valid;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Compile the art directory into a C file
+ * @retval Zero if every file is valid
+ */
+int main(int argc, char *argv[])
+{
+    const char *dir = (argc > 2) ? argv[2] : ART_DIR_DEFAULT;
+    static char cells[assetCount][ARTC_MAX_CELLS];
+    static GLYPH_SCRATCH glyphs;
+    int nGlyphs;
+    FILE *out;
+
+    if (argc < 2)
+    {
+        printf("Usage: %s output.c [art directory]\n", argv[0]);
+        return 1;
+    }
+
+    // the IDs are shared by every file
+    glyph_scratch(&glyphs);
+    for (int i = 0; i < assetCount; i++)
+    {
+        if (artFiles[i].file == NULL || artFiles[i].rows * artFiles[i].columns > ARTC_MAX_CELLS)
+        {
+            fprintf(stderr, "artc: asset %d has no file or is too big\n", i);
+            return 1;
+        }
+        if (!readArt(dir, &artFiles[i], &glyphs, cells[i]))
+        {
+            return 1;
+        }
+    }
+    nGlyphs = glyphs.count;
+
+    out = fopen(argv[1], "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "artc: can't write %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by tools/artc.c from %s, do not edit\n", dir);
+    fprintf(out, "#include \"include/assets.h\"\n\n");
+
+    // the IDs in the cells point into this table
+    fprintf(out, "const int artGlyphCount = %d;\n", nGlyphs);
+    fprintf(out, "const GLYPH artGlyphs[] =\n{\n");
+    for (int i = 0; i < nGlyphs; i++)
+    {
+        GLYPH *glyph = &glyphs.glyph[GLYPH_FIRST_EXTENDED + i];
+        fprintf(out, "    {");
+        writeString(out, glyph->bytes, glyph->len);
+        fprintf(out, ", %d, %d},\n", glyph->len, glyph->width);
+    }
+    if (nGlyphs == 0)
+    {
+        fprintf(out, "    {\"\", 0, 0}\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "const char *const artCells[assetCount] =\n{\n");
+    for (int i = 0; i < assetCount; i++)
+    {
+        const ARTFILE *art = &artFiles[i];
+        fprintf(out, "    // %s.txt\n", art->file);
+        fprintf(out, "    [%s] =\n", art->name);
+        for (int row = 0; row < art->rows; row++)
+        {
+            fprintf(out, "        ");
+            writeString(out, &cells[i][row * art->columns], art->columns);
+            fprintf(out, "%s\n", (row == art->rows - 1) ? "," : "");
+        }
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out) != 0)
+    {
+        fprintf(stderr, "artc: can't write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+//**************************************************************************************
@@ -0,0 +1,734 @@
+/*******************************************************************************
+* @filename: perfgate.c
+* @brief: Performance regression gate, runs the simulation and the replay
+*         benchmarks several times and compares their medians with a committed
+*         baseline
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "replay.h"
+#include "pilot.h"
+#include <math.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Limits
+#define PERF_MAX_RUNS 64
+#define PERF_MAX_BASELINE 64
+
+// Recorded games of a workload, one per difficulty
+#define PERF_GAMES 3
+
+// Times the simulation plays the games in one run, a run takes about a second
+#define PERF_SIM_REPEAT 10
+
+// Hits thrown at the particle pool each tick by the particle workload
+#define PERF_PARTICLE_BURSTS 100
+
+// The lookahead workload plans every plan at a few points of each game
+#define PERF_LOOKAHEAD_EVERY 3000 // ticks
+#define PERF_LOOKAHEAD_POINTS 3
+
+// Standard deviation of a normal sample from its median absolute deviation
+#define PERF_MAD_SIGMA 1.4826
+
+// A change is a regression only past this many standard deviations
+#define PERF_NOISE_K 2.0
+
+// A noisy baseline never lets a change worse than this pass
+#define PERF_MAX_LIMIT 0.15
+
+// Longest host name kept
+#define PERF_HOST_SIZE 64
+
+// Baseline one run of the base gate writes, see --base
+#define PERF_BASE_RUN_FILE "perfgate.base.run"
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// how a workload is measured
+enum workloadKind
+{
+    workloadSim,       // env_step() in this process, game logic only
+    workloadParticles, // the same with a hundred hits each tick
+    workloadSkip,      // replay_play(), the idle ticks skipped
+    workloadLookahead, // pilot_evaluate() of every plan, the autopilot search
+    workloadReplay     // ./main --replay, game logic and drawing
+};
+
+// measures compared with the baseline
+enum measure
+{
+    measureTicks,
+    measureFrameTime,
+    measureBytes,
+    N_MEASURES
+};
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// A measure and how much it may get worse
+typedef struct Measure
+{
+    const char *name;
+    bool higherBetter;
+    bool hostBound;  // depends on the machine, compared only on the host it was measured on
+    double minLimit; // smallest relative change reported as a regression
+} MEASURE;
+
+// A fixed benchmark, the corpus games that start on one level type
+typedef struct Workload
+{
+    const char *name;
+    enum workloadKind kind;
+    int level;
+} WORKLOAD;
+
+// One baseline line
+typedef struct Baseline
+{
+    char workload[32], measure[32];
+    double median, sigma;
+} BASELINE;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+static const MEASURE measures[N_MEASURES] =
+{
+    [measureTicks]     = {"ticks/s", true, true, 0.05},
+    [measureFrameTime] = {"us/frame", false, true, 0.05},
+    // the output is deterministic, any growth is real on any machine
+    [measureBytes]     = {"bytes/frame", false, false, 0.001}
+};
+
+static const WORKLOAD workloads[] =
+{
+    {"sim.balloons", workloadSim, balloonLevel},
+    {"sim.monsters", workloadSim, monsterLevel},
+    {"sim.scattered", workloadSim, balloonScatteredLevel},
+    {"sim.particles", workloadParticles, balloonLevel},
+    {"sim.fastforward", workloadSkip, balloonLevel},
+    {"sim.lookahead", workloadLookahead, monsterLevel},
+    {"replay.balloons", workloadReplay, balloonLevel},
+    {"replay.monsters", workloadReplay, monsterLevel},
+    {"replay.scattered", workloadReplay, balloonScatteredLevel}
+};
+#define N_WORKLOADS ((int) (sizeof(workloads) / sizeof(workloads[0])))
+
+static const char *difficultyName[PERF_GAMES] = {"easy", "normal", "hard"};
+
+// Options
+static int nRuns = 5;
+static const char *mainPath = "./main";
+static const char *corpusDir = "corpus";
+static const char *baselinePath = "tools" FILE_SEPARATOR "perfgate.baseline";
+static const char *baseDir = NULL;
+
+// samples[workload][measure][run], NAN when the workload has no such measure
+static double samples[N_WORKLOADS][N_MEASURES][PERF_MAX_RUNS];
+
+// the same measured by the base gate between the runs, see --base
+static double baseSamples[N_WORKLOADS][N_MEASURES][PERF_MAX_RUNS];
+
+static BASELINE baseline[PERF_MAX_BASELINE];
+static int nBaseline;
+
+// host the baseline was measured on, empty if it doesn't say
+static char baselineHost[PERF_HOST_SIZE];
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Order samples for the median
+ * @retval Comparison result
+ */
+static int perfCompare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Median of some samples
+ * @param  value: samples, sorted in place
+ * @retval The median
+ */
+static double perfMedian(double value[], int n)
+{
+    qsort(value, n, sizeof(double), perfCompare);
+    return (n % 2 == 1) ? value[n / 2] : (value[n / 2 - 1] + value[n / 2]) / 2;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Spread of some samples, robust to a few slow runs
+ * @retval Standard deviation estimated from the median absolute deviation
+ */
+static double perfSigma(const double value[], int n, double median)
+{
+    double deviation[PERF_MAX_RUNS];
+
+    for (int i = 0; i < n; i++)
+    {
+        deviation[i] = fabs(value[i] - median);
+    }
+    return PERF_MAD_SIGMA * perfMedian(deviation, n);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Path of a corpus game
+ * @retval None
+ */
+static void perfGamePath(char *path, int size, const WORKLOAD *workload, int game)
+{
+    snprintf(path, size, "%s%s%s-level%d.replay", corpusDir, FILE_SEPARATOR, difficultyName[game], workload->level);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the workload games with the game logic only
+ * @param  replay: the workload games
+ * @param  bursts: debris bursts thrown each tick, the pool caps their cost
+ * @retval Ticks per second
+ */
+static double perfSim(const REPLAY replay[PERF_GAMES], int bursts)
+{
+    static ENV env;
+    uint64_t ticks = 0, startTime = get_clock();
+
+    for (int g = 0; g < PERF_GAMES * PERF_SIM_REPEAT; g++)
+    {
+        int next = 0;
+        const REPLAY *game = &replay[g % PERF_GAMES];
+        replay_start(game, &env);
+        for (uint64_t tick = 0; tick < game->ticks && !env.done; tick++)
+        {
+            for (int b = 0; b < bursts; b++)
+            {
+                particleBurst(&env.game, CANVAS_MIDDLE_EDGE_X + 1 + (b % 27), 1 + ((b * 7) % 75),
+                              BALLOON_ROWS, BALLOON_COLUMNS, BALLOON_ATTR);
+            }
+            env_step(&env, replay_action(game, &next, tick));
+            // nothing draws the layer, clear it as a frame would
+            if (((tick + 1) * FPS_LIMIT) / 1000 != (tick * FPS_LIMIT) / 1000)
+            {
+                memset(env.game.layer, '\0', sizeof(env.game.layer));
+                memset(env.game.attr, 0, sizeof(env.game.attr));
+            }
+            ticks++;
+        }
+    }
+    return ticks * 1000 / time_diff(startTime);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the workload games with the game logic only, skipping the ticks
+ *         where nothing can change
+ * @param  replay: the workload games
+ * @retval Game ticks per second
+ */
+static double perfSkip(const REPLAY replay[PERF_GAMES])
+{
+    static ENV env;
+    uint64_t ticks = 0, startTime = get_clock();
+
+    for (int g = 0; g < PERF_GAMES * PERF_SIM_REPEAT; g++)
+    {
+        int next = 0;
+        const REPLAY *game = &replay[g % PERF_GAMES];
+        replay_start(game, &env);
+        replay_play(game, &env, &next, game->ticks);
+        ticks += env.steps;
+    }
+    return ticks * 1000 / time_diff(startTime);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play every autopilot plan ahead at a few points of the workload games
+ * @param  replay: the workload games
+ * @retval Ticks played ahead per second
+ */
+static double perfLookahead(const REPLAY replay[PERF_GAMES])
+{
+    static ENV env;
+    uint64_t ticks = 0, startTime = get_clock();
+
+    for (int g = 0; g < PERF_GAMES; g++)
+    {
+        int next = 0, points = 0;
+        const REPLAY *game = &replay[g];
+        replay_start(game, &env);
+        for (uint64_t tick = 0; tick < game->ticks && !env.done && points < PERF_LOOKAHEAD_POINTS; tick++)
+        {
+            env_step(&env, replay_action(game, &next, tick));
+            if ((tick + 1) % PERF_LOOKAHEAD_EVERY == 0)
+            {
+                for (int i = 0; i < PILOT_PLANS; i++)
+                {
+                    uint64_t planTicks;
+                    pilot_evaluate(&env.game, (PILOT_PLAN) {ARCHER_UPPER_LIMIT + i / 2, (i % 2) != 0}, &planTicks);
+                    ticks += planTicks;
+                }
+                points++;
+            }
+        }
+    }
+    return ticks * 1000 / time_diff(startTime);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the workload games with the game binary
+ * @param  result: the measures read from its summary
+ * @retval True if the binary ran
+ */
+static bool perfReplay(const WORKLOAD *workload, double result[N_MEASURES])
+{
+    char command[1024], line[256];
+    int len = snprintf(command, sizeof(command), "%s --replay", mainPath);
+    double bytes, usTick, usFrame;
+    bool valid = false;
+    FILE *pipe;
+
+    for (int g = 0; g < PERF_GAMES; g++)
+    {
+        len += snprintf(command + len, sizeof(command) - len, " ");
+        perfGamePath(command + len, sizeof(command) - len, workload, g);
+        len += strlen(command + len);
+    }
+    pipe = popen(command, "r");
+    if (pipe == NULL)
+    {
+        return false;
+    }
+    while (fgets(line, sizeof(line), pipe) != NULL)
+    {
+        if (sscanf(line, "%*d replay(s): %*u ticks, %*u frames, %lf bytes/frame in %*f ms, %lf us/tick, %lf us/frame",
+                   &bytes, &usTick, &usFrame) == 3)
+        {
+            valid = true;
+        }
+    }
+    if (pclose(pipe) != 0 || !valid || usTick <= 0)
+    {
+        return false;
+    }
+    result[measureTicks] = 1000000 / usTick;
+    result[measureFrameTime] = usFrame;
+    result[measureBytes] = bytes;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Name the machine the gate runs on
+ * @param  host: receives the name, empty if unknown
+ * @param  size: size of host
+ * @retval None
+ */
+static void perfHost(char *host, int size)
+{
+#ifdef _WIN32 // @windows
+    DWORD length = size;
+    if (!GetComputerNameA(host, &length))
+    {
+        host[0] = '\0';
+    }
+#else // @linux
+    if (gethostname(host, size) != 0)
+    {
+        host[0] = '\0';
+    }
+    host[size - 1] = '\0';
+#endif
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read a baseline file
+ * @param  path: the file, its lines replace the baseline read before
+ * @retval True if it was read
+ */
+static bool perfLoadBaseline(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    nBaseline = 0;
+    baselineHost[0] = '\0';
+    while (fgets(line, sizeof(line), file) != NULL && nBaseline < PERF_MAX_BASELINE)
+    {
+        BASELINE *b = &baseline[nBaseline];
+        if (sscanf(line, "# host %63s", baselineHost) == 1)
+        {
+            continue;
+        }
+        if (line[0] != '#' && sscanf(line, "%31s %31s %lf %lf", b->workload, b->measure, &b->median, &b->sigma) == 4)
+        {
+            nBaseline++;
+        }
+    }
+    fclose(file);
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Find a workload measure in the baseline
+ * @retval The baseline line, NULL if it has none
+ */
+static const BASELINE *perfFindBaseline(const char *workload, const char *measure)
+{
+    for (int i = 0; i < nBaseline; i++)
+    {
+        if (strcmp(baseline[i].workload, workload) == 0 && strcmp(baseline[i].measure, measure) == 0)
+        {
+            return &baseline[i];
+        }
+    }
+    return NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Run the gate of the base revision once and keep its measures
+ * @param  run: the run the measures are stored as
+ * @retval True if the base gate ran
+ */
+static bool perfBaseRun(int run)
+{
+    char command[1024], line[256];
+    FILE *pipe;
+
+    snprintf(command, sizeof(command), "%s%sperfgate --update --runs 1 --main %s%smain --corpus %s --baseline %s",
+             baseDir, FILE_SEPARATOR, baseDir, FILE_SEPARATOR, corpusDir, PERF_BASE_RUN_FILE);
+    pipe = popen(command, "r");
+    if (pipe == NULL)
+    {
+        return false;
+    }
+    while (fgets(line, sizeof(line), pipe) != NULL);
+    if (pclose(pipe) != 0 || !perfLoadBaseline(PERF_BASE_RUN_FILE))
+    {
+        return false;
+    }
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int m = 0; m < N_MEASURES; m++)
+        {
+            const BASELINE *b = perfFindBaseline(workloads[w].name, measures[m].name);
+            baseSamples[w][m][run] = (b == NULL) ? NAN : b->median;
+        }
+    }
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Turn the base gate measures into the baseline compared with
+ * @retval None
+ */
+static void perfBaseBaseline()
+{
+    nBaseline = 0;
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int m = 0; m < N_MEASURES; m++)
+        {
+            BASELINE *b = &baseline[nBaseline];
+            if (isnan(baseSamples[w][m][0]) || nBaseline >= PERF_MAX_BASELINE)
+            {
+                continue;
+            }
+            snprintf(b->workload, sizeof(b->workload), "%s", workloads[w].name);
+            snprintf(b->measure, sizeof(b->measure), "%s", measures[m].name);
+            b->median = perfMedian(baseSamples[w][m], nRuns);
+            b->sigma = perfSigma(baseSamples[w][m], nRuns, b->median);
+            nBaseline++;
+        }
+    }
+    remove(PERF_BASE_RUN_FILE);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Write the measured medians as the new baseline
+ * @retval True if success
+ */
+static bool perfSaveBaseline(double median[N_WORKLOADS][N_MEASURES], double sigma[N_WORKLOADS][N_MEASURES])
+{
+    FILE *file = fopen(baselinePath, "w");
+    char host[PERF_HOST_SIZE];
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    perfHost(host, sizeof(host));
+    fprintf(file, "# perfgate baseline, %d runs per workload, written by ./perfgate --update\n", nRuns);
+    if (host[0] != '\0')
+    {
+        fprintf(file, "# host %s\n", host);
+    }
+    fprintf(file, "# workload measure median sigma\n");
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int m = 0; m < N_MEASURES; m++)
+        {
+            if (!isnan(median[w][m]))
+            {
+                fprintf(file, "%s %s %.4f %.4f\n", workloads[w].name, measures[m].name, median[w][m], sigma[w][m]);
+            }
+        }
+    }
+    return fclose(file) == 0;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print the command line help
+ * @retval None
+ */
+static void perfUsage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "  --runs n         runs of each workload, the median is compared (%d)\n"
+           "  --main path      game binary played by the replay workloads (%s)\n"
+           "  --corpus dir     recorded games (%s)\n"
+           "  --baseline file  baseline compared with (%s)\n"
+           "  --base dir       compare with the gate and binary built in dir instead,\n"
+           "                   its runs taken between ours on this machine\n"
+           "  --update         write the measures as the new baseline\n",
+           name, nRuns, mainPath, corpusDir, baselinePath);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Gate entry
+ * @retval Zero if nothing got worse than the baseline
+ */
+int main(int argc, char *argv[])
+{
+    static REPLAY replay[N_WORKLOADS][PERF_GAMES];
+    double median[N_WORKLOADS][N_MEASURES], sigma[N_WORKLOADS][N_MEASURES];
+    char host[PERF_HOST_SIZE];
+    bool update = false, sameHost = true;
+    int regressions = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = (i + 1 < argc);
+
+        if (strcmp(argv[i], "--runs") == 0 && value) nRuns = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--main") == 0 && value) mainPath = argv[++i];
+        else if (strcmp(argv[i], "--corpus") == 0 && value) corpusDir = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && value) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--base") == 0 && value) baseDir = argv[++i];
+        else if (strcmp(argv[i], "--update") == 0) update = true;
+        else
+        {
+            perfUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (nRuns < 1) nRuns = 1;
+    if (nRuns > PERF_MAX_RUNS) nRuns = PERF_MAX_RUNS;
+
+    if (!update && baseDir == NULL && !perfLoadBaseline(baselinePath))
+    {
+        printf("No baseline in %s, run %s --update first\n", baselinePath, argv[0]);
+        return 1;
+    }
+
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int g = 0; g < PERF_GAMES; g++)
+        {
+            char path[256];
+            perfGamePath(path, sizeof(path), &workloads[w], g);
+            if (!replay_load(&replay[w][g], path))
+            {
+                printf("Invalid replay: %s\n", path);
+                return 1;
+            }
+        }
+    }
+
+    // the runs go round the workloads, with a run of the base gate before each
+    // one, a slow spell of the machine hits them all
+    printf("%d workload(s) x %d run(s)\n", N_WORKLOADS, nRuns);
+    fflush(stdout);
+    for (int r = 0; r < nRuns; r++)
+    {
+        if (baseDir != NULL && !update && !perfBaseRun(r))
+        {
+            printf("%s%sperfgate failed\n", baseDir, FILE_SEPARATOR);
+            return 1;
+        }
+        for (int w = 0; w < N_WORKLOADS; w++)
+        {
+            double result[N_MEASURES] = {NAN, NAN, NAN};
+
+            if (workloads[w].kind == workloadSim)
+            {
+                result[measureTicks] = perfSim(replay[w], 0);
+            }
+            else if (workloads[w].kind == workloadParticles)
+            {
+                result[measureTicks] = perfSim(replay[w], PERF_PARTICLE_BURSTS);
+            }
+            else if (workloads[w].kind == workloadSkip)
+            {
+                result[measureTicks] = perfSkip(replay[w]);
+            }
+            else if (workloads[w].kind == workloadLookahead)
+            {
+                result[measureTicks] = perfLookahead(replay[w]);
+            }
+            else if (!perfReplay(&workloads[w], result))
+            {
+                printf("%s: %s --replay failed\n", workloads[w].name, mainPath);
+                return 1;
+            }
+            for (int m = 0; m < N_MEASURES; m++)
+            {
+                samples[w][m][r] = result[m];
+            }
+        }
+    }
+
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int m = 0; m < N_MEASURES; m++)
+        {
+            median[w][m] = perfMedian(samples[w][m], nRuns);
+            sigma[w][m] = isnan(median[w][m]) ? NAN : perfSigma(samples[w][m], nRuns, median[w][m]);
+        }
+        for (int g = 0; g < PERF_GAMES; g++)
+        {
+            replay_free(&replay[w][g]);
+        }
+    }
+
+    if (update)
+    {
+        if (!perfSaveBaseline(median, sigma))
+        {
+            printf("Can't write %s\n", baselinePath);
+            return 1;
+        }
+        printf("Baseline written to %s\n", baselinePath);
+        return 0;
+    }
+
+    // timings measured on another machine say nothing about this change, only
+    // the deterministic measures are gated against them
+    if (baseDir != NULL)
+    {
+        perfBaseBaseline();
+        baselinePath = baseDir;
+    }
+    else
+    {
+        perfHost(host, sizeof(host));
+        sameHost = (baselineHost[0] != '\0' && strcmp(baselineHost, host) == 0);
+        if (!sameHost)
+        {
+            printf("%s was not measured on this host, timings are shown but not gated,\n"
+                   "use make perfcompare or a baseline written here with --update to gate them\n", baselinePath);
+        }
+    }
+
+    printf("%-18s %-12s %12s %12s %8s %8s\n", "workload", "measure", "baseline", "median", "change", "limit");
+    for (int w = 0; w < N_WORKLOADS; w++)
+    {
+        for (int m = 0; m < N_MEASURES; m++)
+        {
+            const BASELINE *b = perfFindBaseline(workloads[w].name, measures[m].name);
+            if (isnan(median[w][m]))
+            {
+                continue;
+            }
+            if (b == NULL || b->median <= 0)
+            {
+                printf("%-18s %-12s %12s %12.2f %8s %8s  new\n", workloads[w].name, measures[m].name, "-", median[w][m], "-", "-");
+                continue;
+            }
+
+            // the limit follows the noise of the baseline only, a noisy run
+            // must not widen the gate it is judged by
+            double change = (median[w][m] - b->median) / b->median;
+            double worse = measures[m].higherBetter ? -change : change;
+            double limit = PERF_NOISE_K * b->sigma / b->median;
+            const char *status = "ok";
+            bool gated = sameHost || !measures[m].hostBound;
+
+            if (limit > PERF_MAX_LIMIT)
+            {
+                limit = PERF_MAX_LIMIT;
+            }
+            if (limit < measures[m].minLimit)
+            {
+                limit = measures[m].minLimit;
+            }
+            if (!gated)
+            {
+                status = "other host";
+            }
+            else if (worse > limit)
+            {
+                status = "WORSE";
+                regressions++;
+            }
+            else if (-worse > limit)
+            {
+                status = "better";
+            }
+            printf("%-18s %-12s %12.2f %12.2f %+7.1f%% %7.1f%%  %s\n", workloads[w].name, measures[m].name,
+                   b->median, median[w][m], change * 100, limit * 100, status);
+        }
+    }
+
+    if (regressions > 0)
+    {
+        printf("%d regression(s) against %s\n", regressions, baselinePath);
+        return 1;
+    }
+    printf("No regressions against %s\n", baselinePath);
+    return 0;
+}
+//**************************************************************************************
@@ -0,0 +1,592 @@
+/*******************************************************************************
+* @filename: ptybench.c
+* @brief: End-to-end benchmark, runs the game inside a pseudo-terminal, types
+*         scripted keys and measures what reaches the screen
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "assets.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Terminal size the game asks for
+#define BENCH_ROWS 36
+#define BENCH_COLUMNS 82
+
+// Escape sequence parameters kept
+#define BENCH_MAX_PARAMS 8
+
+// Latency samples kept per phase
+#define BENCH_MAX_SAMPLES 4096
+
+// Give up on a screen change after this long
+#define BENCH_TIMEOUT 2000000 // us
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// escape sequence parser state
+enum parserState
+{
+    parserText,
+    parserEscape,
+    parserCsi,
+    parserOsc
+};
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// What the terminal shows, rebuilt from the output stream
+typedef struct Terminal
+{
+    char screen[BENCH_ROWS][BENCH_COLUMNS];
+    int row, column;
+    char last; // last printed glyph, repeated by REP
+    enum parserState state;
+    int param[BENCH_MAX_PARAMS], nParams;
+    char mark; // private marker like '?' or '>', '\0' if none
+} TERMINAL;
+
+// Samples of one measure
+typedef struct Samples
+{
+    double value[BENCH_MAX_SAMPLES];
+    int n;
+} SAMPLES;
+
+// Output bursts, a burst ends after a quiet gap and counts as one frame
+typedef struct Bursts
+{
+    int frames;
+    uint64_t bytes;
+    int64_t lastByte;
+} BURSTS;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+// run options
+static const char *binary = "./main";
+static int nKeys = 20;
+static int keyInterval = 150; // ms
+static double gameDuration = 3; // s
+static int quietGap = 1000; // us
+static int gameRate = 0; // bytes/s while playing, zero reads as fast as the game writes
+static int linkRate = 0; // bytes/s now
+static int64_t linkFree = 0; // us, when the slow link takes the next read
+
+static TERMINAL term;
+static BURSTS bursts;
+static int master = -1;
+static pid_t child = -1;
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Monotonic clock
+ * @retval Time in microseconds
+ */
+static int64_t benchNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print a glyph at the cursor
+ * @retval None
+ */
+static void terminalPut(char ch)
+{
+    // UTF-8 continuation bytes belong to the glyph already placed
+    if (((unsigned char) ch & 0xC0) == 0x80) return;
+
+    if (term.column >= BENCH_COLUMNS)
+    {
+        // pending wrap
+        term.column = 0;
+        if (term.row < BENCH_ROWS - 1) term.row++;
+    }
+    term.screen[term.row][term.column++] = ch;
+    term.last = ch;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Answer a query of the game, as a terminal types its replies
+ * @param  reply: bytes sent to the game input
+ * @retval False if the game is gone
+ */
+static bool benchReply(const char *reply)
+{
+    return write(master, reply, strlen(reply)) == (ssize_t) strlen(reply);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Apply a CSI sequence to the screen model
+ * @param  final: sequence final byte
+ * @retval None
+ */
+static void terminalCsi(char final)
+{
+    int n = (term.nParams > 0 && term.param[0] > 0) ? term.param[0] : 1;
+
+    switch (final)
+    {
+        case 'H': case 'f':
+            term.row = n - 1;
+            term.column = (term.nParams > 1 && term.param[1] > 0) ? term.param[1] - 1 : 0;
+            break;
+        case 'A': term.row -= n; break;
+        case 'B': term.row += n; break;
+        case 'C': term.column += n; break;
+        case 'D': term.column -= n; break;
+        case 'G': term.column = n - 1; break;
+        case 'd': term.row = n - 1; break;
+        case 'X':
+            for (int j = term.column; j < term.column + n && j < BENCH_COLUMNS; j++)
+            {
+                term.screen[term.row][j] = ' ';
+            }
+            break;
+        case 'b':
+            for (int i = 0; i < n; i++)
+            {
+                terminalPut(term.last);
+            }
+            break;
+        case 'K':
+        {
+            int mode = (term.nParams > 0) ? term.param[0] : 0;
+            int from = (mode == 0) ? term.column : 0;
+            int to = (mode == 1) ? term.column + 1 : BENCH_COLUMNS;
+            for (int j = from; j < to && j < BENCH_COLUMNS; j++)
+            {
+                term.screen[term.row][j] = ' ';
+            }
+        } break;
+        case 'J':
+            if (term.nParams > 0 && term.param[0] >= 2)
+            {
+                memset(term.screen, ' ', sizeof(term.screen));
+            }
+            break;
+        case 'c':
+            // the game asks what the terminal understands, answered as an
+            // xterm with ECH and REP and without synchronized output
+            if (term.mark == '>')
+            {
+                benchReply("\033[>41;0;0c");
+            }
+            else if (term.mark == '\0')
+            {
+                benchReply("\033[?62;22c");
+            }
+            break;
+        default:
+            // colors, modes and window operations don't change the glyphs
+            break;
+    }
+
+    if (term.row < 0) term.row = 0;
+    if (term.row >= BENCH_ROWS) term.row = BENCH_ROWS - 1;
+    if (term.column < 0) term.column = 0;
+    if (term.column > BENCH_COLUMNS) term.column = BENCH_COLUMNS;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Feed output bytes to the screen model
+ * @retval None
+ */
+static void terminalFeed(const char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        char ch = data[i];
+
+        switch (term.state)
+        {
+            case parserText:
+                if (ch == ESC) term.state = parserEscape;
+                else if (ch == '\r') term.column = 0;
+                else if (ch == '\n') { if (term.row < BENCH_ROWS - 1) term.row++; }
+                else if (ch == '\b') { if (term.column > 0) term.column--; }
+                else if ((unsigned char) ch >= ' ') terminalPut(ch);
+                break;
+
+            case parserEscape:
+                if (ch == '[')
+                {
+                    term.state = parserCsi;
+                    term.nParams = 0;
+                    term.mark = '\0';
+                    memset(term.param, 0, sizeof(term.param));
+                }
+                else if (ch == ']') term.state = parserOsc;
+                else term.state = parserText;
+                break;
+
+            case parserCsi:
+                if (ch >= '0' && ch <= '9')
+                {
+                    if (term.nParams == 0) term.nParams = 1;
+                    if (term.nParams <= BENCH_MAX_PARAMS)
+                    {
+                        term.param[term.nParams - 1] = term.param[term.nParams - 1] * 10 + (ch - '0');
+                    }
+                }
+                else if (ch == ';')
+                {
+                    if (term.nParams == 0) term.nParams = 1;
+                    term.nParams++;
+                }
+                else if (ch >= '@' && ch <= '~')
+                {
+                    if (term.nParams > BENCH_MAX_PARAMS) term.nParams = BENCH_MAX_PARAMS;
+                    terminalCsi(ch);
+                    term.state = parserText;
+                }
+                else if (ch >= '<' && ch <= '?' && term.nParams == 0)
+                {
+                    term.mark = ch;
+                }
+                // intermediates like '$' are skipped
+                break;
+
+            case parserOsc:
+                if (ch == '\a' || ch == ESC) term.state = parserText;
+                break;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Read the game output for a while
+ * @param  until: absolute deadline from benchNow()
+ * @retval False if the game exited
+ */
+static bool benchPump(int64_t until)
+{
+    char data[65536];
+
+    while (true)
+    {
+        int64_t now = benchNow();
+        int timeout = (until > now) ? (int) ((until - now + 999) / 1000) : 0;
+        struct pollfd pfd = {master, POLLIN, 0};
+        int size = sizeof(data);
+
+        // slow link, the game output waits in the pty until the link is free
+        if (linkRate > 0)
+        {
+            if (now < linkFree)
+            {
+                int64_t wake = (linkFree < until) ? linkFree : until;
+                poll(NULL, 0, (int) ((wake - now + 999) / 1000));
+                if (wake == until)
+                {
+                    return true;
+                }
+                continue;
+            }
+            size = linkRate / 1000 + 1; // about a millisecond worth
+        }
+
+        if (poll(&pfd, 1, timeout) <= 0)
+        {
+            return true;
+        }
+
+        int len = read(master, data, size);
+        if (len <= 0)
+        {
+            return (len < 0 && errno == EAGAIN);
+        }
+
+        now = benchNow();
+        if (linkRate > 0)
+        {
+            linkFree = now + (int64_t) len * 1000000 / linkRate;
+        }
+        if (now - bursts.lastByte >= quietGap)
+        {
+            bursts.frames++;
+        }
+        bursts.bytes += len;
+        bursts.lastByte = now;
+        terminalFeed(data, len);
+
+        // one read at a time so callers see every change
+        return true;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if an area of the screen differs from a snapshot
+ * @retval True if any cell changed
+ */
+static bool benchChanged(char snapshot[BENCH_ROWS][BENCH_COLUMNS], int top, int bottom, int left, int right)
+{
+    for (int i = top; i <= bottom; i++)
+    {
+        if (memcmp(&snapshot[i][left], &term.screen[i][left], right - left + 1) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Type a key and time the first change it makes in an area
+ * @param  key: byte sent to the game
+ * @retval The latency in milliseconds, negative if nothing changed
+ */
+static double benchKey(char key, int top, int bottom, int left, int right)
+{
+    char snapshot[BENCH_ROWS][BENCH_COLUMNS];
+
+    // let the previous frame land first
+    benchPump(benchNow() + 2 * quietGap);
+    memcpy(snapshot, term.screen, sizeof(snapshot));
+
+    int64_t start = benchNow();
+    if (write(master, &key, 1) != 1)
+    {
+        return -1;
+    }
+
+    while (benchNow() - start < BENCH_TIMEOUT)
+    {
+        if (!benchPump(start + BENCH_TIMEOUT))
+        {
+            return -1;
+        }
+        if (benchChanged(snapshot, top, bottom, left, right))
+        {
+            return (bursts.lastByte - start) / 1000.0;
+        }
+    }
+    return -1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Keep reading until a time, sending nothing
+ * @retval None
+ */
+static void benchWait(int64_t until)
+{
+    while (benchNow() < until && benchPump(until));
+}
+//**************************************************************************************
+
+/**
+ * @brief  Order samples for the percentiles
+ */
+static int benchCompare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Add a sample
+ * @retval None
+ */
+static void benchAdd(SAMPLES *s, double value)
+{
+    if (value >= 0 && s->n < BENCH_MAX_SAMPLES)
+    {
+        s->value[s->n++] = value;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print one row of the summary table
+ * @retval None
+ */
+static void benchRow(const char *name, const char *unit, SAMPLES *s)
+{
+    if (s->n == 0)
+    {
+        printf("%-26s %-6s %7d %9s %9s %9s %9s\n", name, unit, 0, "-", "-", "-", "-");
+        return;
+    }
+
+    qsort(s->value, s->n, sizeof(double), benchCompare);
+    printf("%-26s %-6s %7d %9.2f %9.2f %9.2f %9.2f\n", name, unit, s->n,
+           s->value[0], s->value[s->n / 2], s->value[(s->n * 95 + 99) / 100 - 1], s->value[s->n - 1]);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print the command line help
+ * @retval None
+ */
+static void benchUsage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "  --binary path    game to run (%s)\n"
+           "  --keys n         keys typed per phase (%d)\n"
+           "  --interval ms    time between keys (%d)\n"
+           "  --duration s     game time measured (%.0f)\n"
+           "  --gap us         quiet time that ends a frame (%d)\n"
+           "  --rate bytes/s   slow link while playing, 0 for no limit (%d)\n",
+           name, binary, nKeys, keyInterval, gameDuration, quietGap, gameRate);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Benchmark entry
+ * @retval Zero on success
+ */
+int main(int argc, char *argv[])
+{
+    SAMPLES firstByte = {0}, firstMenu = {0}, menuLatency = {0}, gameLatency = {0}, fps = {0}, frameBytes = {0};
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = (i + 1 < argc);
+
+        if (strcmp(argv[i], "--binary") == 0 && value) binary = argv[++i];
+        else if (strcmp(argv[i], "--keys") == 0 && value) nKeys = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--interval") == 0 && value) keyInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && value) gameDuration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gap") == 0 && value) quietGap = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && value) gameRate = atoi(argv[++i]);
+        else
+        {
+            benchUsage(argv[0]);
+            return 1;
+        }
+    }
+    // the menu arrow must be back on "play" after the menu keys
+    nKeys += nKeys % 2;
+
+    memset(term.screen, ' ', sizeof(term.screen));
+
+    // exec the game on a terminal of the size it asks for
+    struct winsize size = {.ws_row = BENCH_ROWS, .ws_col = BENCH_COLUMNS};
+    int64_t start = benchNow();
+    child = forkpty(&master, NULL, NULL, &size);
+    if (child < 0)
+    {
+        perror("forkpty");
+        return 1;
+    }
+    if (child == 0)
+    {
+        setenv("TERM", "xterm", 0);
+        execl(binary, binary, (char *) NULL);
+        perror(binary);
+        _exit(127);
+    }
+    fcntl(master, F_SETFL, O_NONBLOCK);
+
+    // startup, until the menu arrow shows up
+    bool menu = false;
+    while (!menu && benchNow() - start < BENCH_TIMEOUT)
+    {
+        if (!benchPump(start + BENCH_TIMEOUT)) break;
+        if (firstByte.n == 0 && bursts.bytes > 0) benchAdd(&firstByte, (bursts.lastByte - start) / 1000.0);
+        menu = (term.screen[ARROW_MAIN_MENU_INITIAL_POSITION_X][ARROW_MAIN_MENU_INITIAL_POSITION_Y] == '-');
+    }
+    if (!menu)
+    {
+        printf("The main menu never showed up\n");
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        return 1;
+    }
+    benchAdd(&firstMenu, (bursts.lastByte - start) / 1000.0);
+
+    // main menu, every key moves the arrow and nothing else draws
+    for (int i = 0; i < nKeys; i++)
+    {
+        benchWait(benchNow() + keyInterval * 1000);
+        benchAdd(&menuLatency, benchKey((i % 2) ? 'w' : 's', 0, BENCH_ROWS - 1, 0, BENCH_COLUMNS - 1));
+    }
+
+    // play, keys move the archer while the game draws at full rate
+    benchWait(benchNow() + keyInterval * 1000);
+    if (write(master, "\n", 1) != 1)
+    {
+        perror("write");
+    }
+    benchWait(benchNow() + 500000);
+    linkRate = gameRate;
+
+    int64_t gameStart = benchNow(), second = gameStart;
+    int frames = bursts.frames, framesSecond = bursts.frames;
+    uint64_t bytes = bursts.bytes;
+    for (int i = 0; benchNow() - gameStart < gameDuration * 1000000; i++)
+    {
+        benchWait(benchNow() + keyInterval * 1000);
+        benchAdd(&gameLatency, benchKey((i % 2) ? 's' : 'w', CANVAS_MIDDLE_EDGE_X + 1, CANVAS_LOWER_EDGE_X - 1,
+                                        CANVAS_LEFT_EDGE_Y + 1, ARCHER_INITIAL_Y + ARCHER_COLUMNS - 1));
+        if (benchNow() - second >= 1000000)
+        {
+            benchAdd(&fps, (bursts.frames - framesSecond) * 1e6 / (benchNow() - second));
+            framesSecond = bursts.frames;
+            second = benchNow();
+        }
+    }
+    if (bursts.frames > frames)
+    {
+        benchAdd(&frameBytes, (double) (bursts.bytes - bytes) / (bursts.frames - frames));
+    }
+
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    close(master);
+
+    printf("%-26s %-6s %7s %9s %9s %9s %9s\n", "measure", "unit", "samples", "min", "median", "p95", "max");
+    benchRow("exec to first byte", "ms", &firstByte);
+    benchRow("exec to first menu frame", "ms", &firstMenu);
+    benchRow("menu key to screen", "ms", &menuLatency);
+    benchRow("game key to screen", "ms", &gameLatency);
+    benchRow("game frames per second", "fps", &fps);
+    benchRow("game bytes per frame", "B", &frameBytes);
+    return 0;
+}
+//**************************************************************************************
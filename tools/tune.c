@@ -0,0 +1,796 @@
+/*******************************************************************************
+* @filename: tune.c
+* @brief: Monte Carlo difficulty tuner, sweeps PRESETS ranges and plays thousands
+*         of seeded headless games per setting with scripted bots on all cores
+*
+*  Copyright 2025 eduardofabbris
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+/**********************************************
+ * Includes
+ *********************************************/
+#include "replay.h"
+#include <math.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**********************************************
+ * Defines
+ *********************************************/
+
+// Games played by one task, the unit a worker steals
+#define TUNE_CHUNK 16
+
+// Limits
+#define TUNE_MAX_FIELDS 8
+#define TUNE_MAX_SETTINGS 4096
+#define TUNE_MAX_THREADS 256
+
+// 95% confidence
+#define TUNE_Z 1.96
+
+/**********************************************
+ * Enums
+ *********************************************/
+
+// scripted bots
+enum policy
+{
+    policyRandom,
+    policySpray,
+    policyAim,
+    N_POLICIES
+};
+
+/*********************************************************
+* Typedefs
+*********************************************************/
+
+// one PRESETS field that can be swept
+typedef struct Field
+{
+    const char *name;
+    size_t offset;
+} FIELD;
+
+// a field range given on the command line
+typedef struct Range
+{
+    int field;
+    int min, max, step;
+} RANGE;
+
+// games of one setting played by one bot
+typedef struct Task
+{
+    int setting, policy;
+    int firstGame, nGames;
+} TASK;
+
+// per worker queue, the owner works at the tail and thieves take from the head
+typedef struct Deque
+{
+    pthread_mutex_t lock;
+    TASK *task;
+    int head, tail;
+} DEQUE;
+
+// accumulated results of a setting and bot
+typedef struct Result
+{
+    int games, survived, timeouts;
+    double score, score2;
+    double level, level2;
+    uint64_t ticks;
+} RESULT;
+
+// bot memory between ticks
+typedef struct Bot
+{
+    uint32_t random;
+    int direction;
+    int64_t moveTick, shootTick; // last accepted key presses
+} BOT;
+
+/*********************************************************
+* Global Variables
+*********************************************************/
+
+static const FIELD fields[] = {
+    {"archerHitDelay", offsetof(PRESETS, archerHitDelay)},
+    {"arrowStaggerDelay", offsetof(PRESETS, arrowStaggerDelay)},
+    {"arrowHitDelay", offsetof(PRESETS, arrowHitDelay)},
+    {"balloonStaggerDelay", offsetof(PRESETS, balloonStaggerDelay)},
+    {"balloonScatteredDelayMax", offsetof(PRESETS, balloonScatteredDelayMax)},
+    {"balloonScatteredDelayMin", offsetof(PRESETS, balloonScatteredDelayMin)},
+    {"monsterStaggerDelay", offsetof(PRESETS, monsterStaggerDelay)},
+    {"monsterSpawnDelay", offsetof(PRESETS, monsterSpawnDelay)},
+};
+#define N_FIELDS ((int) (sizeof(fields) / sizeof(fields[0])))
+
+static const char *policyName[N_POLICIES] = {"random", "spray", "aim"};
+
+// run options
+static int nGames = 1000, startLevel = 1, nLevels = 3;
+static uint64_t maxTicks = 600000;
+static uint32_t baseSeed = 1;
+static bool policyOn[N_POLICIES] = {true, true, true};
+
+// sweep
+static RANGE range[TUNE_MAX_FIELDS];
+static int nRanges;
+static PRESETS setting[TUNE_MAX_SETTINGS];
+static int nSettings;
+
+// work
+static DEQUE deque[TUNE_MAX_THREADS];
+static int nThreads;
+static RESULT *result;
+static pthread_mutex_t resultLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*********************************************************
+* Function Definitions
+*********************************************************/
+
+/**
+ * @brief  Access a PRESETS field by its table entry
+ * @retval Pointer to the field
+ */
+static short *tuneField(PRESETS *preset, int field)
+{
+    return (short *) ((char *) preset + fields[field].offset);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Next number of a bot random generator (xorshift)
+ * @retval A pseudo random number
+ */
+static uint32_t botRandom(BOT *bot)
+{
+    bot->random ^= bot->random << 13;
+    bot->random ^= bot->random >> 17;
+    bot->random ^= bot->random << 5;
+    return bot->random;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Row a balloon top will be at when an arrow gets to it
+ * @param  arrowY: current arrow column
+ * @retval The row, -1 if the arrow is already past the balloon
+ */
+static int botBalloonTop(const ENV_OBSERVATION *obs, const PRESETS *preset, int i, int arrowY)
+{
+    int flight = (obs->balloonY[i] - ARROW_COLUMNS - arrowY) * preset->arrowStaggerDelay;
+    int rise = (preset->balloonStaggerDelay > 0) ? preset->balloonStaggerDelay : 1;
+
+    if (flight < 0)
+    {
+        return -1;
+    }
+    return obs->balloonX[i] - (flight + rise / 2) / rise;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Check if an arrow already flying will hit a target
+ * @param  kind: envBalloon or envMonster
+ * @param  i: target index
+ * @retval True if the target needs no more arrows
+ */
+static bool botCovered(const ENV_OBSERVATION *obs, const PRESETS *preset, enum envCell kind, int i)
+{
+    for (int a = 0; a < MAX_ARROW_QUANTITY; a++)
+    {
+        if (!(obs->arrowActive >> a & 1))
+        {
+            continue;
+        }
+        if (kind == envMonster)
+        {
+            if (obs->arrowX[a] >= obs->monsterX[i] && obs->arrowX[a] < obs->monsterX[i] + MONSTER_ROWS &&
+                obs->arrowY[a] + ARROW_COLUMNS < obs->monsterY[i] + MONSTER_COLUMNS)
+            {
+                return true;
+            }
+        }
+        else
+        {
+            int top = botBalloonTop(obs, preset, i, obs->arrowY[a]);
+            if (top >= 0 && obs->arrowX[a] >= top && obs->arrowX[a] < top + BALLOON_ROWS)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Move the arrow row toward a target, shoot once it's lined up
+ * @param  top, bottom: rows the arrow must fly through
+ * @retval The action
+ */
+static enum envAction botAimAt(const ENV_OBSERVATION *obs, int top, int bottom)
+{
+    int row = obs->archerRow + 1; // arrows leave from the archer second row
+
+    if (row < top) return envDown;
+    if (row > bottom) return envUp;
+    return envShoot;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Hold back a key pressed again before the game accepts it
+ * @param  tick: current game tick
+ * @retval The action sent to the game
+ * @note   A key repeated faster than its hit delay keeps the game limit on,
+ *         so a bot pressing every tick would never move
+ */
+static enum envAction botKey(BOT *bot, enum envAction action, int64_t tick, const PRESETS *preset)
+{
+    if (action == envUp || action == envDown)
+    {
+        if (tick - bot->moveTick <= preset->archerHitDelay) return envNoop;
+        bot->moveTick = tick;
+    }
+    else if (action == envShoot)
+    {
+        if (tick - bot->shootTick <= preset->arrowHitDelay) return envNoop;
+        bot->shootTick = tick;
+    }
+    return action;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Choose the next action of a bot
+ * @retval The action
+ */
+static enum envAction botAction(enum policy policy, BOT *bot, const ENV_OBSERVATION *obs, const PRESETS *preset)
+{
+    switch (policy)
+    {
+        case policyRandom:
+            return (enum envAction) (botRandom(bot) % 4);
+
+        case policySpray:
+            // sweep the whole field shooting all the time
+            if (obs->archerRow <= ARCHER_UPPER_LIMIT) bot->direction = 1;
+            if (obs->archerRow >= ARCHER_LOWER_LIMIT) bot->direction = -1;
+            if (botRandom(bot) % 2) return envShoot;
+            return (bot->direction > 0) ? envDown : envUp;
+
+        case policyAim:
+        {
+            // the closest monster, else the leftmost balloon that can still be reached
+            int best = -1, bestY = 1 << 30, top = 0;
+            for (int i = 0; i < MONSTER_QUANTITY; i++)
+            {
+                if ((obs->monsterActive >> i & 1) && obs->monsterY[i] < bestY && !botCovered(obs, preset, envMonster, i))
+                {
+                    best = i;
+                    bestY = obs->monsterY[i];
+                }
+            }
+            if (best >= 0)
+            {
+                return botAimAt(obs, obs->monsterX[best], obs->monsterX[best] + MONSTER_ROWS - 1);
+            }
+            for (int i = 0; i < BALLOON_QUANTITY; i++)
+            {
+                int row = botBalloonTop(obs, preset, i, ARCHER_INITIAL_Y + ARCHER_COLUMNS);
+                if ((obs->balloonActive >> i & 1) && obs->balloonY[i] < bestY && row > ARCHER_UPPER_LIMIT &&
+                    row + BALLOON_ROWS - 1 <= ARCHER_LOWER_LIMIT + 1 && !botCovered(obs, preset, envBalloon, i))
+                {
+                    best = i;
+                    bestY = obs->balloonY[i];
+                    top = row;
+                }
+            }
+            if (best >= 0)
+            {
+                return botAimAt(obs, top, top + BALLOON_ROWS - 1);
+            }
+            return envNoop;
+        }
+
+        default:
+            return envNoop;
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play the games of a task
+ * @retval None
+ */
+static void tuneRun(const TASK *task)
+{
+    RESULT local = {0};
+    ENV env;
+    ENV_OBSERVATION obs;
+
+    for (int g = task->firstGame; g < task->firstGame + task->nGames; g++)
+    {
+        // the same seeds for every setting, so settings are compared on the same games
+        BOT bot = {.random = (baseSeed + g) * 2654435761u | 1, .direction = 1, .moveTick = INT32_MIN, .shootTick = INT32_MIN};
+        int lastLevel = startLevel + nLevels - 1;
+        bool survived = false, timeout = false;
+
+        env_reset_preset(&env, baseSeed + g, &setting[task->setting], startLevel);
+        env_observe(&env, &obs);
+
+        while (true)
+        {
+            const PRESETS *preset = &setting[task->setting];
+            env_step(&env, botKey(&bot, botAction(task->policy, &bot, &obs, preset), env.steps, preset));
+            env_observe(&env, &obs);
+
+            if (obs.level > lastLevel || (env.done && !env.game.player.gameOver))
+            {
+                survived = true;
+                break;
+            }
+            if (env.done)
+            {
+                break;
+            }
+            if (env.steps >= maxTicks)
+            {
+                timeout = true;
+                break;
+            }
+        }
+
+        int level = (obs.level < lastLevel) ? obs.level : lastLevel;
+        local.games++;
+        local.survived += survived;
+        local.timeouts += timeout;
+        local.score += obs.score;
+        local.score2 += (double) obs.score * obs.score;
+        local.level += level;
+        local.level2 += (double) level * level;
+        local.ticks += env.steps;
+    }
+
+    RESULT *r = &result[task->setting * N_POLICIES + task->policy];
+    pthread_mutex_lock(&resultLock);
+    r->games += local.games;
+    r->survived += local.survived;
+    r->timeouts += local.timeouts;
+    r->score += local.score;
+    r->score2 += local.score2;
+    r->level += local.level;
+    r->level2 += local.level2;
+    r->ticks += local.ticks;
+    pthread_mutex_unlock(&resultLock);
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take the newest task of a worker own queue
+ * @retval True if a task was taken
+ */
+static bool dequePop(DEQUE *d, TASK *task)
+{
+    bool taken = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head)
+    {
+        *task = d->task[--d->tail];
+        taken = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return taken;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Take the oldest task of another worker queue
+ * @retval True if a task was stolen
+ */
+static bool dequeSteal(DEQUE *d, TASK *task)
+{
+    bool taken = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head)
+    {
+        *task = d->task[d->head++];
+        taken = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return taken;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Worker thread, runs its own tasks then steals from the others
+ * @param  arg: worker index
+ * @retval NULL
+ */
+static void *tuneWorker(void *arg)
+{
+    int self = (int) (intptr_t) arg;
+    TASK task;
+
+    while (true)
+    {
+        if (dequePop(&deque[self], &task))
+        {
+            tuneRun(&task);
+            continue;
+        }
+
+        // nothing left at home, no task spawns more tasks so one empty round ends the work
+        bool stolen = false;
+        for (int i = 1; i < nThreads && !stolen; i++)
+        {
+            stolen = dequeSteal(&deque[(self + i) % nThreads], &task);
+        }
+        if (!stolen)
+        {
+            break;
+        }
+        tuneRun(&task);
+    }
+    return NULL;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Build every combination of the swept field values
+ * @param  base: values of the fields not swept
+ * @param  skipped: combinations left out because a game can't take them
+ * @retval False if there are too many settings
+ */
+static bool tuneSettings(const PRESETS *base, int *skipped)
+{
+    int value[TUNE_MAX_FIELDS];
+
+    for (int i = 0; i < nRanges; i++)
+    {
+        value[i] = range[i].min;
+    }
+
+    nSettings = 0;
+    *skipped = 0;
+    while (true)
+    {
+        if (nSettings >= TUNE_MAX_SETTINGS)
+        {
+            return false;
+        }
+        setting[nSettings] = *base;
+        for (int i = 0; i < nRanges; i++)
+        {
+            *tuneField(&setting[nSettings], range[i].field) = value[i];
+        }
+        // e.g. a scattered delay min swept past the max
+        if (presetValid(&setting[nSettings]))
+        {
+            nSettings++;
+        }
+        else
+        {
+            (*skipped)++;
+        }
+
+        // odometer over the ranges
+        int i = nRanges - 1;
+        while (i >= 0)
+        {
+            value[i] += range[i].step;
+            if (value[i] <= range[i].max)
+            {
+                break;
+            }
+            value[i] = range[i].min;
+            i--;
+        }
+        if (i < 0)
+        {
+            return true;
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Parse a field=min[:max[:step]] range
+ * @retval False if invalid
+ */
+static bool tuneParseRange(const char *arg)
+{
+    const char *equal = strchr(arg, '=');
+    RANGE *r = &range[nRanges];
+
+    if (equal == NULL || nRanges >= TUNE_MAX_FIELDS)
+    {
+        return false;
+    }
+
+    r->field = -1;
+    for (int i = 0; i < N_FIELDS; i++)
+    {
+        if (strlen(fields[i].name) == (size_t) (equal - arg) && strncmp(fields[i].name, arg, equal - arg) == 0)
+        {
+            r->field = i;
+        }
+    }
+
+    int n = sscanf(equal + 1, "%d:%d:%d", &r->min, &r->max, &r->step);
+    if (r->field < 0 || n < 1)
+    {
+        return false;
+    }
+    if (n < 2) r->max = r->min;
+    if (n < 3) r->step = (r->max > r->min) ? (r->max - r->min) / 4 : 1;
+    if (r->step <= 0) r->step = 1;
+    if (r->min < 0 || r->max < r->min)
+    {
+        return false;
+    }
+
+    nRanges++;
+    return true;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print the results of every setting and bot
+ * @retval None
+ */
+static void tunePrint()
+{
+    int width = (nRanges > 0) ? nRanges * 9 : 7;
+
+    printf("%-*s  %-6s  %6s  %-21s  %-19s  %-15s  %s\n", width, "setting", "bot", "games",
+           "survival [95% CI]", "score +- 95% CI", "level +- 95% CI", "timeouts");
+
+    for (int s = 0; s < nSettings; s++)
+    {
+        char name[TUNE_MAX_FIELDS * 9 + 1] = "";
+        int len = 0;
+        for (int i = 0; i < nRanges; i++)
+        {
+            len += snprintf(name + len, sizeof(name) - len, "%-8d ", *tuneField(&setting[s], range[i].field));
+        }
+
+        for (int p = 0; p < N_POLICIES; p++)
+        {
+            RESULT *r = &result[s * N_POLICIES + p];
+            if (r->games == 0)
+            {
+                continue;
+            }
+
+            double n = r->games;
+            // Wilson interval for the survival rate
+            double rate = r->survived / n;
+            double center = (rate + TUNE_Z * TUNE_Z / (2 * n)) / (1 + TUNE_Z * TUNE_Z / n);
+            double half = TUNE_Z * sqrt(rate * (1 - rate) / n + TUNE_Z * TUNE_Z / (4 * n * n)) / (1 + TUNE_Z * TUNE_Z / n);
+            // normal approximation for the means
+            double score = r->score / n, level = r->level / n;
+            double scoreCi = TUNE_Z * sqrt(fmax(r->score2 / n - score * score, 0) / n);
+            double levelCi = TUNE_Z * sqrt(fmax(r->level2 / n - level * level, 0) / n);
+
+            printf("%-*s  %-6s  %6d  %5.1f%% [%5.1f,%5.1f]  %8.1f +- %-7.1f  %5.2f +- %-5.2f  %d\n",
+                   width, name, policyName[p], r->games, 100 * rate, 100 * fmax(center - half, 0), 100 * fmin(center + half, 1),
+                   score, scoreCi, level, levelCi, r->timeouts);
+        }
+    }
+}
+//**************************************************************************************
+
+/**
+ * @brief  Print the command line help
+ * @retval None
+ */
+static void tuneUsage(const char *name)
+{
+    printf("Usage: %s [options] field=min[:max[:step]] ...\n"
+           "  --games n        games per setting and bot (%d)\n"
+           "  --threads n      worker threads (all cores)\n"
+           "  --difficulty d   easy, normal or hard, gives the fields not swept (normal)\n"
+           "  --level n        first level (%d)\n"
+           "  --levels n       levels to clear to survive (%d)\n"
+           "  --bot name       random, spray or aim, repeat for several (all)\n"
+           "  --seed n         seed of the first game (%u)\n"
+           "  --max-ticks n    game ticks before giving up on a game (%llu)\n"
+           "  --record file    play one game with the bot and save it as a replay\n"
+           "Fields:", name, nGames, startLevel, nLevels, baseSeed, (unsigned long long) maxTicks);
+    for (int i = 0; i < N_FIELDS; i++)
+    {
+        printf(" %s", fields[i].name);
+    }
+    printf("\n");
+}
+//**************************************************************************************
+
+/**
+ * @brief  Play one game with a bot and save it as a replay
+ * @param  path: replay file written
+ * @retval Zero on success
+ */
+static int tuneRecord(const char *path, enum difficulty difficulty, enum policy policy)
+{
+    BOT bot = {.random = baseSeed * 2654435761u | 1, .direction = 1, .moveTick = INT32_MIN, .shootTick = INT32_MIN};
+    int lastLevel = startLevel + nLevels - 1;
+    ENV env;
+    ENV_OBSERVATION obs;
+    REPLAY replay;
+
+    env_reset(&env, baseSeed, difficulty, startLevel);
+    replay_init(&replay, baseSeed, difficulty, startLevel);
+    env_observe(&env, &obs);
+    while (!env.done && obs.level <= lastLevel && env.steps < maxTicks)
+    {
+        enum envAction action = botKey(&bot, botAction(policy, &bot, &obs, &env.game.preset), env.steps, &env.game.preset);
+        replay_add(&replay, env.steps, action);
+        env_step(&env, action);
+        env_observe(&env, &obs);
+    }
+    replay.ticks = env.steps;
+
+    bool saved = replay_save(&replay, path);
+    printf("%s: %s bot, level %d, score %d, %" PRIu64 " ticks\n", saved ? path : "Can't write replay",
+           policyName[policy], obs.level, (int) obs.score, env.steps);
+    replay_free(&replay);
+    return saved ? 0 : 1;
+}
+//**************************************************************************************
+
+/**
+ * @brief  Tuner entry
+ * @retval Zero on success
+ */
+int main(int argc, char *argv[])
+{
+    enum difficulty difficulty = normal;
+    bool botChosen = false;
+    const char *recordPath = NULL;
+    GAME base;
+    int skipped;
+
+    nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = (i + 1 < argc);
+
+        if (strcmp(argv[i], "--games") == 0 && value) nGames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && value) nThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--level") == 0 && value) startLevel = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--levels") == 0 && value) nLevels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && value) baseSeed = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-ticks") == 0 && value) maxTicks = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--record") == 0 && value) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--difficulty") == 0 && value)
+        {
+            i++;
+            if (strcmp(argv[i], "easy") == 0) difficulty = easy;
+            else if (strcmp(argv[i], "hard") == 0) difficulty = hard;
+        }
+        else if (strcmp(argv[i], "--bot") == 0 && value)
+        {
+            if (!botChosen)
+            {
+                memset(policyOn, 0, sizeof(policyOn));
+                botChosen = true;
+            }
+            i++;
+            for (int p = 0; p < N_POLICIES; p++)
+            {
+                if (strcmp(argv[i], policyName[p]) == 0) policyOn[p] = true;
+            }
+        }
+        else if (!tuneParseRange(argv[i]))
+        {
+            tuneUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (nThreads < 1) nThreads = 1;
+    if (nThreads > TUNE_MAX_THREADS) nThreads = TUNE_MAX_THREADS;
+    if (startLevel < 1 || startLevel > MAX_LEVEL) startLevel = 1;
+    if (nLevels < 1) nLevels = 1;
+
+    if (recordPath != NULL)
+    {
+        // the aim bot, unless only other bots were chosen
+        int policy = N_POLICIES - 1;
+        while (policy > 0 && !policyOn[policy]) policy--;
+        return tuneRecord(recordPath, difficulty, (enum policy) policy);
+    }
+
+    // the difficulty defines give every field not swept
+    gameInit(&base, difficulty);
+    setDifficultyPreset(&base);
+    if (!tuneSettings(&base.preset, &skipped))
+    {
+        printf("Too many settings, the limit is %d\n", TUNE_MAX_SETTINGS);
+        return 1;
+    }
+    if (skipped > 0)
+    {
+        printf("%d setting(s) skipped, balloonScatteredDelayMin must stay below balloonScatteredDelayMax\n", skipped);
+    }
+    if (nSettings == 0)
+    {
+        return 1;
+    }
+
+    // deal the tasks round robin, the stealing evens out slow settings
+    int nTasks = 0, perQueue;
+    int chunks = (nGames + TUNE_CHUNK - 1) / TUNE_CHUNK;
+    perQueue = (nSettings * N_POLICIES * chunks) / nThreads + 1;
+    result = calloc(nSettings * N_POLICIES, sizeof(RESULT));
+    for (int t = 0; t < nThreads; t++)
+    {
+        pthread_mutex_init(&deque[t].lock, NULL);
+        deque[t].task = malloc(perQueue * sizeof(TASK));
+    }
+    for (int s = 0; s < nSettings; s++)
+    {
+        for (int p = 0; p < N_POLICIES; p++)
+        {
+            for (int c = 0; c < chunks && policyOn[p]; c++)
+            {
+                DEQUE *d = &deque[nTasks++ % nThreads];
+                int first = c * TUNE_CHUNK;
+                d->task[d->tail++] = (TASK) {s, p, first, (nGames - first < TUNE_CHUNK) ? nGames - first : TUNE_CHUNK};
+            }
+        }
+    }
+
+    printf("%d setting(s) x %d games on %d thread(s)\n", nSettings, nGames, nThreads);
+    fflush(stdout);
+
+    uint64_t start = get_clock();
+    pthread_t thread[TUNE_MAX_THREADS];
+    for (int t = 0; t < nThreads; t++)
+    {
+        pthread_create(&thread[t], NULL, tuneWorker, (void *) (intptr_t) t);
+    }
+    for (int t = 0; t < nThreads; t++)
+    {
+        pthread_join(thread[t], NULL);
+    }
+
+    double elapsed = time_diff(start) / 1000;
+    uint64_t ticks = 0;
+    for (int i = 0; i < nSettings * N_POLICIES; i++)
+    {
+        ticks += result[i].ticks;
+    }
+
+    tunePrint();
+    printf("Done in %.1f s, %.1fM game ticks/s\n", elapsed, ticks / elapsed / 1e6);
+
+    for (int t = 0; t < nThreads; t++)
+    {
+        free(deque[t].task);
+        pthread_mutex_destroy(&deque[t].lock);
+    }
+    free(result);
+    return 0;
+}
+//**************************************************************************************
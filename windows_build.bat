@@ -3,6 +3,8 @@ title windows build
 if not exist "src" goto end
 echo Building project...
 if not exist "objects" mkdir "objects"
+gcc tools\artc.c src\glyph.c -o "objects\artc.exe" -Isrc\include -Wall -Wextra
+"objects\artc.exe" src\art.c || goto end
 for %%i in (src\*.c) do gcc %%i -o "objects\%%~ni.o" -Wall -Wextra -c
 gcc -o main.exe "objects\*.o"
 pause